@@ -1,37 +1,62 @@
 #include "SMC100Chained.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
 
 const char SMC100Chained::CarriageReturnCharacter = '\r';
 const char SMC100Chained::NewLineCharacter = '\n';
 const char SMC100Chained::GetCharacter = '?';
 const char SMC100Chained::NoErrorCharacter = '@';
-const uint32_t SMC100Chained::WipeInputEvery = 100000;
-const uint32_t SMC100Chained::CommandReplyTimeMax = 500000;
-const uint32_t SMC100Chained::WaitAfterSendingTimeMax = 20000;
-const uint32_t SMC100Chained::PollStatusTimeInterval = 100000;
-const uint32_t SMC100Chained::PollPositionTimeInterval = 100000;
+const uint32_t SMC100Chained::BaudRateDefault = 57600;
+const uint32_t SMC100Chained::IdleCheckIntervalDefault = 100000;
+const uint32_t SMC100Chained::ReplyProcessingTime = 4000;
+const uint8_t SMC100Chained::ReplyTurnaroundCharacters = 32;
+const uint8_t SMC100Chained::RetryBackoffCharacters = 16;
+const uint8_t SMC100Chained::RetryCountDefault = 2;
+const uint32_t SMC100Chained::RetryBackoffMax = 1000000;
+const uint32_t SMC100Chained::CommandLatencyBudgetDefault = 1000000;
+const uint32_t SMC100Chained::PollStatusTimeIntervalDefault = 100000;
+const uint32_t SMC100Chained::PollPositionTimeIntervalDefault = 100000;
+const uint32_t SMC100Chained::JogStepTimeDefault = 50000;
+const uint8_t SMC100Chained::FormatFloatDecimals = 6;
+const uint32_t SMC100Chained::FormatFloatScale = 1000000;
+const float SMC100Chained::FormatFloatMax = 4294967040.0;
+const int SMC100Chained::EventLogPrintSpace = 48;
+const uint32_t SMC100Chained::LatencyBucketFirstLimit = 256;
+const uint8_t SMC100Chained::GPIOWatchQuietPolls = 4;
 
 const SMC100Chained::CommandStruct SMC100Chained::CommandLibrary[] =
 {
-	{CommandType::None,"  ",CommandParameterType::None,CommandGetSetType::None},
-	{CommandType::Enable,"MM",CommandParameterType::Int,CommandGetSetType::GetSet},
-	{CommandType::Home,"OR",CommandParameterType::None,CommandGetSetType::None},
-	{CommandType::MoveAbs,"PA",CommandParameterType::Float,CommandGetSetType::GetSet},
-	{CommandType::MoveRel,"PR",CommandParameterType::Float,CommandGetSetType::GetSet},
-	{CommandType::MoveEstimate,"PT",CommandParameterType::Float,CommandGetSetType::GetAlways},
-	{CommandType::Configure,"PW",CommandParameterType::Int,CommandGetSetType::GetSet},
-	{CommandType::Analogue,"RA",CommandParameterType::None,CommandGetSetType::GetAlways},
-	{CommandType::GPIOInput,"RB",CommandParameterType::None,CommandGetSetType::GetAlways},
-	{CommandType::Reset,"RS",CommandParameterType::None,CommandGetSetType::None},
-	{CommandType::GPIOOutput,"SB",CommandParameterType::Int,CommandGetSetType::GetSet},
-	{CommandType::LimitPositive,"SR",CommandParameterType::Float,CommandGetSetType::GetSet},
-	{CommandType::LimitNegative,"SL",CommandParameterType::Float,CommandGetSetType::GetSet},
-	{CommandType::PositionAsSet,"TH",CommandParameterType::None,CommandGetSetType::GetAlways},
-	{CommandType::PositionReal,"TP",CommandParameterType::None,CommandGetSetType::GetAlways},
-	{CommandType::Velocity,"VA",CommandParameterType::None,CommandGetSetType::GetSet},
-	{CommandType::Acceleration,"AC",CommandParameterType::None,CommandGetSetType::GetSet},
-	{CommandType::KeypadEnable,"JM",CommandParameterType::Int,CommandGetSetType::GetSet},
-	{CommandType::ErrorCommands,"TE",CommandParameterType::None,CommandGetSetType::GetAlways},
-	{CommandType::ErrorStatus,"TS",CommandParameterType::None,CommandGetSetType::GetAlways}
+	{CommandType::None,"  ",CommandParameterType::None,CommandGetSetType::None,0},
+	{CommandType::Enable,"MM",CommandParameterType::Int,CommandGetSetType::GetSet,9},
+	{CommandType::Home,"OR",CommandParameterType::None,CommandGetSetType::None,0},
+	{CommandType::MoveAbs,"PA",CommandParameterType::Float,CommandGetSetType::GetSet,18},
+	{CommandType::MoveRel,"PR",CommandParameterType::Float,CommandGetSetType::GetSet,18},
+	{CommandType::MoveEstimate,"PT",CommandParameterType::Float,CommandGetSetType::GetAlways,18},
+	{CommandType::Configure,"PW",CommandParameterType::Int,CommandGetSetType::GetSet,9},
+	{CommandType::Analogue,"RA",CommandParameterType::None,CommandGetSetType::GetAlways,18},
+	{CommandType::GPIOInput,"RB",CommandParameterType::None,CommandGetSetType::GetAlways,8},
+	{CommandType::Reset,"RS",CommandParameterType::None,CommandGetSetType::None,0},
+	{CommandType::GPIOOutput,"SB",CommandParameterType::Int,CommandGetSetType::GetSet,8},
+	{CommandType::LimitPositive,"SR",CommandParameterType::Float,CommandGetSetType::GetSet,18},
+	{CommandType::LimitNegative,"SL",CommandParameterType::Float,CommandGetSetType::GetSet,18},
+	{CommandType::PositionAsSet,"TH",CommandParameterType::None,CommandGetSetType::GetAlways,18},
+	{CommandType::PositionReal,"TP",CommandParameterType::None,CommandGetSetType::GetAlways,18},
+	{CommandType::Velocity,"VA",CommandParameterType::Float,CommandGetSetType::GetSet,18},
+	{CommandType::Acceleration,"AC",CommandParameterType::Float,CommandGetSetType::GetSet,18},
+	{CommandType::KeypadEnable,"JM",CommandParameterType::Int,CommandGetSetType::GetSet,9},
+	{CommandType::ErrorCommands,"TE",CommandParameterType::None,CommandGetSetType::GetAlways,7},
+	{CommandType::ErrorStatus,"TS",CommandParameterType::None,CommandGetSetType::GetAlways,12}
+};
+
+const char* const SMC100Chained::EventNames[] =
+{
+	"Enqueue",
+	"Dequeue",
+	"Send",
+	"Reply",
+	"Status poll",
+	"Position poll",
 };
 
 const SMC100Chained::StatusCharSet SMC100Chained::StatusLibrary[] =
@@ -59,14 +84,93 @@ const SMC100Chained::StatusCharSet SMC100Chained::StatusLibrary[] =
 	{"47",StatusType::Jogging},
 };
 
-SMC100Chained::SMC100Chained(HardwareSerial *serial, const uint8_t* addresses, const uint8_t addresscount)
+#if defined(ARDUINO)
+SMC100Chained::SMC100Chained(HardwareSerial *serial, const uint8_t* addresses, const uint8_t addresscount) :
+	ArduinoTransport(serial, &Serial)
+{
+	Setup(&ArduinoTransport, addresses, addresscount, DefaultConfig(BaudRateDefault));
+}
+
+SMC100Chained::SMC100Chained(HardwareSerial *serial, const uint8_t* addresses, const uint8_t addresscount, const ConfigStruct& config) :
+	ArduinoTransport(serial, &Serial)
+{
+	Setup(&ArduinoTransport, addresses, addresscount, config);
+}
+#endif
+
+SMC100Chained::SMC100Chained(SMC100ChainedTransport *transport, const uint8_t* addresses, const uint8_t addresscount)
+{
+	Setup(transport, addresses, addresscount, DefaultConfig(BaudRateDefault));
+}
+
+SMC100Chained::SMC100Chained(SMC100ChainedTransport *transport, const uint8_t* addresses, const uint8_t addresscount, const ConfigStruct& config)
+{
+	Setup(transport, addresses, addresscount, config);
+}
+
+SMC100Chained::ConfigStruct SMC100Chained::DefaultConfig(uint32_t BaudRate)
+{
+	//Reply and retry timing is counted in characters so it shrinks as the link gets faster.
+	ConfigStruct Config;
+	uint32_t ByteTime = ByteTransmitTimeFor(BaudRate);
+	Config.BaudRate = BaudRate;
+	Config.ReplyTurnaroundTime = ReplyProcessingTime + (ReplyTurnaroundCharacters * ByteTime);
+	Config.RetryCount = RetryCountDefault;
+	Config.RetryBackoffTime = RetryBackoffCharacters * ByteTime;
+	Config.WaitAfterSendingTime = 0;
+	Config.PollStatusTimeInterval = PollStatusTimeIntervalDefault;
+	Config.SchedulerCommandWeight = 1;
+	Config.CommandLatencyBudget = CommandLatencyBudgetDefault;
+	Config.SchedulerPollWeight = 1;
+	Config.PollPositionTimeInterval = PollPositionTimeIntervalDefault;
+	Config.IdleCheckInterval = IdleCheckIntervalDefault;
+	Config.JogStepTime = JogStepTimeDefault;
+	return Config;
+}
+
+uint32_t SMC100Chained::ByteTransmitTimeFor(uint32_t BaudRate)
+{
+	//One start bit, eight data bits and one stop bit per character.
+	return (10UL * 1000000UL + BaudRate - 1) / BaudRate;
+}
+
+void SMC100Chained::SetConfig(const ConfigStruct& ConfigToSet)
+{
+	bool BaudRateChanged = (ConfigToSet.BaudRate != Config.BaudRate);
+	uint32_t PreviousPollStatusInterval = Config.PollStatusTimeInterval;
+	Config = ConfigToSet;
+	ByteTransmitTime = ByteTransmitTimeFor(Config.BaudRate);
+	//Axes tuned through SetPollInterval keep their own interval; only those still on the old default follow the new one.
+	for (uint8_t Index = 0; Index < SMC100ChainedMaxMotors; ++Index)
+	{
+		if (MotorState[Index].PollStatusInterval == PreviousPollStatusInterval)
+		{
+			MotorState[Index].PollStatusInterval = Config.PollStatusTimeInterval;
+		}
+	}
+	SchedulerSlot = 0;
+	if (BaudRateChanged)
+	{
+		Transport->Begin(Config.BaudRate);
+	}
+}
+
+void SMC100Chained::GetConfig(ConfigStruct* ConfigReturn)
+{
+	*ConfigReturn = Config;
+}
+
+void SMC100Chained::Setup(SMC100ChainedTransport* transport, const uint8_t* addresses, const uint8_t addresscount, const ConfigStruct& config)
 {
-	SerialPort = serial;
-	SerialPort->begin(57600);
+	Transport = transport;
+	Config = config;
+	ByteTransmitTime = ByteTransmitTimeFor(Config.BaudRate);
+	Transport->Begin(Config.BaudRate);
 	MotorCount = addresscount;
 	CurrentCommand = NULL;
 	CurrentCommandParameter = 0.0;
 	ReplyBufferIndex = 0;
+	ReplyDiscarding = false;
 	for (uint8_t Index = 0; Index < SMC100ChainedReplyBufferSize; ++Index)
 	{
 		ReplyBuffer[Index] = 0;
@@ -75,9 +179,12 @@ SMC100Chained::SMC100Chained(HardwareSerial *serial, const uint8_t* addresses, c
 	{
 		MotorState[Index].Address = 0;
 		MotorState[Index].Status = StatusType::Unknown;
+		MotorState[Index].ExpectedStatus = StatusType::Unknown;
 		MotorState[Index].HasBeenHomed = false;
 		MotorState[Index].Position = 0.0;
+		MotorState[Index].TargetPosition = 0.0;
 		MotorState[Index].GPIOInput = 0;
+		MotorState[Index].HardwareErrors = 0;
 		MotorState[Index].GPIOOutput = 0;
 		MotorState[Index].AnalogueReading = 0.0;
 		MotorState[Index].PositionLimitNegative = 0.0;
@@ -85,6 +192,23 @@ SMC100Chained::SMC100Chained(HardwareSerial *serial, const uint8_t* addresses, c
 		MotorState[Index].Velocity = 0.0;
 		MotorState[Index].Acceleration = 0.0;
 		MotorState[Index].PollStatus = false;
+		MotorState[Index].PollStatusInterval = Config.PollStatusTimeInterval;
+		MotorState[Index].PollStatusNextTime = 0;
+		MotorState[Index].StreamPosition = false;
+		StreamHead[Index] = 0;
+		StreamTail[Index] = 0;
+		Snapshots[Index].Time = 0;
+		Snapshots[Index].Position = 0.0;
+		Snapshots[Index].Status = StatusType::Unknown;
+		Snapshots[Index].HasBeenHomed = false;
+		AnalogueSampler[Index].Enabled = false;
+		AnalogueSampler[Index].DecimationCount = 0;
+		AnalogueSampler[Index].BlockCount = 0;
+		AnalogueHead[Index] = 0;
+		AnalogueTail[Index] = 0;
+		GPIOWatch[Index].Enabled = false;
+		Jog[Index].Enabled = false;
+		Jog[Index].Velocity = 0.0;
 		MotorState[Index].PollPosition = false;
 		MotorState[Index].NeedToPollPosition = false;
 		MotorState[Index].FinishedCallback = NULL;
@@ -93,24 +217,68 @@ SMC100Chained::SMC100Chained(HardwareSerial *serial, const uint8_t* addresses, c
 	{
 		MotorState[Index].Address = addresses[Index];
 	}
+	SnapshotSequence = 0;
 	ClearCommandQueue();
 	AllCompleteCallback = NULL;
 	MoveCompleteCallback = NULL;
 	HomeCompleteCallback = NULL;
 	GPIOReturnCallback = NULL;
+	CommandFailedCallback = NULL;
+	CurrentCommandRetries = 0;
 	NeedToFireMoveComplete = false;
 	NeedToFireHomeComplete = false;
 	CurrentCommand = NULL;
-	LastWipeTime = 0;
 	TransmitTime = 0;
+	TransmitLength = 0;
+	TransmitIndex = 0;
+	TransmitRoomIdle = Transport->AvailableForWrite();
+	Mode = ModeType::Inactive;
 	Verbose = false;
+	EventLogTail = 0;
+	EventLogCount = 0;
+	EventLogDropped = 0;
+	EventLogDroppedReported = 0;
+	BusBusyStartTime = 0;
+	ResetStats();
 	PollStatus = false;
 	PollPosition = false;
-	PollPositionTimeLast = 0;
-	PollStatusTimeLast = 0;
+	PollNextMotorIndex = 0;
+	StreamNextMotorIndex = 0;
+	AnalogueNextMotorIndex = 0;
+	AnalogueBlockCallback = NULL;
+	GPIOWatchNextMotorIndex = 0;
+	GPIOEdgeCallback = NULL;
+	CommandRejectedCallback = NULL;
+	CommandOutcomeCallback = NULL;
+	CommandOutcomeContext = NULL;
+	FollowedCommand = CommandType::None;
+	JogNextMotorIndex = 0;
+	Sequence = NULL;
+	SequenceCount = 0;
+	SequenceIndex = 0;
+	SequenceWaiting = false;
+	SequenceCallback = NULL;
+	LastEnqueueRejected = false;
+	QueueHeld = false;
+	QueueReleased = false;
+	RejectedCount = 0;
+	CurrentCommandSource = CommandSourceType::Queue;
+	TransmitStartTime = 0;
+	SchedulerSlot = 0;
+	for (uint8_t Index = 0; Index < static_cast<uint8_t>(TimerType::Count); ++Index)
+	{
+		TimerDeadline[Index] = 0;
+		TimerActive[Index] = false;
+	}
 	Mode = ModeType::Inactive;
 }
 
+void SMC100Chained::Begin(const ConfigStruct& ConfigToSet)
+{
+	SetConfig(ConfigToSet);
+	Begin();
+}
+
 void SMC100Chained::Begin()
 {
 	Mode = ModeType::Idle;
@@ -185,9 +353,51 @@ bool SMC100Chained::IsEnabled(uint8_t MotorIndex)
 	}
 }
 
+void SMC100Chained::Log(const char* Text)
+{
+	Transport->Log(Text);
+}
+
+void SMC100Chained::Log(char Character)
+{
+	char Text[2] = {Character, '\0'};
+	Transport->Log(Text);
+}
+
+void SMC100Chained::Log(int Value)
+{
+	Log((long)Value);
+}
+
+void SMC100Chained::Log(unsigned int Value)
+{
+	Log((unsigned long)Value);
+}
+
+void SMC100Chained::Log(long Value)
+{
+	char Text[12];
+	Text[FormatInt(Text, (int32_t)Value)] = '\0';
+	Transport->Log(Text);
+}
+
+void SMC100Chained::Log(unsigned long Value)
+{
+	char Text[12];
+	Text[FormatUnsigned(Text, (uint32_t)Value)] = '\0';
+	Transport->Log(Text);
+}
+
+void SMC100Chained::Log(double Value)
+{
+	char Text[20];
+	Text[FormatFloat(Text, (float)Value)] = '\0';
+	Transport->Log(Text);
+}
+
 void SMC100Chained::PrintMotorIndexError()
 {
-	Serial.print("<SMCERROR>(Motor index too large)");
+	Log("<SMCERROR>(Motor index too large)");
 }
 
 void SMC100Chained::Enable(uint8_t MotorIndex,bool Setting)
@@ -226,7 +436,7 @@ void SMC100Chained::Home(uint8_t MotorIndex)
 	}
 }
 
-void SMC100Chained::SendGetVelocity(uint8_t MotorIndex, FinishedListener Callback = NULL)
+void SMC100Chained::SendGetVelocity(uint8_t MotorIndex, FinishedListener Callback)
 {
 	if (MotorIndex >= MotorCount)
 	{
@@ -236,7 +446,7 @@ void SMC100Chained::SendGetVelocity(uint8_t MotorIndex, FinishedListener Callbac
 	CommandEnqueue(MotorIndex, CommandType::Velocity, 0.0, CommandGetSetType::Get, Callback);
 }
 
-void SMC100Chained::SendGetAcceleration(uint8_t MotorIndex, FinishedListener Callback = NULL)
+void SMC100Chained::SendGetAcceleration(uint8_t MotorIndex, FinishedListener Callback)
 {
 	if (MotorIndex >= MotorCount)
 	{
@@ -246,7 +456,7 @@ void SMC100Chained::SendGetAcceleration(uint8_t MotorIndex, FinishedListener Cal
 	CommandEnqueue(MotorIndex, CommandType::Acceleration, 0.0, CommandGetSetType::Get, Callback);
 }
 
-void SMC100Chained::SendSetVelocity(uint8_t MotorIndex, float VelocityToSet, FinishedListener Callback = NULL)
+void SMC100Chained::SendSetVelocity(uint8_t MotorIndex, float VelocityToSet, FinishedListener Callback)
 {
 	if (MotorIndex >= MotorCount)
 	{
@@ -256,7 +466,7 @@ void SMC100Chained::SendSetVelocity(uint8_t MotorIndex, float VelocityToSet, Fin
 	CommandEnqueue(MotorIndex, CommandType::Velocity, VelocityToSet, CommandGetSetType::Set, Callback);
 }
 
-void SMC100Chained::SendSetAcceleration(uint8_t MotorIndex, float AccelerationToSet, FinishedListener Callback = NULL)
+void SMC100Chained::SendSetAcceleration(uint8_t MotorIndex, float AccelerationToSet, FinishedListener Callback)
 {
 	if (MotorIndex >= MotorCount)
 	{
@@ -267,32 +477,208 @@ void SMC100Chained::SendSetAcceleration(uint8_t MotorIndex, float AccelerationTo
 }
 
 void SMC100Chained::MoveAbsolute(uint8_t MotorIndex, float Target)
+{
+	MoveAbsolute(MotorIndex, Target, Config.CommandLatencyBudget);
+}
+
+void SMC100Chained::MoveAbsolute(uint8_t MotorIndex, float Target, uint32_t LatencyBudget)
+{
+	if (MotorIndex >= MotorCount)
+	{
+		PrintMotorIndexError();
+		return;
+	}
+	if (Target < MotorState[MotorIndex].PositionLimitNegative)
+	{
+		Target = MotorState[MotorIndex].PositionLimitNegative;
+		Log("<SMCERROR>(Position for motor ");
+		Log(MotorIndex);
+		Log(" is under limit.)\n");
+	}
+	if (Target > MotorState[MotorIndex].PositionLimitPositive)
+	{
+		Target = MotorState[MotorIndex].PositionLimitPositive;
+		Log("<SMCERROR>(Position for motor ");
+		Log(MotorIndex);
+		Log(" is over limit.)\n");
+	}
+	CommandEnqueue(MotorIndex, CommandType::MoveAbs, Target, CommandGetSetType::Set, NULL, LatencyBudget);
+	if (!LastEnqueueRejected)
+	{
+		MotorState[MotorIndex].TargetPosition = Target;
+	}
+}
+
+void SMC100Chained::MoveRelative(uint8_t MotorIndex, float Distance)
+{
+	MoveRelative(MotorIndex, Distance, Config.CommandLatencyBudget);
+}
+
+void SMC100Chained::MoveRelative(uint8_t MotorIndex, float Distance, uint32_t LatencyBudget)
+{
+	if (MotorIndex >= MotorCount)
+	{
+		PrintMotorIndexError();
+		return;
+	}
+	//Limits are checked against where earlier moves will leave the axis, so no TP is needed to build the step.
+	float Target = MotorState[MotorIndex].TargetPosition + Distance;
+	if (Target < MotorState[MotorIndex].PositionLimitNegative)
+	{
+		Target = MotorState[MotorIndex].PositionLimitNegative;
+		Log("<SMCERROR>(Position for motor ");
+		Log(MotorIndex);
+		Log(" is under limit.)\n");
+	}
+	if (Target > MotorState[MotorIndex].PositionLimitPositive)
+	{
+		Target = MotorState[MotorIndex].PositionLimitPositive;
+		Log("<SMCERROR>(Position for motor ");
+		Log(MotorIndex);
+		Log(" is over limit.)\n");
+	}
+	CommandEnqueue(MotorIndex, CommandType::MoveRel, Target - MotorState[MotorIndex].TargetPosition, CommandGetSetType::Set, NULL, LatencyBudget);
+	if (!LastEnqueueRejected)
+	{
+		MotorState[MotorIndex].TargetPosition = Target;
+	}
+}
+
+void SMC100Chained::StartJog(uint8_t MotorIndex, float Velocity)
+{
+	if (MotorIndex >= MotorCount)
+	{
+		PrintMotorIndexError();
+		return;
+	}
+	if (!Jog[MotorIndex].Enabled)
+	{
+		Jog[MotorIndex].NextTime = Transport->Micros();
+	}
+	Jog[MotorIndex].Enabled = true;
+	Jog[MotorIndex].Velocity = Velocity;
+}
+
+void SMC100Chained::SetJogVelocity(uint8_t MotorIndex, float Velocity)
 {
 	if (MotorIndex >= MotorCount)
 	{
 		PrintMotorIndexError();
 		return;
 	}
+	Jog[MotorIndex].Velocity = Velocity;
+}
+
+void SMC100Chained::StopJog(uint8_t MotorIndex)
+{
+	if (MotorIndex >= MotorCount)
+	{
+		PrintMotorIndexError();
+		return;
+	}
+	if (!Jog[MotorIndex].Enabled)
+	{
+		return;
+	}
+	//One status and position poll at the end brings the mirror back in line with the controller.
+	Jog[MotorIndex].Enabled = false;
+	MotorState[MotorIndex].NeedToPollPosition = true;
+	PrepareErrorStatusPolling(MotorIndex);
+}
+
+uint32_t SMC100Chained::EstimateMoveTime(uint8_t MotorIndex, float Distance)
+{
+	//Trapezoidal profile from the cached VA and AC, triangular when the move is too short to reach full speed.
+	float Velocity = MotorState[MotorIndex].Velocity;
+	float Acceleration = MotorState[MotorIndex].Acceleration;
+	Distance = fabs(Distance);
+	if ( (Velocity <= 0.0) || (Acceleration <= 0.0) )
+	{
+		return 0;
+	}
+	float Seconds = 0.0;
+	if (Distance > (Velocity * Velocity / Acceleration))
+	{
+		Seconds = (Distance / Velocity) + (Velocity / Acceleration);
+	}
+	else
+	{
+		Seconds = 2.0 * sqrt(Distance / Acceleration);
+	}
+	return (uint32_t)(Seconds * 1000000.0);
+}
+
+bool SMC100Chained::FindDueJog(uint8_t* MotorIndexReturn)
+{
+	uint32_t Now = Transport->Micros();
+	for (uint8_t Offset = 0; Offset < MotorCount; ++Offset)
+	{
+		uint8_t MotorIndex = (JogNextMotorIndex + Offset) % MotorCount;
+		if ( Jog[MotorIndex].Enabled && (Jog[MotorIndex].Velocity != 0.0) && ( (int32_t)(Now - Jog[MotorIndex].NextTime) >= 0 ) && !CommandQueueHasMotor(MotorIndex) )
+		{
+			*MotorIndexReturn = MotorIndex;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool SMC100Chained::SendJogStep(uint8_t MotorIndex)
+{
+	JogNextMotorIndex = (MotorIndex + 1) % MotorCount;
+	char ErrorChar = CheckCommandAllowed(MotorState[MotorIndex].ExpectedStatus, CommandType::MoveRel, CommandGetSetType::Set);
+	if (ErrorChar != NoErrorCharacter)
+	{
+		Jog[MotorIndex].Enabled = false;
+		Stats.Axes[MotorIndex].CommandsRejected++;
+		RejectedCount++;
+		ReportOutcome(MotorIndex, CommandType::MoveRel, OutcomeType::Rejected, ErrorChar);
+		if (CommandRejectedCallback != NULL)
+		{
+			CommandRejectedCallback(MotorIndex, CommandType::MoveRel, ErrorChar);
+		}
+		return false;
+	}
+	uint32_t Now = Transport->Micros();
+	float Step = Jog[MotorIndex].Velocity * ( (float)Config.JogStepTime / 1000000.0 );
+	float Target = MotorState[MotorIndex].TargetPosition + Step;
 	if (Target < MotorState[MotorIndex].PositionLimitNegative)
 	{
 		Target = MotorState[MotorIndex].PositionLimitNegative;
-		Serial.print("<SMCERROR>(Position for motor ");
-		Serial.print(MotorIndex);
-		Serial.print(" is under limit.)\n");
 	}
 	if (Target > MotorState[MotorIndex].PositionLimitPositive)
 	{
 		Target = MotorState[MotorIndex].PositionLimitPositive;
-		Serial.print("<SMCERROR>(Position for motor ");
-		Serial.print(MotorIndex);
-		Serial.print(" is over limit.)\n");
 	}
-	CommandEnqueue(MotorIndex, CommandType::MoveAbs, Target, CommandGetSetType::Set);
+	Step = Target - MotorState[MotorIndex].TargetPosition;
+	//Wait for the longer of the requested pace and the time the controller needs, so each PR lands on a stopped axis.
+	uint32_t Wait = EstimateMoveTime(MotorIndex, Step);
+	if (Wait < Config.JogStepTime)
+	{
+		Wait = Config.JogStepTime;
+	}
+	Jog[MotorIndex].NextTime = Now + Wait;
+	if (Step == 0.0)
+	{
+		return false;
+	}
+	LoadCurrentCommand(MotorIndex, CommandType::MoveRel, CommandGetSetType::Set, Step, CommandSourceType::Jog);
+	if (!SendCurrentCommand())
+	{
+		return false;
+	}
+	MotorState[MotorIndex].TargetPosition = Target;
+	return true;
 }
 
 void SMC100Chained::SendGetPosition(uint8_t MotorIndex)
 {
-	CommandEnqueue(MotorIndex, CommandType::PositionReal, 0, CommandGetSetType::Get);
+	SendGetPosition(MotorIndex, Config.CommandLatencyBudget);
+}
+
+void SMC100Chained::SendGetPosition(uint8_t MotorIndex, uint32_t LatencyBudget)
+{
+	CommandEnqueue(MotorIndex, CommandType::PositionReal, 0, CommandGetSetType::Get, NULL, LatencyBudget);
 }
 
 float SMC100Chained::GetVelocity(uint8_t MotorIndex)
@@ -344,13 +730,18 @@ bool SMC100Chained::GetGPIOInput(uint8_t MotorIndex, uint8_t Pin)
 	}
 	if (Pin > 3)
 	{
-		Serial.print("<SMCERROR>(Get GPIO input index too large.)");
+		Log("<SMCERROR>(Get GPIO input index too large.)");
 		return false;
 	}
-	return bitRead(MotorState[MotorIndex].GPIOInput, Pin);
+	return ( (MotorState[MotorIndex].GPIOInput >> Pin) & 0x01 );
 }
 
 void SMC100Chained::SetGPIOOutput(uint8_t MotorIndex, uint8_t Pin, bool Output)
+{
+	SetGPIOOutput(MotorIndex, Pin, Output, Config.CommandLatencyBudget);
+}
+
+void SMC100Chained::SetGPIOOutput(uint8_t MotorIndex, uint8_t Pin, bool Output, uint32_t LatencyBudget)
 {
 	if (MotorIndex >= MotorCount)
 	{
@@ -359,14 +750,26 @@ void SMC100Chained::SetGPIOOutput(uint8_t MotorIndex, uint8_t Pin, bool Output)
 	}
 	if (Pin > 3)
 	{
-		Serial.print("<SMCERROR>(Get GPIO input index too large.)");
+		Log("<SMCERROR>(Get GPIO input index too large.)");
 		return;
 	}
-	bitWrite(MotorState[MotorIndex].GPIOOutput, Pin, Output);
-	CommandEnqueue(MotorIndex, CommandType::GPIOOutput, (float)(MotorState[MotorIndex].GPIOOutput), CommandGetSetType::Set);
+	if (Output)
+	{
+		MotorState[MotorIndex].GPIOOutput |= (1 << Pin);
+	}
+	else
+	{
+		MotorState[MotorIndex].GPIOOutput &= ~(1 << Pin);
+	}
+	CommandEnqueue(MotorIndex, CommandType::GPIOOutput, (float)(MotorState[MotorIndex].GPIOOutput), CommandGetSetType::Set, NULL, LatencyBudget);
 }
 
 void SMC100Chained::SetGPIOOutputAll(uint8_t MotorIndex, uint8_t Code)
+{
+	SetGPIOOutputAll(MotorIndex, Code, Config.CommandLatencyBudget);
+}
+
+void SMC100Chained::SetGPIOOutputAll(uint8_t MotorIndex, uint8_t Code, uint32_t LatencyBudget)
 {
 	if (MotorIndex >= MotorCount)
 	{
@@ -374,7 +777,7 @@ void SMC100Chained::SetGPIOOutputAll(uint8_t MotorIndex, uint8_t Code)
 		return;
 	}
 	MotorState[MotorIndex].GPIOOutput = Code;
-	CommandEnqueue(MotorIndex, CommandType::GPIOOutput, (float)(MotorState[MotorIndex].GPIOOutput), CommandGetSetType::Set);
+	CommandEnqueue(MotorIndex, CommandType::GPIOOutput, (float)(MotorState[MotorIndex].GPIOOutput), CommandGetSetType::Set, NULL, LatencyBudget);
 }
 
 void SMC100Chained::SetAxesCompleteCallback(uint8_t MotorIndex, FinishedListener Callback)
@@ -385,7 +788,7 @@ void SMC100Chained::SetAxesCompleteCallback(uint8_t MotorIndex, FinishedListener
 	}
 	else
 	{
-		Serial.print("<SMCERROR>(Can not assign callback. Motor index too high.)");
+		Log("<SMCERROR>(Can not assign callback. Motor index too high.)");
 	}
 }
 
@@ -409,119 +812,1054 @@ void SMC100Chained::SetGPIOReturnCallback(FinishedListener Callback)
 	GPIOReturnCallback = Callback;
 }
 
-void SMC100Chained::SetVerbose(bool VerboseToSet)
-{
-	Verbose = VerboseToSet;
-}
-
-void SMC100Chained::Check()
+bool SMC100Chained::RunSequence(const SequenceStep* Steps, uint8_t Count, SequenceListener Callback)
 {
-	bool CheckIsIdle = true;
-	if ( (Mode == ModeType::Idle) && CommandQueueEmpty() )
+	if (SequenceIsRunning())
 	{
-		if (PollStatus)
-		{
-			CheckErrorStatusPoll();
-			CheckIsIdle = false;
-		}
-		if (PollPosition)
-		{
-			CheckPositionPoll();
-			CheckIsIdle = false;
-		}
+		Log("<SMCERROR>(Sequence already running.)\n");
+		return false;
 	}
-	switch (Mode)
+	if ( (Steps == NULL) || (Count == 0) )
 	{
-		case ModeType::Idle:
-			CheckCommandQueue();
-			break;
-		case ModeType::WaitForCommandReply:
-			CheckForCommandReply();
-			break;
-		default:
-			break;
+		Log("<SMCERROR>(Sequence is empty.)\n");
+		return false;
 	}
-	if ( Busy && CheckIsIdle && (Mode == ModeType::Idle) && CommandQueueEmpty() )
+	//Every step is checked before the first one runs, so a bad step cannot leave a sequence half done.
+	for (uint8_t Index = 0; Index < Count; ++Index)
 	{
-		Busy = false;
-		if (AllCompleteCallback != NULL)
+		const SequenceStep* Step = &Steps[Index];
+		bool NeedsMotor = (Step->Command != CommandType::None) || (Step->Wait == SequenceWaitType::Idle) || (Step->Wait == SequenceWaitType::Stopped) || (Step->Wait == SequenceWaitType::GPIOHigh) || (Step->Wait == SequenceWaitType::GPIOLow);
+		bool NeedsPin = (Step->Wait == SequenceWaitType::GPIOHigh) || (Step->Wait == SequenceWaitType::GPIOLow);
+		if ( ( NeedsMotor && (Step->MotorIndex >= MotorCount) ) || ( NeedsPin && (Step->WaitPin > 3) ) )
 		{
-			AllCompleteCallback();
+			Log("<SMCERROR>(Sequence step ");
+			Log(Index);
+			Log(" has an invalid motor or pin.)\n");
+			return false;
 		}
 	}
+	Sequence = Steps;
+	SequenceCount = Count;
+	SequenceIndex = 0;
+	SequenceWaiting = false;
+	SequenceCallback = Callback;
+	return true;
 }
 
-void SMC100Chained::PrepareErrorStatusPolling(uint8_t MotorIndex)
+void SMC100Chained::AbortSequence()
 {
-	PrepareErrorStatusPolling(MotorIndex, true);
+	if (SequenceIsRunning())
+	{
+		FinishSequence(false);
+	}
 }
 
-void SMC100Chained::PrepareErrorStatusPolling(uint8_t MotorIndex, bool Enable)
+bool SMC100Chained::SequenceIsRunning()
 {
-	if (MotorIndex < MotorCount)
+	return (Sequence != NULL);
+}
+
+uint8_t SMC100Chained::GetSequenceStep()
+{
+	return SequenceIndex;
+}
+
+bool SMC100Chained::CheckSequence()
+{
+	//Returns true when a step put a new command in the queue.
+	bool Dispatched = false;
+	while ( SequenceIsRunning() )
 	{
-		if (MotorState[MotorIndex].PollStatus != Enable)
+		const SequenceStep* Step = &Sequence[SequenceIndex];
+		if (!SequenceWaiting)
 		{
-			EnqueueErrorStatusRequest(MotorIndex);
-			PollStatus = Enable;
-			MotorState[MotorIndex].PollStatus = Enable;
-			PollStatusTimeLast = micros();
-			if (Verbose)
+			if (!DispatchSequenceStep(Step))
+			{
+				FinishSequence(false);
+				return Dispatched;
+			}
+			Dispatched = Dispatched || (Step->Command != CommandType::None);
+			SequenceWaiting = true;
+			SequenceStepTime = Transport->Micros();
+			SequencePollTime = SequenceStepTime - Config.PollStatusTimeInterval;
+		}
+		if (!SequenceStepDone(Step))
+		{
+			if ( (Step->Wait != SequenceWaitType::Delay) && (Step->WaitTime != 0) && ( (uint32_t)(Transport->Micros() - SequenceStepTime) > Step->WaitTime ) )
 			{
-				Serial.print("<SMCV>(Status poll : ");
-				Serial.print(MotorIndex);
-				Serial.print(")\n");
+				Log("<SMCERROR>(Sequence step ");
+				Log(SequenceIndex);
+				Log(" timed out.)\n");
+				FinishSequence(false);
 			}
+			return Dispatched;
+		}
+		SequenceWaiting = false;
+		SequenceIndex++;
+		if (SequenceIndex >= SequenceCount)
+		{
+			FinishSequence(true);
 		}
 	}
+	return Dispatched;
+}
+
+bool SMC100Chained::DispatchSequenceStep(const SequenceStep* Step)
+{
+	if (Step->Command == CommandType::None)
+	{
+		return true;
+	}
+	if (Step->MotorIndex >= MotorCount)
+	{
+		PrintMotorIndexError();
+		return false;
+	}
+	LastEnqueueRejected = false;
+	//Moves and homing go through the public calls so limits, targets and the homed shortcut still apply.
+	if ( (Step->Command == CommandType::MoveAbs) && (Step->GetOrSet == CommandGetSetType::Set) )
+	{
+		MoveAbsolute(Step->MotorIndex, Step->Parameter);
+	}
+	else if ( (Step->Command == CommandType::MoveRel) && (Step->GetOrSet == CommandGetSetType::Set) )
+	{
+		MoveRelative(Step->MotorIndex, Step->Parameter);
+	}
+	else if (Step->Command == CommandType::Home)
+	{
+		Home(Step->MotorIndex);
+	}
 	else
 	{
-		Serial.print("<SMCERROR>(Motor index too large for error polling)");
+		CommandEnqueue(Step->MotorIndex, Step->Command, Step->Parameter, Step->GetOrSet);
 	}
+	return !LastEnqueueRejected;
 }
 
-void SMC100Chained::CheckErrorStatusPoll()
+bool SMC100Chained::SequenceStepDone(const SequenceStep* Step)
 {
-	if ( (micros() - PollStatusTimeLast) > PollStatusTimeInterval)
+	uint8_t MotorIndex = Step->MotorIndex;
+	switch (Step->Wait)
 	{
-		for (int MotorIndex = 0; MotorIndex < MotorCount; ++MotorIndex)
+		case SequenceWaitType::None:
+			return true;
+		case SequenceWaitType::Idle:
+			return AxisIsIdle(MotorIndex);
+		case SequenceWaitType::Stopped:
+			return AxisIsStopped(MotorIndex);
+		case SequenceWaitType::Delay:
+			return ( (uint32_t)(Transport->Micros() - SequenceStepTime) >= Step->WaitTime );
+		case SequenceWaitType::GPIOHigh:
+		case SequenceWaitType::GPIOLow:
 		{
-			if (MotorState[MotorIndex].PollStatus)
+			bool Wanted = (Step->Wait == SequenceWaitType::GPIOHigh);
+			if ( AxisIsIdle(MotorIndex) && ( (bool)( (MotorState[MotorIndex].GPIOInput >> Step->WaitPin) & 0x01 ) == Wanted ) )
+			{
+				return true;
+			}
+			//Without a watch on the axis nothing else refreshes the inputs, so send RB at the status poll rate.
+			uint32_t Now = Transport->Micros();
+			if ( !GPIOWatch[MotorIndex].Enabled && AxisIsIdle(MotorIndex) && ( (uint32_t)(Now - SequencePollTime) >= Config.PollStatusTimeInterval ) )
 			{
-				EnqueueErrorStatusRequest(MotorIndex);
+				SequencePollTime = Now;
+				SendGetGPIOInput(MotorIndex);
 			}
-			PollStatusTimeLast = micros();
+			return false;
 		}
+		default:
+			return true;
 	}
 }
 
-void SMC100Chained::PreparePositionPolling(uint8_t MotorIndex)
+bool SMC100Chained::AxisIsIdle(uint8_t MotorIndex)
 {
-	PreparePositionPolling(MotorIndex, true);
+	if ( (Mode != ModeType::Idle) && (CurrentCommandMotorIndex == MotorIndex) )
+	{
+		return false;
+	}
+	return !CommandQueueHasMotor(MotorIndex);
 }
 
-void SMC100Chained::PreparePositionPolling(uint8_t MotorIndex, bool Enable)
+bool SMC100Chained::AxisIsStopped(uint8_t MotorIndex)
 {
-	if (MotorIndex < MotorCount)
-	{
-		if (MotorState[MotorIndex].PollPosition != Enable)
-		{
-			EnqueuePositionRequest(MotorIndex);
-			MotorState[MotorIndex].PollPosition = Enable;
-			MotorState[MotorIndex].NeedToPollPosition = false;
-			PollPosition = Enable;
-			PollPositionTimeLast = micros();
-			if (Verbose)
+	//Stopped also means the polls that follow a move have brought status and position up to date.
+	StatusType Status = MotorState[MotorIndex].ExpectedStatus;
+	return ( AxisIsIdle(MotorIndex) && (Status != StatusType::Moving) && (Status != StatusType::Homing) && !MotorState[MotorIndex].PollStatus && !MotorState[MotorIndex].NeedToPollPosition && !Jog[MotorIndex].Enabled );
+}
+
+uint32_t SMC100Chained::GetRejectedCount()
+{
+	return RejectedCount;
+}
+uint8_t SMC100Chained::GetQueueFree()
+{
+	return SMC100ChainedQueueCount - CommandQueueCount();
+}
+
+void SMC100Chained::FinishSequence(bool Completed)
+{
+	uint8_t StepIndex = SequenceIndex;
+	Sequence = NULL;
+	SequenceWaiting = false;
+	if (SequenceCallback != NULL)
+	{
+		SequenceCallback(Completed, StepIndex);
+	}
+}
+
+void SMC100Chained::SetCommandRejectedCallback(RejectedListener Callback)
+{
+	CommandRejectedCallback = Callback;
+}
+
+void SMC100Chained::SetCommandFailedCallback(FailedListener Callback)
+{
+	CommandFailedCallback = Callback;
+}
+
+void SMC100Chained::SetCommandOutcomeCallback(OutcomeListener Callback, void* Context)
+{
+	//The context is handed back untouched, so a front end object can tell which of its requests finished.
+	CommandOutcomeCallback = Callback;
+	CommandOutcomeContext = Context;
+}
+
+void SMC100Chained::SetRetryPolicy(uint8_t RetryCount, uint32_t BackoffTime)
+{
+	Config.RetryCount = RetryCount;
+	Config.RetryBackoffTime = BackoffTime;
+}
+
+void SMC100Chained::SetVerbose(bool VerboseToSet)
+{
+	Verbose = VerboseToSet;
+}
+
+void SMC100Chained::LogEvent(EventType Event, uint8_t MotorIndex, CommandType Command, CommandGetSetType GetOrSet, float Parameter)
+{
+	//Records are only copied into RAM here, formatting happens later in CheckEventLog().
+	if (!Verbose)
+	{
+		return;
+	}
+	if (EventLogCount >= SMC100ChainedEventLogCount)
+	{
+		EventLogDropped++;
+		return;
+	}
+	uint8_t Index = (EventLogTail + EventLogCount) % SMC100ChainedEventLogCount;
+	EventLog[Index].Time = Transport->Micros();
+	EventLog[Index].Event = Event;
+	EventLog[Index].MotorIndex = MotorIndex;
+	EventLog[Index].Command = Command;
+	EventLog[Index].GetOrSet = GetOrSet;
+	EventLog[Index].Parameter = Parameter;
+	EventLogCount++;
+}
+
+bool SMC100Chained::ReadEvent(EventRecord* Record)
+{
+	if (EventLogCount == 0)
+	{
+		return false;
+	}
+	*Record = EventLog[EventLogTail];
+	EventLogTail = (EventLogTail + 1) % SMC100ChainedEventLogCount;
+	EventLogCount--;
+	return true;
+}
+
+uint16_t SMC100Chained::GetEventsDropped()
+{
+	return EventLogDropped;
+}
+
+void SMC100Chained::GetStats(StatsStruct* Snapshot)
+{
+	*Snapshot = Stats;
+	uint32_t Now = Transport->Micros();
+	if (BusIsBusy())
+	{
+		Snapshot->BusBusyTime += Now - BusBusyStartTime;
+	}
+	Snapshot->ElapsedTime = Now - StatsResetTime;
+}
+
+void SMC100Chained::ResetStats()
+{
+	memset(&Stats, 0, sizeof(Stats));
+	StatsResetTime = Transport->Micros();
+	if (BusIsBusy())
+	{
+		BusBusyStartTime = StatsResetTime;
+	}
+}
+
+void SMC100Chained::RecordLatency(uint8_t MotorIndex, uint32_t Latency)
+{
+	//Bucket zero holds replies under 256 us, each following bucket doubles the span.
+	uint8_t Bucket = 0;
+	uint32_t BucketLimit = LatencyBucketFirstLimit;
+	while ( (Latency >= BucketLimit) && (Bucket < (SMC100ChainedLatencyBucketCount - 1)) )
+	{
+		BucketLimit = BucketLimit << 1;
+		Bucket++;
+	}
+	Stats.Axes[MotorIndex].LatencyHistogram[Bucket]++;
+	if (Latency > Stats.Axes[MotorIndex].LatencyMax)
+	{
+		Stats.Axes[MotorIndex].LatencyMax = Latency;
+	}
+}
+
+void SMC100Chained::CheckEventLog()
+{
+	//Prints at most one record per call and only when it fits in the diagnostic port buffer, so it never blocks.
+	if ( (EventLogCount == 0) || (Transport->LogAvailableForWrite() < EventLogPrintSpace) )
+	{
+		return;
+	}
+	EventRecord Record;
+	if (!ReadEvent(&Record))
+	{
+		return;
+	}
+	Log("<SMCV>(");
+	Log(Record.Time);
+	Log(",");
+	Log(EventNames[static_cast<uint8_t>(Record.Event)]);
+	Log(",");
+	Log(Record.MotorIndex);
+	Log(",");
+	Log(CommandLibrary[static_cast<uint8_t>(Record.Command)].CommandChar);
+	Log(",");
+	Log(static_cast<uint8_t>(Record.GetOrSet));
+	Log(",");
+	Log(Record.Parameter);
+	//EventLogDropped only counts up for GetEventsDropped(), the log reports what was lost since the last report.
+	uint16_t DroppedSinceReport = EventLogDropped - EventLogDroppedReported;
+	if (DroppedSinceReport > 0)
+	{
+		Log(",dropped ");
+		Log(DroppedSinceReport);
+		EventLogDroppedReported = EventLogDropped;
+	}
+	Log(")\n");
+}
+
+void SMC100Chained::Check()
+{
+	bool CheckIsIdle = !(PollStatus || PollPosition);
+	if ( (Mode == ModeType::Idle) && CommandQueueEmpty() && PollPosition )
+	{
+		CheckPositionPoll();
+	}
+	CheckEventLog();
+	switch (Mode)
+	{
+		case ModeType::Idle:
+			CheckCommandQueue();
+			break;
+		case ModeType::Transmitting:
+			CheckTransmit();
+			break;
+		case ModeType::WaitForCommandReply:
+			CheckForCommandReply();
+			break;
+		case ModeType::RetryWait:
+			CheckRetryWait();
+			break;
+		case ModeType::WaitAfterSending:
+			CheckWaitAfterSending();
+			break;
+		default:
+			break;
+	}
+	//A step finished by this tick's reply dispatches its successor straight away instead of on the next loop.
+	if ( CheckSequence() && (Mode == ModeType::Idle) )
+	{
+		CheckCommandQueue();
+	}
+	if ( Busy && CheckIsIdle && (Mode == ModeType::Idle) && CommandQueueEmpty() )
+	{
+		Busy = false;
+		if (AllCompleteCallback != NULL)
+		{
+			AllCompleteCallback();
+		}
+	}
+}
+
+void SMC100Chained::PrepareErrorStatusPolling(uint8_t MotorIndex)
+{
+	PrepareErrorStatusPolling(MotorIndex, true);
+}
+
+void SMC100Chained::PrepareErrorStatusPolling(uint8_t MotorIndex, bool Enable)
+{
+	if (MotorIndex < MotorCount)
+	{
+		if (MotorState[MotorIndex].PollStatus != Enable)
+		{
+			PollStatus = Enable;
+			MotorState[MotorIndex].PollStatus = Enable;
+			MotorState[MotorIndex].PollStatusNextTime = Transport->Micros();
+		}
+	}
+	else
+	{
+		Log("<SMCERROR>(Motor index too large for error polling)");
+	}
+}
+
+void SMC100Chained::StartPositionStream(uint8_t MotorIndex)
+{
+	if (MotorIndex >= MotorCount)
+	{
+		PrintMotorIndexError();
+		return;
+	}
+	MotorState[MotorIndex].StreamPosition = true;
+}
+
+void SMC100Chained::StopPositionStream(uint8_t MotorIndex)
+{
+	if (MotorIndex >= MotorCount)
+	{
+		PrintMotorIndexError();
+		return;
+	}
+	MotorState[MotorIndex].StreamPosition = false;
+}
+
+uint8_t SMC100Chained::ReadPositionStream(uint8_t MotorIndex, PositionSample* Samples, uint8_t MaxCount)
+{
+	//Consumer side of the single producer ring, the tail is only published after the samples are copied out.
+	if (MotorIndex >= MotorCount)
+	{
+		return 0;
+	}
+	uint8_t Tail = StreamTail[MotorIndex];
+	uint8_t Head = StreamHead[MotorIndex];
+	SMC100ChainedMemoryBarrier();
+	uint8_t Count = 0;
+	while ( (Tail != Head) && (Count < MaxCount) )
+	{
+		Samples[Count] = StreamSamples[MotorIndex][Tail];
+		Tail = (Tail + 1) % SMC100ChainedStreamBufferCount;
+		Count++;
+	}
+	SMC100ChainedMemoryBarrier();
+	StreamTail[MotorIndex] = Tail;
+	return Count;
+}
+
+void SMC100Chained::PushPositionSample(uint8_t MotorIndex, float Position)
+{
+	MotorState[MotorIndex].Position = Position;
+	uint8_t Head = StreamHead[MotorIndex];
+	uint8_t NextHead = (Head + 1) % SMC100ChainedStreamBufferCount;
+	if (NextHead == StreamTail[MotorIndex])
+	{
+		Stats.Axes[MotorIndex].StreamOverruns++;
+		return;
+	}
+	StreamSamples[MotorIndex][Head].Time = CurrentReplyTime();
+	StreamSamples[MotorIndex][Head].Position = Position;
+	SMC100ChainedMemoryBarrier();
+	StreamHead[MotorIndex] = NextHead;
+	Stats.Axes[MotorIndex].StreamSamples++;
+}
+
+bool SMC100Chained::ReadSnapshot(uint8_t MotorIndex, AxisSnapshot* SnapshotReturn)
+{
+	//Seqlock reader, retries while the writer is mid-update and gives up rather than spin if Check() keeps preempting it.
+	if (MotorIndex >= MotorCount)
+	{
+		return false;
+	}
+	for (uint8_t Attempt = 0; Attempt < SMC100ChainedSnapshotRetries; ++Attempt)
+	{
+		uint32_t Before = SnapshotSequence;
+		SMC100ChainedMemoryBarrier();
+		if ( (Before & 1) == 0 )
+		{
+			*SnapshotReturn = Snapshots[MotorIndex];
+			SMC100ChainedMemoryBarrier();
+			if (SnapshotSequence == Before)
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+uint8_t SMC100Chained::ReadAllSnapshots(AxisSnapshot* SnapshotsReturn, uint8_t MaxCount)
+{
+	uint8_t Count = (MaxCount < MotorCount) ? MaxCount : MotorCount;
+	for (uint8_t Attempt = 0; Attempt < SMC100ChainedSnapshotRetries; ++Attempt)
+	{
+		uint32_t Before = SnapshotSequence;
+		SMC100ChainedMemoryBarrier();
+		if ( (Before & 1) == 0 )
+		{
+			for (uint8_t Index = 0; Index < Count; ++Index)
+			{
+				SnapshotsReturn[Index] = Snapshots[Index];
+			}
+			SMC100ChainedMemoryBarrier();
+			if (SnapshotSequence == Before)
+			{
+				return Count;
+			}
+		}
+	}
+	return 0;
+}
+
+uint32_t SMC100Chained::GetSnapshotSequence()
+{
+	return SnapshotSequence;
+}
+
+bool SMC100Chained::GetMotorStatus(uint8_t MotorIndex, MotorStatus* StatusReturn)
+{
+	//A plain copy, unlike the snapshots it is only safe from the thread that runs Check().
+	if (MotorIndex >= MotorCount)
+	{
+		return false;
+	}
+	*StatusReturn = MotorState[MotorIndex];
+	return true;
+}
+
+uint16_t SMC100Chained::GetHardwareErrors(uint8_t MotorIndex)
+{
+	if (MotorIndex >= MotorCount)
+	{
+		PrintMotorIndexError();
+		return 0;
+	}
+	return MotorState[MotorIndex].HardwareErrors;
+}
+
+const char* SMC100Chained::GetMnemonic(CommandType Command)
+{
+	uint8_t Index = static_cast<uint8_t>(Command);
+	if (Index >= SMC100ChainedCommandTypeCount)
+	{
+		Index = 0;
+	}
+	return CommandLibrary[Index].CommandChar;
+}
+
+void SMC100Chained::PublishSnapshot(uint8_t MotorIndex, uint32_t Time)
+{
+	//Odd sequence marks the write in progress, so readers never see a position from one reply and a status from another.
+	MotorStatus* State = &MotorState[MotorIndex];
+	SnapshotSequence = SnapshotSequence + 1;
+	SMC100ChainedMemoryBarrier();
+	Snapshots[MotorIndex].Time = Time;
+	Snapshots[MotorIndex].Position = State->Position;
+	Snapshots[MotorIndex].Status = State->Status;
+	Snapshots[MotorIndex].HasBeenHomed = State->HasBeenHomed;
+	SMC100ChainedMemoryBarrier();
+	SnapshotSequence = SnapshotSequence + 1;
+}
+
+bool SMC100Chained::FindNextStreamMotor(uint8_t* MotorIndexReturn)
+{
+	for (uint8_t Offset = 0; Offset < MotorCount; ++Offset)
+	{
+		uint8_t MotorIndex = (StreamNextMotorIndex + Offset) % MotorCount;
+		if (MotorState[MotorIndex].StreamPosition)
+		{
+			*MotorIndexReturn = MotorIndex;
+			return true;
+		}
+	}
+	return false;
+}
+
+void SMC100Chained::SendStreamSample(uint8_t MotorIndex)
+{
+	//Stream samples only fill idle bus time and skip the TE follow up so the sample rate is limited by TP alone.
+	StreamNextMotorIndex = (MotorIndex + 1) % MotorCount;
+	LoadCurrentCommand(MotorIndex, CommandType::PositionReal, CommandGetSetType::Get, 0.0, CommandSourceType::PositionStream);
+	SendCurrentCommand();
+}
+
+bool SMC100Chained::CurrentCommandIsSample()
+{
+	return ( (CurrentCommandSource == CommandSourceType::PositionStream) || (CurrentCommandSource == CommandSourceType::AnalogueSample) || (CurrentCommandSource == CommandSourceType::GPIOWatch) );
+}
+
+uint32_t SMC100Chained::CurrentReplyTime()
+{
+	//The controller samples somewhere between the send and the reply, so the midpoint is the best estimate.
+	uint32_t Now = Transport->Micros();
+	return TransmitStartTime + ( (Now - TransmitStartTime) / 2 );
+}
+
+void SMC100Chained::SendGetAnalogue(uint8_t MotorIndex)
+{
+	if (MotorIndex >= MotorCount)
+	{
+		PrintMotorIndexError();
+		return;
+	}
+	CommandEnqueue(MotorIndex, CommandType::Analogue, 0.0, CommandGetSetType::None);
+}
+
+float SMC100Chained::GetAnalogue(uint8_t MotorIndex)
+{
+	if (MotorIndex >= MotorCount)
+	{
+		PrintMotorIndexError();
+		return NAN;
+	}
+	return MotorState[MotorIndex].AnalogueReading;
+}
+
+void SMC100Chained::StartAnalogueSampling(uint8_t MotorIndex, uint32_t Interval, uint8_t Decimation, uint8_t BlockSize)
+{
+	if (MotorIndex >= MotorCount)
+	{
+		PrintMotorIndexError();
+		return;
+	}
+	if (Decimation == 0)
+	{
+		Decimation = 1;
+	}
+	if ( (BlockSize == 0) || (BlockSize >= SMC100ChainedAnalogueBufferCount) )
+	{
+		BlockSize = SMC100ChainedAnalogueBufferCount - 1;
+	}
+	AnalogueSamplerState* Sampler = &AnalogueSampler[MotorIndex];
+	Sampler->Enabled = true;
+	Sampler->Interval = Interval;
+	Sampler->NextTime = Transport->Micros();
+	Sampler->Decimation = Decimation;
+	Sampler->DecimationCount = 0;
+	Sampler->BlockSize = BlockSize;
+	Sampler->BlockCount = 0;
+}
+
+void SMC100Chained::StopAnalogueSampling(uint8_t MotorIndex)
+{
+	if (MotorIndex >= MotorCount)
+	{
+		PrintMotorIndexError();
+		return;
+	}
+	AnalogueSampler[MotorIndex].Enabled = false;
+}
+
+void SMC100Chained::SetAnalogueBlockCallback(AnalogueBlockListener Callback)
+{
+	AnalogueBlockCallback = Callback;
+}
+
+uint8_t SMC100Chained::ReadAnalogueSamples(uint8_t MotorIndex, AnalogueSample* Samples, uint8_t MaxCount)
+{
+	if (MotorIndex >= MotorCount)
+	{
+		return 0;
+	}
+	uint8_t Tail = AnalogueTail[MotorIndex];
+	uint8_t Head = AnalogueHead[MotorIndex];
+	SMC100ChainedMemoryBarrier();
+	uint8_t Count = 0;
+	while ( (Tail != Head) && (Count < MaxCount) )
+	{
+		Samples[Count] = AnalogueSamples[MotorIndex][Tail];
+		Tail = (Tail + 1) % SMC100ChainedAnalogueBufferCount;
+		Count++;
+	}
+	SMC100ChainedMemoryBarrier();
+	AnalogueTail[MotorIndex] = Tail;
+	return Count;
+}
+
+bool SMC100Chained::FindDueAnalogueSample(uint8_t* MotorIndexReturn)
+{
+	uint32_t Now = Transport->Micros();
+	for (uint8_t Offset = 0; Offset < MotorCount; ++Offset)
+	{
+		uint8_t MotorIndex = (AnalogueNextMotorIndex + Offset) % MotorCount;
+		if ( AnalogueSampler[MotorIndex].Enabled && ( (int32_t)(Now - AnalogueSampler[MotorIndex].NextTime) >= 0 ) )
+		{
+			*MotorIndexReturn = MotorIndex;
+			return true;
+		}
+	}
+	return false;
+}
+
+void SMC100Chained::SendAnalogueSample(uint8_t MotorIndex)
+{
+	//Like stream samples these skip the TE follow up, so one RA round trip is the whole cost of a reading.
+	uint32_t Now = Transport->Micros();
+	AnalogueSamplerState* Sampler = &AnalogueSampler[MotorIndex];
+	Sampler->NextTime += Sampler->Interval;
+	if ( (int32_t)(Now - Sampler->NextTime) >= 0 )
+	{
+		Sampler->NextTime = Now + Sampler->Interval;
+	}
+	AnalogueNextMotorIndex = (MotorIndex + 1) % MotorCount;
+	LoadCurrentCommand(MotorIndex, CommandType::Analogue, CommandGetSetType::None, 0.0, CommandSourceType::AnalogueSample);
+	SendCurrentCommand();
+}
+
+void SMC100Chained::AddAnalogueReading(uint8_t MotorIndex, float Reading)
+{
+	//Folds readings into min, max and mean until the decimation count is reached, then stores one sample.
+	uint32_t ReadingTime = CurrentReplyTime();
+	AnalogueSamplerState* Sampler = &AnalogueSampler[MotorIndex];
+	if (Sampler->DecimationCount == 0)
+	{
+		Sampler->FirstTime = ReadingTime;
+		Sampler->Minimum = Reading;
+		Sampler->Maximum = Reading;
+		Sampler->Sum = 0.0;
+	}
+	if (Reading < Sampler->Minimum)
+	{
+		Sampler->Minimum = Reading;
+	}
+	if (Reading > Sampler->Maximum)
+	{
+		Sampler->Maximum = Reading;
+	}
+	Sampler->Sum += Reading;
+	Sampler->DecimationCount++;
+	if (Sampler->DecimationCount < Sampler->Decimation)
+	{
+		return;
+	}
+	uint8_t Head = AnalogueHead[MotorIndex];
+	uint8_t NextHead = (Head + 1) % SMC100ChainedAnalogueBufferCount;
+	if (NextHead == AnalogueTail[MotorIndex])
+	{
+		Stats.Axes[MotorIndex].AnalogueOverruns++;
+	}
+	else
+	{
+		AnalogueSamples[MotorIndex][Head].Time = Sampler->FirstTime + ( (ReadingTime - Sampler->FirstTime) / 2 );
+		AnalogueSamples[MotorIndex][Head].Mean = Sampler->Sum / Sampler->DecimationCount;
+		AnalogueSamples[MotorIndex][Head].Minimum = Sampler->Minimum;
+		AnalogueSamples[MotorIndex][Head].Maximum = Sampler->Maximum;
+		SMC100ChainedMemoryBarrier();
+		AnalogueHead[MotorIndex] = NextHead;
+		Stats.Axes[MotorIndex].AnalogueSamples++;
+		Sampler->BlockCount++;
+	}
+	Sampler->DecimationCount = 0;
+	if (Sampler->BlockCount >= Sampler->BlockSize)
+	{
+		Sampler->BlockCount = 0;
+		if (AnalogueBlockCallback != NULL)
+		{
+			AnalogueBlockCallback(MotorIndex, Sampler->BlockSize);
+		}
+	}
+}
+
+void SMC100Chained::StartGPIOWatch(uint8_t MotorIndex, uint8_t PinMask, uint32_t FastInterval, uint32_t SlowInterval)
+{
+	if (MotorIndex >= MotorCount)
+	{
+		PrintMotorIndexError();
+		return;
+	}
+	if (SlowInterval < FastInterval)
+	{
+		SlowInterval = FastInterval;
+	}
+	GPIOWatchState* Watch = &GPIOWatch[MotorIndex];
+	Watch->Enabled = true;
+	Watch->PinMask = PinMask;
+	Watch->FastInterval = FastInterval;
+	Watch->SlowInterval = SlowInterval;
+	Watch->Interval = FastInterval;
+	Watch->NextTime = Transport->Micros();
+	Watch->QuietPolls = 0;
+	Watch->HavePrevious = false;
+}
+
+void SMC100Chained::StopGPIOWatch(uint8_t MotorIndex)
+{
+	if (MotorIndex >= MotorCount)
+	{
+		PrintMotorIndexError();
+		return;
+	}
+	GPIOWatch[MotorIndex].Enabled = false;
+}
+
+void SMC100Chained::SetGPIOEdgeCallback(GPIOEdgeListener Callback)
+{
+	GPIOEdgeCallback = Callback;
+}
+
+bool SMC100Chained::FindDueGPIOWatch(uint8_t* MotorIndexReturn)
+{
+	uint32_t Now = Transport->Micros();
+	for (uint8_t Offset = 0; Offset < MotorCount; ++Offset)
+	{
+		uint8_t MotorIndex = (GPIOWatchNextMotorIndex + Offset) % MotorCount;
+		if ( GPIOWatch[MotorIndex].Enabled && ( (int32_t)(Now - GPIOWatch[MotorIndex].NextTime) >= 0 ) )
+		{
+			*MotorIndexReturn = MotorIndex;
+			return true;
+		}
+	}
+	return false;
+}
+
+void SMC100Chained::SendGPIOWatchPoll(uint8_t MotorIndex)
+{
+	uint32_t Now = Transport->Micros();
+	GPIOWatchState* Watch = &GPIOWatch[MotorIndex];
+	Watch->NextTime += Watch->Interval;
+	if ( (int32_t)(Now - Watch->NextTime) >= 0 )
+	{
+		Watch->NextTime = Now + Watch->Interval;
+	}
+	GPIOWatchNextMotorIndex = (MotorIndex + 1) % MotorCount;
+	LoadCurrentCommand(MotorIndex, CommandType::GPIOInput, CommandGetSetType::None, 0.0, CommandSourceType::GPIOWatch);
+	SendCurrentCommand();
+}
+
+void SMC100Chained::CheckGPIOEdges(uint8_t MotorIndex, uint8_t Previous, uint8_t Current)
+{
+	GPIOWatchState* Watch = &GPIOWatch[MotorIndex];
+	if (!Watch->Enabled)
+	{
+		return;
+	}
+	uint8_t Changed = (Previous ^ Current) & Watch->PinMask;
+	if (!Watch->HavePrevious)
+	{
+		Watch->HavePrevious = true;
+		Changed = 0;
+	}
+	//Any edge drops straight back to the fast rate, a quiet poll backs off by doubling up to the slow rate.
+	if (Changed == 0)
+	{
+		if (Watch->QuietPolls < GPIOWatchQuietPolls)
+		{
+			Watch->QuietPolls++;
+		}
+		else if (Watch->Interval < Watch->SlowInterval)
+		{
+			Watch->Interval = Watch->Interval * 2;
+			if (Watch->Interval > Watch->SlowInterval)
+			{
+				Watch->Interval = Watch->SlowInterval;
+			}
+		}
+		return;
+	}
+	Watch->QuietPolls = 0;
+	Watch->Interval = Watch->FastInterval;
+	Watch->NextTime = Transport->Micros() + Watch->Interval;
+	uint32_t EdgeTime = CurrentReplyTime();
+	for (uint8_t Pin = 0; Pin < 8; ++Pin)
+	{
+		if ( (Changed >> Pin) & 0x01 )
+		{
+			Stats.Axes[MotorIndex].GPIOEdges++;
+			if (GPIOEdgeCallback != NULL)
+			{
+				GPIOEdgeCallback(MotorIndex, Pin, (Current >> Pin) & 0x01, EdgeTime);
+			}
+		}
+	}
+}
+
+void SMC100Chained::SetPollInterval(uint8_t MotorIndex, uint32_t Interval)
+{
+	if (MotorIndex >= MotorCount)
+	{
+		PrintMotorIndexError();
+		return;
+	}
+	MotorState[MotorIndex].PollStatusInterval = Interval;
+}
+
+void SMC100Chained::SetSchedulerWeights(uint8_t CommandWeight, uint8_t PollWeight)
+{
+	Config.SchedulerCommandWeight = CommandWeight;
+	Config.SchedulerPollWeight = PollWeight;
+	SchedulerSlot = 0;
+}
+
+uint32_t SMC100Chained::TimeUntilNextCheck()
+{
+	//Lets a host sleep between calls to Check(). Received bytes are expected to wake it early.
+	uint32_t Now = Transport->Micros();
+	uint8_t Offset = 0;
+	if (Mode == ModeType::Transmitting)
+	{
+		return ByteTransmitTime;
+	}
+	if ( (Mode == ModeType::Idle) && !QueueHeld && ( CommandQueueEarliestDeadline(&Offset) || FindNextStreamMotor(&Offset) ) )
+	{
+		return 0;
+	}
+	if ( SequenceIsRunning() && !SequenceWaiting )
+	{
+		return 0;
+	}
+	int32_t Wait = (int32_t)Config.IdleCheckInterval;
+	if (Mode == ModeType::WaitForCommandReply)
+	{
+		ShortenWait(&Wait, TimerDeadline[static_cast<uint8_t>(TimerType::Reply)], Now);
+	}
+	else if (Mode == ModeType::RetryWait)
+	{
+		ShortenWait(&Wait, TimerDeadline[static_cast<uint8_t>(TimerType::Retry)], Now);
+	}
+	else if (Mode == ModeType::WaitAfterSending)
+	{
+		ShortenWait(&Wait, TimerDeadline[static_cast<uint8_t>(TimerType::WaitAfterSending)], Now);
+	}
+	else if (Mode == ModeType::Idle)
+	{
+		if (QueueHeld)
+		{
+			return (uint32_t)Wait;
+		}
+		if (PollPosition)
+		{
+			ShortenWait(&Wait, TimerDeadline[static_cast<uint8_t>(TimerType::PollPosition)], Now);
+		}
+		for (uint8_t MotorIndex = 0; MotorIndex < MotorCount; ++MotorIndex)
+		{
+			if (MotorState[MotorIndex].PollStatus)
+			{
+				ShortenWait(&Wait, MotorState[MotorIndex].PollStatusNextTime, Now);
+			}
+			if (AnalogueSampler[MotorIndex].Enabled)
 			{
-				Serial.print("<SMCV>(Position poll ");
-				Serial.print(MotorIndex);
-				Serial.print(")\n");
+				ShortenWait(&Wait, AnalogueSampler[MotorIndex].NextTime, Now);
 			}
+			if (GPIOWatch[MotorIndex].Enabled)
+			{
+				ShortenWait(&Wait, GPIOWatch[MotorIndex].NextTime, Now);
+			}
+			if ( Jog[MotorIndex].Enabled && (Jog[MotorIndex].Velocity != 0.0) )
+			{
+				ShortenWait(&Wait, Jog[MotorIndex].NextTime, Now);
+			}
+		}
+	}
+	if (SequenceIsRunning())
+	{
+		const SequenceStep* Step = &Sequence[SequenceIndex];
+		if (Step->Wait == SequenceWaitType::Delay)
+		{
+			ShortenWait(&Wait, SequenceStepTime + Step->WaitTime, Now);
+		}
+		else if ( (Step->Wait == SequenceWaitType::GPIOHigh) || (Step->Wait == SequenceWaitType::GPIOLow) )
+		{
+			ShortenWait(&Wait, SequencePollTime + Config.PollStatusTimeInterval, Now);
+		}
+	}
+	return (uint32_t)Wait;
+}
+
+void SMC100Chained::ShortenWait(int32_t* Wait, uint32_t Deadline, uint32_t Now)
+{
+	int32_t Remaining = (int32_t)(Deadline - Now);
+	if (Remaining < 0)
+	{
+		Remaining = 0;
+	}
+	if (Remaining < *Wait)
+	{
+		*Wait = Remaining;
+	}
+}
+
+bool SMC100Chained::FindDueStatusPoll(uint8_t* MotorIndexReturn)
+{
+	//Searches from the axis after the last one polled so every polling axis gets its turn.
+	uint32_t Now = Transport->Micros();
+	for (uint8_t Offset = 0; Offset < MotorCount; ++Offset)
+	{
+		uint8_t MotorIndex = (PollNextMotorIndex + Offset) % MotorCount;
+		if ( MotorState[MotorIndex].PollStatus && ( (int32_t)(Now - MotorState[MotorIndex].PollStatusNextTime) >= 0 ) )
+		{
+			*MotorIndexReturn = MotorIndex;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool SMC100Chained::SchedulerPrefersPoll()
+{
+	//The first CommandWeight slots of each cycle go to queued commands, the following PollWeight slots to polls.
+	return (SchedulerSlot >= Config.SchedulerCommandWeight);
+}
+
+void SMC100Chained::SchedulerAdvance()
+{
+	SchedulerSlot++;
+	if (SchedulerSlot >= (Config.SchedulerCommandWeight + Config.SchedulerPollWeight))
+	{
+		SchedulerSlot = 0;
+	}
+}
+
+void SMC100Chained::SendStatusPoll(uint8_t MotorIndex)
+{
+	uint32_t Now = Transport->Micros();
+	uint32_t Jitter = Now - MotorState[MotorIndex].PollStatusNextTime;
+	Stats.Axes[MotorIndex].Polls++;
+	Stats.Axes[MotorIndex].PollJitterTotal += Jitter;
+	if (Jitter > Stats.Axes[MotorIndex].PollJitterMax)
+	{
+		Stats.Axes[MotorIndex].PollJitterMax = Jitter;
+	}
+	MotorState[MotorIndex].PollStatusNextTime += MotorState[MotorIndex].PollStatusInterval;
+	if ( (int32_t)(Now - MotorState[MotorIndex].PollStatusNextTime) >= 0 )
+	{
+		MotorState[MotorIndex].PollStatusNextTime = Now + MotorState[MotorIndex].PollStatusInterval;
+	}
+	PollNextMotorIndex = (MotorIndex + 1) % MotorCount;
+	LoadCurrentCommand(MotorIndex, CommandType::ErrorStatus, CommandGetSetType::Get, 0.0, CommandSourceType::StatusPoll);
+	Busy = true;
+	LogEvent(EventType::StatusPoll, MotorIndex, CommandType::ErrorStatus, CommandGetSetType::Get, 0.0);
+	SendCurrentCommand();
+}
+
+void SMC100Chained::PreparePositionPolling(uint8_t MotorIndex)
+{
+	PreparePositionPolling(MotorIndex, true);
+}
+
+void SMC100Chained::PreparePositionPolling(uint8_t MotorIndex, bool Enable)
+{
+	if (MotorIndex < MotorCount)
+	{
+		if (MotorState[MotorIndex].PollPosition != Enable)
+		{
+			EnqueuePositionRequest(MotorIndex);
+			MotorState[MotorIndex].PollPosition = Enable;
+			MotorState[MotorIndex].NeedToPollPosition = false;
+			PollPosition = Enable;
+			TimerStart(TimerType::PollPosition, Config.PollPositionTimeInterval);
+			LogEvent(EventType::PositionPoll, MotorIndex, CommandType::PositionReal, CommandGetSetType::Get, 0.0);
 		}
 	}
 	else
 	{
-		Serial.print("<SMCERROR>(Motor index too large for positon polling)");
+		Log("<SMCERROR>(Motor index too large for positon polling)");
 	}
 }
 
@@ -539,15 +1877,26 @@ void SMC100Chained::PollPositionRealNeededMotors()
 
 void SMC100Chained::CheckPositionPoll()
 {
-	if ( (micros() - PollPositionTimeLast) > PollPositionTimeInterval)
+	if (TimerExpired(TimerType::PollPosition))
 	{
 		PollPositionRealNeededMotors();
-		PollStatusTimeLast = micros();
+		TimerStart(TimerType::PollPosition, Config.PollPositionTimeInterval);
 	}
 }
 
+bool SMC100Chained::BusIsBusy()
+{
+	return ( (Mode == ModeType::Transmitting) || (Mode == ModeType::WaitForCommandReply) );
+}
+
 void SMC100Chained::ModeTransitionToIdle()
 {
+	if (BusIsBusy())
+	{
+		Stats.BusBusyTime += Transport->Micros() - BusBusyStartTime;
+	}
+	TimerStop(TimerType::Reply);
+	TimerStop(TimerType::Retry);
 	Mode = ModeType::Idle;
 }
 
@@ -555,11 +1904,87 @@ void SMC100Chained::ModeTransitionToWaitForReply()
 {
 	ReplyBufferIndex = 0;
 	ReplyBuffer[ReplyBufferIndex] = '\0';
+	//The deadline covers the worst case reply for this command on the wire plus the controller turnaround.
+	uint32_t ReplyTime = ( (uint32_t)CurrentCommand->ReplyLength * ByteTransmitTime ) + Config.ReplyTurnaroundTime;
+	TimerStart(TimerType::Reply, TransmitTime, ReplyTime);
 	Mode = ModeType::WaitForCommandReply;
 }
 
+void SMC100Chained::TimerStart(TimerType Timer, uint32_t Duration)
+{
+	TimerStart(Timer, Transport->Micros(), Duration);
+}
+
+void SMC100Chained::TimerStart(TimerType Timer, uint32_t StartTime, uint32_t Duration)
+{
+	TimerDeadline[static_cast<uint8_t>(Timer)] = StartTime + Duration;
+	TimerActive[static_cast<uint8_t>(Timer)] = true;
+}
+
+void SMC100Chained::TimerStop(TimerType Timer)
+{
+	TimerActive[static_cast<uint8_t>(Timer)] = false;
+}
+
+bool SMC100Chained::TimerPending(TimerType Timer)
+{
+	uint8_t Index = static_cast<uint8_t>(Timer);
+	return ( TimerActive[Index] && ( (int32_t)(Transport->Micros() - TimerDeadline[Index]) < 0 ) );
+}
+
+bool SMC100Chained::TimerExpired(TimerType Timer)
+{
+	//Signed difference keeps the comparison correct across the Transport->Micros() wraparound.
+	uint8_t Index = static_cast<uint8_t>(Timer);
+	return ( TimerActive[Index] && ( (int32_t)(Transport->Micros() - TimerDeadline[Index]) >= 0 ) );
+}
+
 void SMC100Chained::CheckCommandQueue()
 {
+	//A held queue starts nothing new, so several chains can be released on the same tick.
+	if (QueueHeld)
+	{
+		DiscardStrayInput();
+		return;
+	}
+	//Right after a release the queued commands go out before any poll.
+	bool QueueFirst = QueueReleased;
+	QueueReleased = false;
+	uint8_t MotorIndex = 0;
+	bool PollPreferred = ( !QueueFirst && ( CommandQueueEmpty() || SchedulerPrefersPoll() ) );
+	if ( PollPreferred && FindDueStatusPoll(&MotorIndex) )
+	{
+		SchedulerAdvance();
+		SendStatusPoll(MotorIndex);
+		return;
+	}
+	if ( PollPreferred && FindDueGPIOWatch(&MotorIndex) )
+	{
+		SchedulerAdvance();
+		SendGPIOWatchPoll(MotorIndex);
+		return;
+	}
+	if ( PollPreferred && FindDueAnalogueSample(&MotorIndex) )
+	{
+		SchedulerAdvance();
+		SendAnalogueSample(MotorIndex);
+		return;
+	}
+	//Jog steps take poll slots, so a held jog cannot keep queued commands for other axes off the wire.
+	if ( PollPreferred && FindDueJog(&MotorIndex) && SendJogStep(MotorIndex) )
+	{
+		SchedulerAdvance();
+		return;
+	}
+	if (!CommandQueueEmpty())
+	{
+		SchedulerAdvance();
+	}
+	else if (FindNextStreamMotor(&MotorIndex))
+	{
+		SendStreamSample(MotorIndex);
+		return;
+	}
 	bool NewCommandPulled = CommandQueuePullToCurrentCommand();
 	if (NewCommandPulled)
 	{
@@ -570,109 +1995,302 @@ void SMC100Chained::CheckCommandQueue()
 		}
 		else
 		{
-			Serial.print("<SMC100Chained>(Command in queue is null.)\n");
+			Log("<SMC100Chained>(Command in queue is null.)\n");
 		}
 	}
 	else
 	{
-		if ( (micros() - LastWipeTime) > WipeInputEvery )
+		DiscardStrayInput();
+	}
+}
+
+void SMC100Chained::DiscardStrayInput()
+{
+	//Nothing is outstanding while idle, so anything received is noise or a reply that came after its timeout.
+	if (Transport->Available())
+	{
+		ResyncInput();
+	}
+}
+
+void SMC100Chained::HoldQueue()
+{
+	QueueHeld = true;
+}
+
+void SMC100Chained::ReleaseQueue()
+{
+	if (QueueHeld)
+	{
+		QueueHeld = false;
+		QueueReleased = true;
+		CommandQueueMoveHeldToFront();
+	}
+}
+
+bool SMC100Chained::IsQueueHeld()
+{
+	return QueueHeld;
+}
+
+void SMC100Chained::DiscardHeldCommands()
+{
+	//Withdraws what was queued since the hold, so a group that could not be queued whole never starts in part.
+	uint8_t Offset = 0;
+	while (Offset < CommandQueueCount())
+	{
+		const CommandQueueEntry* Entry = &CommandQueue[(CommandQueueTail + Offset) % SMC100ChainedQueueCount];
+		if (!Entry->Held)
+		{
+			Offset++;
+			continue;
+		}
+		uint8_t MotorIndex = Entry->MotorIndex;
+		CommandQueueRemove(Offset);
+		if ( !CommandQueueHasMotor(MotorIndex) )
+		{
+			MotorState[MotorIndex].TargetPosition = MotorState[MotorIndex].Position;
+		}
+	}
+}
+
+bool SMC100Chained::LastEnqueueWasRejected()
+{
+	return LastEnqueueRejected;
+}
+
+bool SMC100Chained::IsIdle()
+{
+	return (Mode == ModeType::Idle);
+}
+
+uint8_t SMC100Chained::GetMotorCount()
+{
+	return MotorCount;
+}
+
+SMC100ChainedTransport* SMC100Chained::GetTransport()
+{
+	return Transport;
+}
+
+void SMC100Chained::CheckForCommandReply()
+{
+	//Takes everything already received up to the end of one line, so a reply never waits on later calls byte by byte.
+	while ( (Mode == ModeType::WaitForCommandReply) && (Transport->Available() > 0) )
+	{
+		int Received = Transport->Read();
+		if (Received < 0)
+		{
+			break;
+		}
+		char NewChar = (char)Received;
+		if (NewChar == CarriageReturnCharacter)
+		{
+
+		}
+		else if (NewChar == NewLineCharacter)
+		{
+			bool Discarded = ReplyDiscarding || (ReplyBufferIndex == 0);
+			ReplyBuffer[ReplyBufferIndex] = '\0';
+			ReplyBufferIndex = 0;
+			ReplyDiscarding = false;
+			if (Discarded)
+			{
+				continue;
+			}
+			//Taken before parsing, since a follow up TE send restarts the transmit times.
+			uint8_t MotorIndex = CurrentCommandMotorIndex;
+			uint32_t Latency = Transport->Micros() - TransmitTime;
+			uint32_t ReplyTime = CurrentReplyTime();
+			if (ParseReply())
+			{
+				RecordLatency(MotorIndex, Latency);
+				PublishSnapshot(MotorIndex, ReplyTime);
+				break;
+			}
+			//A line for some other command is dropped and the wait goes on, the right reply may still follow.
+			Stats.Resyncs++;
+		}
+		else if (!ReplyDiscarding)
 		{
-			LastWipeTime = micros();
-			if (SerialPort->available())
+			//One byte is always kept back for the terminator.
+			if (ReplyBufferIndex >= (SMC100ChainedReplyBufferSize - 1))
 			{
-				SerialPort->read();
+				ReplyBuffer[ReplyBufferIndex] = '\0';
+				Stats.Axes[CurrentCommandMotorIndex].BufferOverflows++;
+				Stats.Resyncs++;
+				Log("<SMC100Chained>(Error: Buffer overflow with ");
+				Log(ReplyBuffer);
+				Log(")\n");
+				ReplyDiscarding = true;
+				continue;
 			}
+			ReplyBuffer[ReplyBufferIndex] = NewChar;
+			ReplyBufferIndex++;
+		}
+	}
+	if ( (Mode == ModeType::WaitForCommandReply) && TimerExpired(TimerType::Reply) )
+	{
+		Stats.Axes[CurrentCommandMotorIndex].Timeouts++;
+		Stats.Commands[static_cast<uint8_t>(CurrentCommand->Command)].Timeouts++;
+		Log("<SMC200>(Time out detected.)\n");
+		HandleReplyFailure();
+	}
+}
+
+void SMC100Chained::HandleReplyFailure()
+{
+	ResyncInput();
+	if (CurrentCommandRetries < RetryLimitForCurrentCommand())
+	{
+		//Back off exponentially so a controller that is still busy gets time to answer before the resend.
+		//Doubling stops at RetryBackoffMax, which also keeps the shift defined for any retry count.
+		uint32_t RetryBackoffTime = Config.RetryBackoffTime;
+		for (uint8_t Retry = 0; (Retry < CurrentCommandRetries) && (RetryBackoffTime < RetryBackoffMax); ++Retry)
+		{
+			RetryBackoffTime = RetryBackoffTime << 1;
 		}
+		if (RetryBackoffTime > RetryBackoffMax)
+		{
+			RetryBackoffTime = RetryBackoffMax;
+		}
+		CurrentCommandRetries++;
+		Stats.Axes[CurrentCommandMotorIndex].Retries++;
+		ModeTransitionToIdle();
+		TimerStart(TimerType::Retry, RetryBackoffTime);
+		Mode = ModeType::RetryWait;
+		return;
+	}
+	ModeTransitionToIdle();
+	if (CurrentCommandIsSample())
+	{
+		return;
+	}
+	if (CurrentCommand->Command == CommandType::PositionReal)
+	{
+		//Otherwise a lost position reply would leave the axis waiting for move completion forever.
+		MotorState[CurrentCommandMotorIndex].PollPosition = false;
+		MotorState[CurrentCommandMotorIndex].NeedToPollPosition = true;
+	}
+	ReportCurrentOutcome(OutcomeType::TimedOut, NoErrorCharacter);
+	if (CommandFailedCallback != NULL)
+	{
+		CommandFailedCallback(CurrentCommandMotorIndex, CurrentCommand->Command);
+	}
+}
+
+uint8_t SMC100Chained::RetryLimitForCurrentCommand()
+{
+	//Only queries are idempotent, a lost set could already have been executed by the controller.
+	//Samples are not retried since the next sample follows right away.
+	if (CurrentCommandIsSample())
+	{
+		return 0;
+	}
+	if ( (CurrentCommandGetOrSet == CommandGetSetType::Get) || (CurrentCommand->GetSetType == CommandGetSetType::GetAlways) )
+	{
+		return Config.RetryCount;
 	}
+	return 0;
 }
 
-void SMC100Chained::CheckForCommandReply()
+void SMC100Chained::CheckRetryWait()
 {
-	if (SerialPort->available())
+	if (TimerExpired(TimerType::Retry))
 	{
-		char NewChar = SerialPort->read();
-		if (NewChar == CarriageReturnCharacter)
-		{
+		SendCurrentCommand();
+	}
+}
 
-		}
-		else if (NewChar == NewLineCharacter)
-		{
-			ReplyBuffer[ReplyBufferIndex] = '\0';
-			if (Verbose)
-			{
-				Serial.print("<SMCV>(Reply: ");
-				Serial.print(ReplyBuffer);
-				Serial.print(" )\n");
-			}
-			ParseReply();
-		}
-		else
-		{
-			ReplyBuffer[ReplyBufferIndex] = NewChar;
-			ReplyBufferIndex++;
-			if (ReplyBufferIndex > SMC100ChainedReplyBufferSize)
-			{
-				ReplyBuffer[SMC100ChainedReplyBufferSize-1] = '\0';
-				Serial.print("<SMC100Chained>(Error: Buffer overflow with ");
-				Serial.print(ReplyBuffer);
-				Serial.print(")\n");
-				ModeTransitionToIdle();
-			}
-		}
+void SMC100Chained::ResyncInput()
+{
+	ReplyBufferIndex = 0;
+	ReplyBuffer[ReplyBufferIndex] = '\0';
+	ReplyDiscarding = false;
+	uint32_t Discarded = 0;
+	while ( (Transport->Available() > 0) && (Transport->Read() >= 0) )
+	{
+		Discarded++;
 	}
-	if ( (micros() - TransmitTime) > CommandReplyTimeMax )
+	if (Discarded > 0)
 	{
-		ModeTransitionToIdle();
-		Serial.print("<SMC200>(Time out detected.)\n");
+		Stats.Resyncs++;
+		Stats.BytesDiscarded += Discarded;
 	}
 }
 
-void SMC100Chained::ParseReply()
+bool SMC100Chained::ParseReply()
 {
 	char* EndOfAddress;
 	char* ParameterAddress;
 	uint8_t AddressOfReply = strtol(ReplyBuffer, &EndOfAddress, 10);
 	if (AddressOfReply != CurrentCommandAddress)
 	{
-		Serial.print("<SMC100Chained>(Address does not match return for ");
-		Serial.print(ReplyBuffer);
-		Serial.print(")\n");
+		Stats.Axes[CurrentCommandMotorIndex].AddressMismatches++;
+		Log("<SMC100Chained>(Address does not match return for ");
+		Log(ReplyBuffer);
+		Log(")\n");
+		return false;
 	}
 	else if ( (CurrentCommand->CommandChar[0] != *EndOfAddress) || (CurrentCommand->CommandChar[1] != *(EndOfAddress + 1)) )
 	{
-		Serial.print("<SMC100Chained>(Return string expected ");
-		Serial.print(CurrentCommand->CommandChar[0]);
-		Serial.print(CurrentCommand->CommandChar[1]);
-		Serial.print(" but received ");
-		Serial.print(*EndOfAddress);
-		Serial.print(*(EndOfAddress + 1));
-		Serial.print(")\n");
+		Stats.Axes[CurrentCommandMotorIndex].MnemonicMismatches++;
+		Log("<SMC100Chained>(Return string expected ");
+		Log(CurrentCommand->CommandChar[0]);
+		Log(CurrentCommand->CommandChar[1]);
+		Log(" but received ");
+		Log(EndOfAddress);
+		Log(")\n");
+		return false;
+	}
+	else if ( ( (CurrentCommand->Command == CommandType::ErrorStatus) && (strlen(EndOfAddress + 2) < 6) ) || ( (CurrentCommand->Command == CommandType::ErrorCommands) && (*(EndOfAddress + 2) == '\0') ) )
+	{
+		//Status and error replies are read at fixed offsets, a short one would be parsed from stale bytes.
+		Log("<SMC100Chained>(Reply too short ");
+		Log(ReplyBuffer);
+		Log(")\n");
+		return false;
 	}
 	else
 	{
 		ParameterAddress = EndOfAddress + 2;
+		Stats.Axes[CurrentCommandMotorIndex].Replies++;
+		Stats.Commands[static_cast<uint8_t>(CurrentCommand->Command)].Replies++;
+		if (Verbose)
+		{
+			LogEvent(EventType::Reply, CurrentCommandMotorIndex, CurrentCommand->Command, CurrentCommandGetOrSet, atof(ParameterAddress));
+		}
 		//char* EndOfReplyData = ReplyData + ReplyBufferIndex;
 		if (CurrentCommand->Command == CommandType::PositionReal)
 		{
 			float Position = atof(ParameterAddress);
-			UpdatePosition(AddressOfReply, Position);
+			if (CurrentCommandSource == CommandSourceType::PositionStream)
+			{
+				PushPositionSample(CurrentCommandMotorIndex, Position);
+			}
+			else
+			{
+				UpdatePosition(AddressOfReply, Position);
+			}
 		}
 		else if (CurrentCommand->Command == CommandType::ErrorCommands)
 		{
 			if (*ParameterAddress != NoErrorCharacter)
 			{
-				Serial.print("<SMC100Chained>(Error code: ");
-				Serial.print(ConvertToErrorString(*ParameterAddress));
-				Serial.print(" motor: ");
-				Serial.print(AddressOfReply);
-				Serial.print(")\n");
+				Stats.Axes[CurrentCommandMotorIndex].CommandErrors++;
+				Log("<SMC100Chained>(Error code: ");
+				Log(ConvertToErrorString(*ParameterAddress));
+				Log(" motor: ");
+				Log(AddressOfReply);
+				Log(")\n");
 				UpdateCommandErrors(AddressOfReply, *ParameterAddress);
 			}
 		}
 		else if (CurrentCommand->Command == CommandType::ErrorStatus)
 		{
 			bool ErrorStatusFlag = false;
-			char ErrorCode[4];
+			char ErrorCode[5];
 			for (uint8_t Index = 0; Index < 4; Index++)
 			{
 				ErrorCode[Index] = *(ParameterAddress + Index);
@@ -681,14 +2299,25 @@ void SMC100Chained::ParseReply()
 					ErrorStatusFlag = true;
 				}
 			}
+			ErrorCode[4] = '\0';
+			//Only a change is reported, the same fault comes back with every status poll until it clears.
+			uint16_t HardwareErrors = (uint16_t)strtol(ErrorCode, NULL, 16);
+			if (HardwareErrors != MotorState[CurrentCommandMotorIndex].HardwareErrors)
+			{
+				MotorState[CurrentCommandMotorIndex].HardwareErrors = HardwareErrors;
+				if (HardwareErrors != 0)
+				{
+					ReportOutcome(CurrentCommandMotorIndex, CommandType::ErrorStatus, OutcomeType::HardwareFault, NoErrorCharacter);
+				}
+			}
 			if (ErrorStatusFlag)
 			{
-				Serial.print("<SMC100Chained>(Error hardware code: ");
-				Serial.print(ErrorCode);
-				Serial.print(" motor: ");
-				Serial.print(AddressOfReply);
-				Serial.print(")\n");
-				Mode = ModeType::Idle;
+				Log("<SMC100Chained>(Error hardware code: ");
+				Log(ErrorCode);
+				Log(" motor: ");
+				Log(AddressOfReply);
+				Log(")\n");
+				ModeTransitionToIdle();
 			}
 			char StatusChar[3];
 			StatusChar[0] = *(ParameterAddress + 4);
@@ -700,8 +2329,10 @@ void SMC100Chained::ParseReply()
 		else if (CurrentCommand->Command == CommandType::GPIOInput)
 		{
 			uint8_t GPIOInput = (uint8_t)atoi(ParameterAddress);
+			uint8_t GPIOPrevious = MotorState[CurrentCommandMotorIndex].GPIOInput;
 			UpdateGPIOInput(AddressOfReply, GPIOInput);
-			if (GPIOReturnCallback != NULL)
+			CheckGPIOEdges(CurrentCommandMotorIndex, GPIOPrevious, GPIOInput);
+			if ( (GPIOReturnCallback != NULL) && (CurrentCommandSource != CommandSourceType::GPIOWatch) )
 			{
 				GPIOReturnCallback();
 			}
@@ -710,6 +2341,10 @@ void SMC100Chained::ParseReply()
 		{
 			float AnalogueReading = atof(ParameterAddress);
 			UpdateAnalogue(AddressOfReply, AnalogueReading);
+			if (CurrentCommandSource == CommandSourceType::AnalogueSample)
+			{
+				AddAnalogueReading(CurrentCommandMotorIndex, AnalogueReading);
+			}
 		}
 		else if ( (CurrentCommand->Command == CommandType::LimitNegative) )
 		{
@@ -743,19 +2378,28 @@ void SMC100Chained::ParseReply()
 				UpdateAcceleration(AddressOfReply, Acceleration);
 			}
 		}
-		if ( (CurrentCommand->Command != CommandType::ErrorCommands) && (CurrentCommand->Command != CommandType::ErrorStatus) )
+		if ( (CurrentCommand->Command != CommandType::ErrorCommands) && (CurrentCommand->Command != CommandType::ErrorStatus) && !CurrentCommandIsSample() )
 		{
 			SendErrorCommands(CurrentCommandMotorIndex);
 		}
 		else
 		{
 			ModeTransitionToIdle();
+			if ( (CurrentCommand->Command == CommandType::ErrorCommands) && (*ParameterAddress != NoErrorCharacter) )
+			{
+				ReportCurrentOutcome(OutcomeType::ControllerError, *ParameterAddress);
+			}
+			else
+			{
+				ReportCurrentOutcome(OutcomeType::Completed, NoErrorCharacter);
+			}
 		}
 		if (CurrentCommandCompleteCallback != NULL)
 		{
 			CurrentCommandCompleteCallback();
 		}
 	}
+	return true;
 }
 
 bool SMC100Chained::ConvertMotorAddressToIndex(uint8_t Address, uint8_t* MotorIndexReturn)
@@ -838,6 +2482,11 @@ void SMC100Chained::UpdatePosition(uint8_t MotorAddress, float PositionToSet)
 	if (FoundMotor)
 	{
 		MotorState[MotorIndex].Position = PositionToSet;
+		StatusType Projected = ProjectedStatus(MotorIndex);
+		if ( !Jog[MotorIndex].Enabled && (Projected != StatusType::Moving) && (Projected != StatusType::Homing) )
+		{
+			MotorState[MotorIndex].TargetPosition = PositionToSet;
+		}
 		MotorState[MotorIndex].NeedToPollPosition = false;
 		MotorState[MotorIndex].PollPosition = false;
 		if (MotorState[MotorIndex].FinishedCallback != NULL)
@@ -881,6 +2530,20 @@ void SMC100Chained::CheckAllPollPosition()
 
 void SMC100Chained::UpdateCommandErrors(uint8_t MotorAddress, char ErrorChar)
 {
+	if (ErrorChar != NoErrorCharacter)
+	{
+		//The command was refused, so the state predicted when it was sent never happened.
+		uint8_t MotorIndex = 0;
+		if (ConvertMotorAddressToIndex(MotorAddress, &MotorIndex))
+		{
+			MotorState[MotorIndex].ExpectedStatus = MotorState[MotorIndex].Status;
+			//A refused move leaves the axis where it was, later relative moves and jog steps must not build on it.
+			if ( !CommandQueueHasMotor(MotorIndex) )
+			{
+				MotorState[MotorIndex].TargetPosition = MotorState[MotorIndex].Position;
+			}
+		}
+	}
 	if (ErrorChar == 'H')
 	{
 		uint8_t MotorIndex = 0;
@@ -899,9 +2562,10 @@ void SMC100Chained::UpdateStatus(uint8_t MotorAddress, StatusType Status)
 	if (FoundMotor)
 	{
 		MotorState[MotorIndex].Status = Status;
+		MotorState[MotorIndex].ExpectedStatus = Status;
 		if (Status == StatusType::Unknown)
 		{
-			Serial.print("<SMC100Chained>(Error status code not recognized)\n");
+			Log("<SMC100Chained>(Error status code not recognized)\n");
 		}
 		else if ( Status == StatusType::NoReference )
 		{
@@ -1008,63 +2672,147 @@ SMC100Chained::StatusType SMC100Chained::ConvertStatus(char* StatusChar)
 			return StatusLibrary[Index].Type;
 		}
 	}
-	Serial.print("<SMCError>(Unknown status code : ");
-	Serial.print(StatusChar);
-	Serial.print(")\n");
+	Log("<SMCError>(Unknown status code : ");
+	Log(StatusChar);
+	Log(")\n");
 	return StatusType::Unknown;
 }
 
 bool SMC100Chained::SendCurrentCommand()
 {
-	bool Status = true;
 	if (CurrentCommand->Command == CommandType::None)
 	{
-		Mode = ModeType::Idle;
-		Serial.print("<SMC100Chained>(Empty command requested.)");
+		ModeTransitionToIdle();
+		Log("<SMC100Chained>(Empty command requested.)");
+		return false;
+	}
+	bool Status = true;
+	uint8_t Length = RenderCurrentCommand(TransmitBuffer, &Status);
+	if (!Status)
+	{
+		//A line that could not be rendered is dropped whole, sending it would only put a malformed command on the bus.
+		Stats.Axes[CurrentCommandMotorIndex].RenderFailures++;
+		ModeTransitionToIdle();
+		Log("<SMCERROR>(Could not render ");
+		Log(CurrentCommand->CommandChar);
+		Log(" for motor ");
+		Log(CurrentCommandMotorIndex);
+		Log(")\n");
+		ReportCurrentOutcome(OutcomeType::NotSent, NoErrorCharacter);
+		if (CommandFailedCallback != NULL)
+		{
+			CommandFailedCallback(CurrentCommandMotorIndex, CurrentCommand->Command);
+		}
 		return false;
 	}
-	SerialPort->print(CurrentCommandAddress);
-	SerialPort->write(CurrentCommand->CommandChar[0]);
-	SerialPort->write(CurrentCommand->CommandChar[1]);
-	if (Verbose)
+	TransmitLength = Length;
+	TransmitIndex = 0;
+	LogEvent(EventType::Send, CurrentCommandMotorIndex, CurrentCommand->Command, CurrentCommandGetOrSet, CurrentCommandParameter);
+	Stats.Axes[CurrentCommandMotorIndex].Sent++;
+	Stats.Commands[static_cast<uint8_t>(CurrentCommand->Command)].Sent++;
+	ReplyBufferIndex = 0;
+	if (TimerPending(TimerType::WaitAfterSending))
 	{
-		Serial.print("<SMCV>(Send: ");
-		Serial.print(CurrentCommandAddress);
-		Serial.write(CurrentCommand->CommandChar[0]);
-		Serial.write(CurrentCommand->CommandChar[1]);
+		Mode = ModeType::WaitAfterSending;
+		return true;
 	}
-	if (CurrentCommandGetOrSet == CommandGetSetType::Get)
+	ModeTransitionToTransmitting();
+	CheckTransmit();
+	return true;
+}
+
+void SMC100Chained::CheckWaitAfterSending()
+{
+	if (!TimerPending(TimerType::WaitAfterSending))
 	{
-		//Serial.write(GetCharacter);
-		SerialPort->write(GetCharacter);
-		if (Verbose)
+		ModeTransitionToTransmitting();
+		CheckTransmit();
+	}
+}
+
+void SMC100Chained::ModeTransitionToTransmitting()
+{
+	//Whatever is still in the input now cannot be the reply to this command.
+	ResyncInput();
+	TransmitStartTime = Transport->Micros();
+	if (!BusIsBusy())
+	{
+		BusBusyStartTime = TransmitStartTime;
+	}
+	Mode = ModeType::Transmitting;
+}
+
+void SMC100Chained::CheckTransmit()
+{
+	//Only hands the port as many bytes as its transmit buffer can take so write() never blocks.
+	//Ports that do not report free space fall back to a single blocking write.
+	int TransmitRoom = Transport->AvailableForWrite();
+	if (TransmitRoom > TransmitRoomIdle)
+	{
+		TransmitRoomIdle = TransmitRoom;
+	}
+	if (TransmitIndex < TransmitLength)
+	{
+		uint8_t Remaining = TransmitLength - TransmitIndex;
+		if (TransmitRoomIdle == 0)
+		{
+			TransmitRoom = Remaining;
+		}
+		if (TransmitRoom > 0)
+		{
+			uint8_t ChunkLength = Remaining;
+			if (TransmitRoom < ChunkLength)
+			{
+				ChunkLength = (uint8_t)TransmitRoom;
+			}
+			//A short write leaves the rest for the next Check() instead of skipping bytes that never went out.
+			size_t Written = Transport->Write(reinterpret_cast<const uint8_t*>(TransmitBuffer + TransmitIndex), ChunkLength);
+			if (Written > ChunkLength)
+			{
+				Written = ChunkLength;
+			}
+			TransmitIndex += (uint8_t)Written;
+			TransmitRoom -= (int)Written;
+		}
+	}
+	if (TransmitIndex < TransmitLength)
+	{
+		return;
+	}
+	if ( (TransmitRoomIdle == 0) || (TransmitRoom >= TransmitRoomIdle) )
+	{
+		//The port buffer has drained, so the last byte is in the shift register and leaves one character time later.
+		TransmitTime = Transport->Micros() + ByteTransmitTime;
+		if (Config.WaitAfterSendingTime > 0)
 		{
-			Serial.write(GetCharacter);
+			TimerStart(TimerType::WaitAfterSending, TransmitTime, Config.WaitAfterSendingTime);
 		}
+		UpdateStateOnSending();
+	}
+}
+
+uint8_t SMC100Chained::RenderCurrentCommand(char* Buffer, bool* Status)
+{
+	uint8_t Length = FormatUnsigned(Buffer, CurrentCommandAddress);
+	Buffer[Length++] = CurrentCommand->CommandChar[0];
+	Buffer[Length++] = CurrentCommand->CommandChar[1];
+	if (CurrentCommandGetOrSet == CommandGetSetType::Get)
+	{
+		Buffer[Length++] = GetCharacter;
 	}
 	else if (CurrentCommandGetOrSet == CommandGetSetType::Set)
 	{
 		if (CurrentCommand->SendType == CommandParameterType::Int)
 		{
-			//Serial.print((int)(CurrentCommandParameter));
-			SerialPort->print((int)(CurrentCommandParameter));
-			if (Verbose)
-			{
-				Serial.print((int)(CurrentCommandParameter));
-			}
+			Length += FormatInt(Buffer + Length, (int32_t)(CurrentCommandParameter));
 		}
 		else if (CurrentCommand->SendType == CommandParameterType::Float)
 		{
-			//Serial.print(CurrentCommandParameter,6);
-			SerialPort->print(CurrentCommandParameter,6);
-			if (Verbose)
-			{
-				Serial.print(CurrentCommandParameter,6);
-			}
+			Length += FormatFloat(Buffer + Length, CurrentCommandParameter);
 		}
 		else
 		{
-			Status = false;
+			*Status = false;
 		}
 	}
 	else if ( (CurrentCommand->GetSetType == CommandGetSetType::None) || (CurrentCommand->GetSetType == CommandGetSetType::GetAlways) )
@@ -1073,25 +2821,88 @@ bool SMC100Chained::SendCurrentCommand()
 	}
 	else
 	{
-		Status = false;
-		Serial.print("<SMC11Error>(Command type not recognized.)");
+		*Status = false;
+		Log("<SMC11Error>(Command type not recognized.)");
+	}
+	Buffer[Length++] = CarriageReturnCharacter;
+	Buffer[Length++] = NewLineCharacter;
+	return Length;
+}
+
+uint8_t SMC100Chained::FormatUnsigned(char* Buffer, uint32_t Value)
+{
+	char Digits[10];
+	uint8_t DigitCount = 0;
+	do
+	{
+		Digits[DigitCount++] = '0' + (Value % 10);
+		Value = Value / 10;
+	} while (Value > 0);
+	for (uint8_t Index = 0; Index < DigitCount; ++Index)
+	{
+		Buffer[Index] = Digits[DigitCount - 1 - Index];
 	}
-	//Serial.print(NewLineCharacter);
-	SerialPort->write(CarriageReturnCharacter);
-	SerialPort->write(NewLineCharacter);
-	if (Verbose)
+	return DigitCount;
+}
+
+uint8_t SMC100Chained::FormatInt(char* Buffer, int32_t Value)
+{
+	if (Value < 0)
 	{
-		Serial.print(" )\n");
+		Buffer[0] = '-';
+		return 1 + FormatUnsigned(Buffer + 1, (uint32_t)(-(Value + 1)) + 1);
 	}
-	ReplyBufferIndex = 0;
-	TransmitTime = micros();
-	UpdateStateOnSending();
-	return Status;
+	return FormatUnsigned(Buffer, (uint32_t)Value);
+}
+
+uint8_t SMC100Chained::FormatFloat(char* Buffer, float Value)
+{
+	//Splits into integer and fixed point fraction with two float operations, the rest is integer only.
+	//Trailing zeros are dropped since the controller accepts any decimal form and shorter lines are sent faster.
+	uint8_t Length = 0;
+	if (isnan(Value))
+	{
+		Value = 0.0;
+	}
+	if (Value < 0.0)
+	{
+		Buffer[Length++] = '-';
+		Value = -Value;
+	}
+	if (Value > FormatFloatMax)
+	{
+		Value = FormatFloatMax;
+	}
+	uint32_t IntegerPart = (uint32_t)Value;
+	uint32_t FractionPart = (uint32_t)((Value - (float)IntegerPart) * (float)FormatFloatScale + 0.5);
+	if (FractionPart >= FormatFloatScale)
+	{
+		FractionPart -= FormatFloatScale;
+		IntegerPart++;
+	}
+	Length += FormatUnsigned(Buffer + Length, IntegerPart);
+	if (FractionPart > 0)
+	{
+		uint8_t DecimalCount = FormatFloatDecimals;
+		while ( (FractionPart % 10) == 0 )
+		{
+			FractionPart = FractionPart / 10;
+			DecimalCount--;
+		}
+		Buffer[Length++] = '.';
+		for (uint8_t Index = DecimalCount; Index > 0; --Index)
+		{
+			Buffer[Length + Index - 1] = '0' + (FractionPart % 10);
+			FractionPart = FractionPart / 10;
+		}
+		Length += DecimalCount;
+	}
+	return Length;
 }
 
 void SMC100Chained::UpdateStateOnSending()
 {
-	if ( (CurrentCommand->Command == CommandType::MoveAbs) || (CurrentCommand->Command == CommandType::MoveRel) )
+	if ( ( (CurrentCommand->Command == CommandType::MoveAbs) || (CurrentCommand->Command == CommandType::MoveRel) ) && (CurrentCommandSource != CommandSourceType::Jog) )
 	{
 		if (CurrentCommandGetOrSet == CommandGetSetType::Set)
 		{
@@ -1106,6 +2917,10 @@ void SMC100Chained::UpdateStateOnSending()
 		MotorState[CurrentCommandMotorIndex].NeedToPollPosition = true;
 		PrepareErrorStatusPolling(CurrentCommandMotorIndex);
 	}
+	if (CurrentCommandSource != CommandSourceType::Jog)
+	{
+		MotorState[CurrentCommandMotorIndex].ExpectedStatus = PredictStatus(MotorState[CurrentCommandMotorIndex].ExpectedStatus, CurrentCommand->Command, CurrentCommandGetOrSet, CurrentCommandParameter);
+	}
 	if (CurrentCommandGetOrSet == CommandGetSetType::Set)
 	{
 		if (CurrentCommand->Command == CommandType::Velocity)
@@ -1136,6 +2951,7 @@ void SMC100Chained::UpdateStateOnSending()
 	else
 	{
 		ModeTransitionToIdle();
+		ReportCurrentOutcome(OutcomeType::Completed, NoErrorCharacter);
 		if (CurrentCommandCompleteCallback != NULL)
 		{
 			CurrentCommandCompleteCallback();
@@ -1151,6 +2967,7 @@ void SMC100Chained::ClearCommandQueue()
 		CommandQueue[Index].Parameter = 0.0;
 		CommandQueue[Index].MotorIndex = 0;
 		CommandQueue[Index].GetOrSet = CommandGetSetType::None;
+		CommandQueue[Index].Held = false;
 	}
 	CommandQueueHead = 0;
 	CommandQueueTail = 0;
@@ -1217,73 +3034,315 @@ void SMC100Chained::EnqueuePositionRequest(uint8_t MotorIndex)
 void SMC100Chained::CommandEnqueue(uint8_t MotorIndex, CommandType Type, float Parameter, CommandGetSetType GetOrSet)
 {
 	const CommandStruct* CommandPointer = &CommandLibrary[static_cast<uint8_t>(Type)];
-	CommandEnqueue(MotorIndex, CommandPointer, Parameter, GetOrSet, NULL);
+	CommandEnqueue(MotorIndex, CommandPointer, Parameter, GetOrSet, NULL, Config.CommandLatencyBudget);
 }
 void SMC100Chained::CommandEnqueue(uint8_t MotorIndex, CommandType Type, float Parameter, CommandGetSetType GetOrSet, FinishedListener CommandCompleteCallback)
 {
 	const CommandStruct* CommandPointer = &CommandLibrary[static_cast<uint8_t>(Type)];
-	CommandEnqueue(MotorIndex, CommandPointer, Parameter, GetOrSet, CommandCompleteCallback);
+	CommandEnqueue(MotorIndex, CommandPointer, Parameter, GetOrSet, CommandCompleteCallback, Config.CommandLatencyBudget);
+}
+void SMC100Chained::CommandEnqueue(uint8_t MotorIndex, CommandType Type, float Parameter, CommandGetSetType GetOrSet, FinishedListener CommandCompleteCallback, uint32_t LatencyBudget)
+{
+	const CommandStruct* CommandPointer = &CommandLibrary[static_cast<uint8_t>(Type)];
+	CommandEnqueue(MotorIndex, CommandPointer, Parameter, GetOrSet, CommandCompleteCallback, LatencyBudget);
 }
-void SMC100Chained::CommandEnqueue(uint8_t MotorIndex, const CommandStruct* CommandPointer, float Parameter, CommandGetSetType GetOrSet, FinishedListener CommandCompleteCallback)
+void SMC100Chained::CommandEnqueue(uint8_t MotorIndex, const CommandStruct* CommandPointer, float Parameter, CommandGetSetType GetOrSet, FinishedListener CommandCompleteCallback, uint32_t LatencyBudget)
 {
+	//Every public and front end path ends up here, so this is where an out of range index is stopped before anything is indexed with it.
+	if (MotorIndex >= MotorCount)
+	{
+		PrintMotorIndexError();
+		LastEnqueueRejected = true;
+		RejectedCount++;
+		return;
+	}
+	char ErrorChar = CheckCommandAllowed(ProjectedStatus(MotorIndex), CommandPointer->Command, GetOrSet);
+	LastEnqueueRejected = (ErrorChar != NoErrorCharacter);
+	if (ErrorChar != NoErrorCharacter)
+	{
+		Stats.Axes[MotorIndex].CommandsRejected++;
+		RejectedCount++;
+		Log("<SMCERROR>(Motor ");
+		Log(MotorIndex);
+		Log(" rejected ");
+		Log(CommandPointer->CommandChar);
+		Log(": ");
+		Log(ConvertToErrorString(ErrorChar));
+		Log(")\n");
+		ReportOutcome(MotorIndex, CommandPointer->Command, OutcomeType::Rejected, ErrorChar);
+		if (CommandRejectedCallback != NULL)
+		{
+			CommandRejectedCallback(MotorIndex, CommandPointer->Command, ErrorChar);
+		}
+		return;
+	}
+	if (CommandQueueFull())
+	{
+		//The ring keeps the newest command and drops the oldest, which is worth knowing about since it may have been a move.
+		const CommandQueueEntry* Dropped = &CommandQueue[CommandQueueTail];
+		Stats.Axes[Dropped->MotorIndex].QueueOverflows++;
+		Log("<SMCERROR>(Queue full, dropped ");
+		Log(Dropped->Command->CommandChar);
+		Log(" for motor ");
+		Log(Dropped->MotorIndex);
+		Log(")\n");
+	}
 	CommandQueue[CommandQueueHead].Command = CommandPointer;
 	CommandQueue[CommandQueueHead].Parameter = Parameter;
 	CommandQueue[CommandQueueHead].MotorIndex = MotorIndex;
 	CommandQueue[CommandQueueHead].GetOrSet = GetOrSet;
 	CommandQueue[CommandQueueHead].CompleteCallback = CommandCompleteCallback;
-	if (Verbose)
-	{
-		Serial.print("<SMCV>(Enqueue ");
-		Serial.print(CommandQueue[CommandQueueHead].Command->CommandChar);
-		Serial.print(",");
-		Serial.print(MotorIndex);
-		Serial.print(",");
-		Serial.print(static_cast<uint8_t>(GetOrSet));
-		Serial.print(",");
-		Serial.print(Parameter);
-		Serial.print(")\n");
-	}
+	CommandQueue[CommandQueueHead].Deadline = Transport->Micros() + LatencyBudget;
+	CommandQueue[CommandQueueHead].Held = QueueHeld;
+	LogEvent(EventType::Enqueue, MotorIndex, CommandPointer->Command, GetOrSet, Parameter);
 	CommandQueueAdvance();
 }
-void SMC100Chained::SendErrorCommands(uint8_t MotorIndex)
+void SMC100Chained::LoadCurrentCommand(uint8_t MotorIndex, CommandType Type, CommandGetSetType GetOrSet, float Parameter, CommandSourceType Source)
 {
-	CurrentCommand = &CommandLibrary[static_cast<uint8_t>(CommandType::ErrorCommands)];
-	CurrentCommandParameter = 0.0;
-	CurrentCommandGetOrSet = CommandGetSetType::Get;
+	CurrentCommand = &CommandLibrary[static_cast<uint8_t>(Type)];
+	CurrentCommandParameter = Parameter;
+	CurrentCommandGetOrSet = GetOrSet;
 	CurrentCommandMotorIndex = MotorIndex;
-	CurrentCommandAddress = MotorState[CurrentCommandMotorIndex].Address;
+	CurrentCommandAddress = MotorState[MotorIndex].Address;
+	CurrentCommandCompleteCallback = NULL;
+	CurrentCommandSource = Source;
+	CurrentCommandRetries = 0;
+	FollowedCommand = CommandType::None;
+}
+void SMC100Chained::SendErrorCommands(uint8_t MotorIndex)
+{
+	//The TE follow up finishes the command before it, so that command's callback stays in place.
+	FinishedListener CompleteCallback = CurrentCommandCompleteCallback;
+	CommandType Followed = CurrentCommand->Command;
+	LoadCurrentCommand(MotorIndex, CommandType::ErrorCommands, CommandGetSetType::Get, 0.0, CommandSourceType::Queue);
+	CurrentCommandCompleteCallback = CompleteCallback;
+	FollowedCommand = Followed;
 	SendCurrentCommand();
 }
+void SMC100Chained::ReportOutcome(uint8_t MotorIndex, CommandType Command, OutcomeType Outcome, char Code)
+{
+	if (CommandOutcomeCallback != NULL)
+	{
+		CommandOutcomeCallback(CommandOutcomeContext, MotorIndex, Command, Outcome, Code);
+	}
+}
+void SMC100Chained::ReportCurrentOutcome(OutcomeType Outcome, char Code)
+{
+	//Polls and samples are the chain's own traffic, so only queued commands and jog steps are reported, a TE follow up under the command it checks.
+	if ( (CurrentCommandSource != CommandSourceType::Queue) && (CurrentCommandSource != CommandSourceType::Jog) )
+	{
+		return;
+	}
+	CommandType Command = (FollowedCommand != CommandType::None) ? FollowedCommand : CurrentCommand->Command;
+	ReportOutcome(CurrentCommandMotorIndex, Command, Outcome, Code);
+}
 bool SMC100Chained::CommandQueuePullToCurrentCommand()
 {
 	bool Status = false;
 	if (!CommandQueueEmpty())
 	{
-		CurrentCommand = CommandQueue[CommandQueueTail].Command;
-		CurrentCommandParameter = CommandQueue[CommandQueueTail].Parameter;
-		CurrentCommandGetOrSet = CommandQueue[CommandQueueTail].GetOrSet;
-		CurrentCommandMotorIndex = CommandQueue[CommandQueueTail].MotorIndex;
-		CurrentCommandAddress = MotorState[CurrentCommandMotorIndex].Address;
-		CurrentCommandCompleteCallback = CommandQueue[CommandQueueTail].CommandCompleteCallback;
-		CommandQueueRetreat();
+		uint8_t Offset = 0;
+		if (!CommandQueueEarliestDeadline(&Offset))
+		{
+			return false;
+		}
+		const CommandQueueEntry* Entry = &CommandQueue[(CommandQueueTail + Offset) % SMC100ChainedQueueCount];
+		LoadCurrentCommand(Entry->MotorIndex, Entry->Command->Command, Entry->GetOrSet, Entry->Parameter, CommandSourceType::Queue);
+		CurrentCommandCompleteCallback = Entry->CompleteCallback;
+		if ( (int32_t)(Transport->Micros() - Entry->Deadline) > 0 )
+		{
+			Stats.Axes[CurrentCommandMotorIndex].DeadlinesMissed++;
+		}
+		CommandQueueRemove(Offset);
 		Status = true;
-		if (Verbose)
+		LogEvent(EventType::Dequeue, CurrentCommandMotorIndex, CurrentCommand->Command, CurrentCommandGetOrSet, CurrentCommandParameter);
+		//Log("NP");
+		//Log(CurrentCommandParameter);
+		//Log("\n");
+	}
+	return Status;
+}
+bool SMC100Chained::CommandQueueHasMotor(uint8_t MotorIndex)
+{
+	uint8_t Count = CommandQueueCount();
+	for (uint8_t Offset = 0; Offset < Count; ++Offset)
+	{
+		if (CommandQueue[(CommandQueueTail + Offset) % SMC100ChainedQueueCount].MotorIndex == MotorIndex)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+bool SMC100Chained::CommandQueueEarliestDeadline(uint8_t* OffsetReturn)
+{
+	//Only the oldest entry of each axis is eligible, so commands to one axis always go out in the order they were queued.
+	uint32_t MotorsSeen = 0;
+	uint8_t BestOffset = 0;
+	bool BestFound = false;
+	uint8_t Count = CommandQueueCount();
+	for (uint8_t Offset = 0; Offset < Count; ++Offset)
+	{
+		const CommandQueueEntry* Entry = &CommandQueue[(CommandQueueTail + Offset) % SMC100ChainedQueueCount];
+		uint32_t MotorBit = 1UL << Entry->MotorIndex;
+		if (MotorsSeen & MotorBit)
+		{
+			continue;
+		}
+		MotorsSeen |= MotorBit;
+		if (CommandDeferred(Entry))
+		{
+			continue;
+		}
+		//Commands queued during a hold go ahead of everything else, so a released group is not held up by older work.
+		const CommandQueueEntry* Best = &CommandQueue[(CommandQueueTail + BestOffset) % SMC100ChainedQueueCount];
+		if ( !BestFound || (Entry->Held && !Best->Held) || ( (Entry->Held == Best->Held) && ( (int32_t)(Entry->Deadline - Best->Deadline) < 0 ) ) )
+		{
+			BestOffset = Offset;
+			BestFound = true;
+		}
+	}
+	*OffsetReturn = BestOffset;
+	return BestFound;
+}
+void SMC100Chained::CommandQueueMoveHeldToFront()
+{
+	//Each held entry is walked back past older ones, except an older set for the same axis, which has to reach the controller first.
+	uint8_t Count = CommandQueueCount();
+	for (uint8_t Offset = 1; Offset < Count; ++Offset)
+	{
+		for (uint8_t Index = Offset; Index > 0; --Index)
+		{
+			CommandQueueEntry* Entry = &CommandQueue[(CommandQueueTail + Index) % SMC100ChainedQueueCount];
+			CommandQueueEntry* Before = &CommandQueue[(CommandQueueTail + Index - 1) % SMC100ChainedQueueCount];
+			if ( !Entry->Held || Before->Held || ( (Before->MotorIndex == Entry->MotorIndex) && (Before->GetOrSet == CommandGetSetType::Set) ) )
+			{
+				break;
+			}
+			CommandQueueEntry Swap = *Entry;
+			*Entry = *Before;
+			*Before = Swap;
+		}
+	}
+}
+SMC100Chained::StatusType SMC100Chained::PredictStatus(StatusType Status, CommandType Command, CommandGetSetType GetOrSet, float Parameter)
+{
+	if (Command == CommandType::Home)
+	{
+		return StatusType::Homing;
+	}
+	if (Command == CommandType::Reset)
+	{
+		return StatusType::NoReference;
+	}
+	if (GetOrSet != CommandGetSetType::Set)
+	{
+		return Status;
+	}
+	if ( (Command == CommandType::MoveAbs) || (Command == CommandType::MoveRel) )
+	{
+		return StatusType::Moving;
+	}
+	if (Command == CommandType::Enable)
+	{
+		if (Parameter > 0.5)
+		{
+			return StatusType::Ready;
+		}
+		return StatusType::Disabled;
+	}
+	return Status;
+}
+SMC100Chained::StatusType SMC100Chained::ProjectedStatus(uint8_t MotorIndex)
+{
+	//Starts from the last known state and plays every command still queued for the axis over it.
+	StatusType Status = MotorState[MotorIndex].ExpectedStatus;
+	uint8_t Count = CommandQueueCount();
+	for (uint8_t Offset = 0; Offset < Count; ++Offset)
+	{
+		const CommandQueueEntry* Entry = &CommandQueue[(CommandQueueTail + Offset) % SMC100ChainedQueueCount];
+		if (Entry->MotorIndex == MotorIndex)
 		{
-			Serial.print("<SMCV>(Dequeue ");
-			Serial.print(CurrentCommand->CommandChar);
-			Serial.print(",");
-			Serial.print(CurrentCommandMotorIndex);
-			Serial.print(",");
-			Serial.print(CurrentCommandAddress);
-			Serial.print(",");
-			Serial.print(static_cast<uint8_t>(CurrentCommandGetOrSet));
-			Serial.print(",");
-			Serial.print(CurrentCommandParameter);
-			Serial.print(")\n");
-		}
-		//Serial.print("NP");
-		//Serial.print(CurrentCommandParameter);
-		//Serial.print("\n");
+			Status = PredictStatus(Status, Entry->Command->Command, Entry->GetOrSet, Entry->Parameter);
+		}
 	}
 	return Status;
 }
+char SMC100Chained::CheckCommandAllowed(StatusType Status, CommandType Command, CommandGetSetType GetOrSet)
+{
+	//Error codes match the TE replies the controller would give. Homing and moving end on their own, so commands that only wait on them are deferred rather than refused.
+	if ( (Status == StatusType::Unknown) || (Status == StatusType::Error) )
+	{
+		return NoErrorCharacter;
+	}
+	if (Command == CommandType::Home)
+	{
+		switch (Status)
+		{
+			case StatusType::Homing:
+				return 'E';
+			case StatusType::Disabled:
+				return 'J';
+			case StatusType::Ready:
+				return 'K';
+			case StatusType::Moving:
+				return 'M';
+			default:
+				return NoErrorCharacter;
+		}
+	}
+	if (GetOrSet != CommandGetSetType::Set)
+	{
+		return NoErrorCharacter;
+	}
+	if ( (Command == CommandType::MoveAbs) || (Command == CommandType::MoveRel) )
+	{
+		if (Status == StatusType::NoReference)
+		{
+			return 'H';
+		}
+		if (Status == StatusType::Disabled)
+		{
+			return 'J';
+		}
+	}
+	if (Command == CommandType::Enable)
+	{
+		if (Status == StatusType::NoReference)
+		{
+			return 'H';
+		}
+	}
+	return NoErrorCharacter;
+}
+bool SMC100Chained::CommandDeferred(const CommandQueueEntry* Entry)
+{
+	if (Entry->GetOrSet != CommandGetSetType::Set)
+	{
+		return false;
+	}
+	StatusType Status = MotorState[Entry->MotorIndex].ExpectedStatus;
+	CommandType Command = Entry->Command->Command;
+	if (Command == CommandType::MoveAbs)
+	{
+		return (Status == StatusType::Homing);
+	}
+	if (Command == CommandType::MoveRel)
+	{
+		//A relative step is taken from wherever the previous move ends, so it waits for that move to finish.
+		return ( (Status == StatusType::Homing) || (Status == StatusType::Moving) );
+	}
+	if (Command == CommandType::Enable)
+	{
+		return ( (Status == StatusType::Homing) || (Status == StatusType::Moving) );
+	}
+	return false;
+}
+void SMC100Chained::CommandQueueRemove(uint8_t Offset)
+{
+	for (uint8_t Index = Offset; Index > 0; --Index)
+	{
+		CommandQueue[(CommandQueueTail + Index) % SMC100ChainedQueueCount] = CommandQueue[(CommandQueueTail + Index - 1) % SMC100ChainedQueueCount];
+	}
+	CommandQueueRetreat();
+}
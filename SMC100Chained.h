@@ -1,14 +1,26 @@
 #ifndef SMC100Chained_h	//check for multiple inclusions
 #define SMC100Chained_h
 
-#include "Arduino.h"
+#include <stdint.h>
+#include <stddef.h>
+#include "SMC100ChainedTransport.h"
+#include "SMC100ChainedArduinoTransport.h"
 
 #define SMC100ChainedQueueCount 16
 #define SMC100ChainedMaxMotors 3
 #define SMC100ChainedReplyBufferSize 32
+#define SMC100ChainedTransmitBufferSize 32
+#define SMC100ChainedEventLogCount 16
+#define SMC100ChainedCommandTypeCount 20
+#define SMC100ChainedLatencyBucketCount 12
+#define SMC100ChainedStreamBufferCount 16
+#define SMC100ChainedAnalogueBufferCount 8
+#define SMC100ChainedSnapshotRetries 8
+#define SMC100ChainedMemoryBarrier() __atomic_thread_fence(__ATOMIC_SEQ_CST)
 
 class SMC100Chained
 {
+	friend class SMC100ChainedTestAccess;
 	public:
 		typedef void ( *FinishedListener )();
 		enum class CommandType : uint8_t
@@ -34,6 +46,18 @@ class SMC100Chained
 			ErrorCommands,
 			ErrorStatus,
 		};
+		typedef void ( *FailedListener )(uint8_t MotorIndex, CommandType Command);
+		typedef void ( *RejectedListener )(uint8_t MotorIndex, CommandType Command, char ErrorChar);
+		enum class OutcomeType : uint8_t
+		{
+			Completed,
+			TimedOut,
+			NotSent,
+			Rejected,
+			ControllerError,
+			HardwareFault,
+		};
+		typedef void ( *OutcomeListener )(void* Context, uint8_t MotorIndex, CommandType Command, OutcomeType Outcome, char Code);
 		enum class CommandParameterType : uint8_t
 		{
 			None,
@@ -65,7 +89,172 @@ class SMC100Chained
 		{
 			Inactive,
 			Idle,
+			Transmitting,
 			WaitForCommandReply,
+			RetryWait,
+			WaitAfterSending,
+		};
+		enum class CommandSourceType : uint8_t
+		{
+			Queue,
+			StatusPoll,
+			PositionStream,
+			AnalogueSample,
+			GPIOWatch,
+			Jog,
+		};
+		enum class TimerType : uint8_t
+		{
+			Reply,
+			Retry,
+			PollPosition,
+			WaitAfterSending,
+			Count,
+		};
+		enum class EventType : uint8_t
+		{
+			Enqueue,
+			Dequeue,
+			Send,
+			Reply,
+			StatusPoll,
+			PositionPoll,
+		};
+		struct EventRecord
+		{
+			uint32_t Time;
+			EventType Event;
+			uint8_t MotorIndex;
+			CommandType Command;
+			CommandGetSetType GetOrSet;
+			float Parameter;
+		};
+		struct CommandStats
+		{
+			uint16_t Sent;
+			uint16_t Replies;
+			uint16_t Timeouts;
+		};
+		struct AxisStats
+		{
+			uint16_t Sent;
+			uint16_t Replies;
+			uint16_t Timeouts;
+			uint16_t Retries;
+			uint16_t AddressMismatches;
+			uint16_t MnemonicMismatches;
+			uint16_t BufferOverflows;
+			uint16_t CommandErrors;
+			uint16_t QueueOverflows;
+			uint16_t RenderFailures;
+			uint16_t DeadlinesMissed;
+			uint16_t Polls;
+			uint32_t PollJitterTotal;
+			uint32_t PollJitterMax;
+			uint16_t StreamSamples;
+			uint16_t StreamOverruns;
+			uint16_t AnalogueSamples;
+			uint16_t AnalogueOverruns;
+			uint16_t GPIOEdges;
+			uint16_t CommandsRejected;
+			uint16_t LatencyHistogram[SMC100ChainedLatencyBucketCount];
+			uint32_t LatencyMax;
+		};
+		struct StatsStruct
+		{
+			AxisStats Axes[SMC100ChainedMaxMotors];
+			CommandStats Commands[SMC100ChainedCommandTypeCount];
+			uint32_t BusBusyTime;
+			uint32_t ElapsedTime;
+			uint16_t Resyncs;
+			uint32_t BytesDiscarded;
+		};
+		struct ConfigStruct
+		{
+			uint32_t BaudRate;
+			uint32_t ReplyTurnaroundTime;
+			uint8_t RetryCount;
+			uint32_t RetryBackoffTime;
+			uint32_t WaitAfterSendingTime;
+			uint32_t PollStatusTimeInterval;
+			uint32_t PollPositionTimeInterval;
+			uint32_t IdleCheckInterval;
+			uint8_t SchedulerCommandWeight;
+			uint8_t SchedulerPollWeight;
+			uint32_t CommandLatencyBudget;
+			uint32_t JogStepTime;
+		};
+		struct PositionSample
+		{
+			uint32_t Time;
+			float Position;
+		};
+		struct AxisSnapshot
+		{
+			uint32_t Time;
+			float Position;
+			StatusType Status;
+			bool HasBeenHomed;
+		};
+		struct AnalogueSample
+		{
+			uint32_t Time;
+			float Mean;
+			float Minimum;
+			float Maximum;
+		};
+		typedef void ( *AnalogueBlockListener )(uint8_t MotorIndex, uint8_t Count);
+		struct AnalogueSamplerState
+		{
+			bool Enabled;
+			uint32_t Interval;
+			uint32_t NextTime;
+			uint8_t Decimation;
+			uint8_t DecimationCount;
+			uint8_t BlockSize;
+			uint8_t BlockCount;
+			uint32_t FirstTime;
+			float Minimum;
+			float Maximum;
+			float Sum;
+		};
+		typedef void ( *GPIOEdgeListener )(uint8_t MotorIndex, uint8_t Pin, bool Rising, uint32_t Time);
+		struct GPIOWatchState
+		{
+			bool Enabled;
+			bool HavePrevious;
+			uint8_t PinMask;
+			uint8_t QuietPolls;
+			uint32_t FastInterval;
+			uint32_t SlowInterval;
+			uint32_t Interval;
+			uint32_t NextTime;
+		};
+		enum class SequenceWaitType : uint8_t
+		{
+			None,
+			Idle,
+			Stopped,
+			Delay,
+			GPIOHigh,
+			GPIOLow,
+		};
+		struct SequenceStep
+		{
+			CommandType Command;
+			CommandGetSetType GetOrSet;
+			uint8_t MotorIndex;
+			float Parameter;
+			SequenceWaitType Wait;
+			uint8_t WaitPin;
+			uint32_t WaitTime;
+		};
+		typedef void ( *SequenceListener )(bool Completed, uint8_t StepIndex);
+		struct JogState
+		{
+			bool Enabled;
+			float Velocity;
+			uint32_t NextTime;
 		};
 		struct CommandStruct
 		{
@@ -73,6 +262,7 @@ class SMC100Chained
 			const char* CommandChar;
 			CommandParameterType SendType;
 			CommandGetSetType GetSetType;
+			uint8_t ReplyLength;
 		};
 		struct CommandQueueEntry
 		{
@@ -81,6 +271,8 @@ class SMC100Chained
 			uint8_t MotorIndex;
 			float Parameter;
 			FinishedListener CompleteCallback;
+			uint32_t Deadline;
+			bool Held;
 		};
 		struct StatusCharSet
 		{
@@ -91,23 +283,51 @@ class SMC100Chained
 		{
 			uint8_t Address;
 			StatusType Status;
+			StatusType ExpectedStatus;
 			bool HasBeenHomed;
 			float Position;
+			float TargetPosition;
 			uint8_t GPIOInput;
 			uint8_t GPIOOutput;
+			uint16_t HardwareErrors;
 			float AnalogueReading;
 			float PositionLimitNegative;
 			float PositionLimitPositive;
 			float Velocity;
 			float Acceleration;
 			bool PollStatus;
+			uint32_t PollStatusInterval;
+			uint32_t PollStatusNextTime;
 			bool PollPosition;
 			bool NeedToPollPosition;
+			bool StreamPosition;
 			FinishedListener FinishedCallback;
 		};
+#if defined(ARDUINO)
 		SMC100Chained(HardwareSerial* serial, const uint8_t* addresses, const uint8_t addresscount);
+		SMC100Chained(HardwareSerial* serial, const uint8_t* addresses, const uint8_t addresscount, const ConfigStruct& config);
+#endif
+		SMC100Chained(SMC100ChainedTransport* transport, const uint8_t* addresses, const uint8_t addresscount);
+		SMC100Chained(SMC100ChainedTransport* transport, const uint8_t* addresses, const uint8_t addresscount, const ConfigStruct& config);
+		static ConfigStruct DefaultConfig(uint32_t BaudRate);
 		void Check();
+		uint32_t TimeUntilNextCheck();
+		void HoldQueue();
+		void ReleaseQueue();
+		bool IsQueueHeld();
+		void DiscardHeldCommands();
+		bool LastEnqueueWasRejected();
+		bool IsIdle();
+		uint8_t GetMotorCount();
+		bool AxisIsIdle(uint8_t MotorIndex);
+		bool AxisIsStopped(uint8_t MotorIndex);
+		uint32_t GetRejectedCount();
+		uint8_t GetQueueFree();
+		SMC100ChainedTransport* GetTransport();
 		void Begin();
+		void Begin(const ConfigStruct& ConfigToSet);
+		void SetConfig(const ConfigStruct& ConfigToSet);
+		void GetConfig(ConfigStruct* ConfigReturn);
 		bool IsHomed(uint8_t MotorIndex);
 		bool IsReady(uint8_t MotorIndex);
 		bool IsMoving(uint8_t MotorIndex);
@@ -116,8 +336,20 @@ class SMC100Chained
 		bool IsBusy();
 		void Home(uint8_t MotorIndex);
 		void MoveAbsolute(uint8_t MotorIndex, float Target);
+		void MoveAbsolute(uint8_t MotorIndex, float Target, uint32_t LatencyBudget);
+		void MoveRelative(uint8_t MotorIndex, float Distance);
+		void MoveRelative(uint8_t MotorIndex, float Distance, uint32_t LatencyBudget);
+		void StartJog(uint8_t MotorIndex, float Velocity);
+		void SetJogVelocity(uint8_t MotorIndex, float Velocity);
+		void StopJog(uint8_t MotorIndex);
+		bool RunSequence(const SequenceStep* Steps, uint8_t Count, SequenceListener Callback);
+		void AbortSequence();
+		bool SequenceIsRunning();
+		uint8_t GetSequenceStep();
 		void SetGPIOOutput(uint8_t MotorIndex, uint8_t Pin, bool Output);
+		void SetGPIOOutput(uint8_t MotorIndex, uint8_t Pin, bool Output, uint32_t LatencyBudget);
 		void SetGPIOOutputAll(uint8_t MotorIndex, uint8_t Code);
+		void SetGPIOOutputAll(uint8_t MotorIndex, uint8_t Code, uint32_t LatencyBudget);
 		void SendGetGPIOInput(uint8_t MotorIndex);
 		bool GetGPIOInput(uint8_t MotorIndex, uint8_t Pin);
 		void SetAxesCompleteCallback(uint8_t MotorIndex, FinishedListener Callback);
@@ -125,22 +357,72 @@ class SMC100Chained
 		void SetHomeCompleteCallback(FinishedListener Callback);
 		void SetMoveCompleteCallback(FinishedListener Callback);
 		void SetGPIOReturnCallback(FinishedListener Callback);
+		void SetCommandFailedCallback(FailedListener Callback);
+		void SetCommandRejectedCallback(RejectedListener Callback);
+		void SetCommandOutcomeCallback(OutcomeListener Callback, void* Context);
+		void SetRetryPolicy(uint8_t RetryCount, uint32_t BackoffTime);
+		void SetPollInterval(uint8_t MotorIndex, uint32_t Interval);
+		void StartPositionStream(uint8_t MotorIndex);
+		void StopPositionStream(uint8_t MotorIndex);
+		uint8_t ReadPositionStream(uint8_t MotorIndex, PositionSample* Samples, uint8_t MaxCount);
+		bool ReadSnapshot(uint8_t MotorIndex, AxisSnapshot* SnapshotReturn);
+		uint8_t ReadAllSnapshots(AxisSnapshot* SnapshotsReturn, uint8_t MaxCount);
+		uint32_t GetSnapshotSequence();
+		bool GetMotorStatus(uint8_t MotorIndex, MotorStatus* StatusReturn);
+		uint16_t GetHardwareErrors(uint8_t MotorIndex);
+		static const char* GetMnemonic(CommandType Command);
+		void SendGetAnalogue(uint8_t MotorIndex);
+		float GetAnalogue(uint8_t MotorIndex);
+		void StartAnalogueSampling(uint8_t MotorIndex, uint32_t Interval, uint8_t Decimation, uint8_t BlockSize);
+		void StopAnalogueSampling(uint8_t MotorIndex);
+		void SetAnalogueBlockCallback(AnalogueBlockListener Callback);
+		uint8_t ReadAnalogueSamples(uint8_t MotorIndex, AnalogueSample* Samples, uint8_t MaxCount);
+		void StartGPIOWatch(uint8_t MotorIndex, uint8_t PinMask, uint32_t FastInterval, uint32_t SlowInterval);
+		void StopGPIOWatch(uint8_t MotorIndex);
+		void SetGPIOEdgeCallback(GPIOEdgeListener Callback);
+		void SetSchedulerWeights(uint8_t CommandWeight, uint8_t PollWeight);
 		void SendGetPosition(uint8_t MotorIndex);
+		void SendGetPosition(uint8_t MotorIndex, uint32_t LatencyBudget);
 		float GetPosition(uint8_t MotorIndex);
 		void SetVerbose(bool VerboseToSet);
-		void SendGetVelocity(uint8_t MotorIndex, FinishedListener Callback);
-		void SendGetAcceleration(uint8_t MotorIndex, FinishedListener Callback);
-		void SendSetVelocity(uint8_t MotorIndex, float VelocityToSet, FinishedListener Callback);
-		void SendSetAcceleration(uint8_t MotorIndex, float AccelerationToSet, FinishedListener Callback);
+		bool ReadEvent(EventRecord* Record);
+		uint16_t GetEventsDropped();
+		void GetStats(StatsStruct* Snapshot);
+		void ResetStats();
+		void SendGetVelocity(uint8_t MotorIndex, FinishedListener Callback = NULL);
+		void SendGetAcceleration(uint8_t MotorIndex, FinishedListener Callback = NULL);
+		void SendSetVelocity(uint8_t MotorIndex, float VelocityToSet, FinishedListener Callback = NULL);
+		void SendSetAcceleration(uint8_t MotorIndex, float AccelerationToSet, FinishedListener Callback = NULL);
 		float GetVelocity(uint8_t MotorIndex);
 		float GetAcceleration(uint8_t MotorIndex);
 	private:
+		void Setup(SMC100ChainedTransport* transport, const uint8_t* addresses, const uint8_t addresscount, const ConfigStruct& config);
+		void Log(const char* Text);
+		void Log(char Character);
+		void Log(int Value);
+		void Log(unsigned int Value);
+		void Log(long Value);
+		void Log(unsigned long Value);
+		void Log(double Value);
+		static uint32_t ByteTransmitTimeFor(uint32_t BaudRate);
 		void PrintMotorIndexError();
+		void LogEvent(EventType Event, uint8_t MotorIndex, CommandType Command, CommandGetSetType GetOrSet, float Parameter);
+		void CheckEventLog();
+		void RecordLatency(uint8_t MotorIndex, uint32_t Latency);
 		void CheckCommandQueue();
 		void CheckForCommandReply();
+		void HandleReplyFailure();
+		uint8_t RetryLimitForCurrentCommand();
+		void CheckRetryWait();
+		void ResyncInput();
 		void CheckWaitAfterSending();
+		void CheckTransmit();
 		void ClearCommandQueue();
 		bool SendCurrentCommand();
+		uint8_t RenderCurrentCommand(char* Buffer, bool* Status);
+		static uint8_t FormatUnsigned(char* Buffer, uint32_t Value);
+		static uint8_t FormatInt(char* Buffer, int32_t Value);
+		static uint8_t FormatFloat(char* Buffer, float Value);
 		bool CommandQueueFull();
 		bool CommandQueueEmpty();
 		uint8_t CommandQueueCount();
@@ -148,25 +430,68 @@ class SMC100Chained
 		void CommandQueueRetreat();
 		void CommandEnqueue(uint8_t MotorIndex, CommandType Type, float Parameter, CommandGetSetType GetOrSet);
 		void CommandEnqueue(uint8_t MotorIndex, CommandType Type, float Parameter, CommandGetSetType GetOrSet, FinishedListener CommandCompleteCallback);
-		void CommandEnqueue(uint8_t MotorIndex, const CommandStruct* CommandPointer, float Parameter, CommandGetSetType GetOrSet, FinishedListener CommandCompleteCallback);
+		void CommandEnqueue(uint8_t MotorIndex, CommandType Type, float Parameter, CommandGetSetType GetOrSet, FinishedListener CommandCompleteCallback, uint32_t LatencyBudget);
+		void CommandEnqueue(uint8_t MotorIndex, const CommandStruct* CommandPointer, float Parameter, CommandGetSetType GetOrSet, FinishedListener CommandCompleteCallback, uint32_t LatencyBudget);
 		bool CommandQueuePullToCurrentCommand();
+		bool CommandQueueEarliestDeadline(uint8_t* OffsetReturn);
+		void CommandQueueMoveHeldToFront();
+		StatusType PredictStatus(StatusType Status, CommandType Command, CommandGetSetType GetOrSet, float Parameter);
+		StatusType ProjectedStatus(uint8_t MotorIndex);
+		char CheckCommandAllowed(StatusType Status, CommandType Command, CommandGetSetType GetOrSet);
+		bool CommandDeferred(const CommandQueueEntry* Entry);
+		bool CommandQueueHasMotor(uint8_t MotorIndex);
+		uint32_t EstimateMoveTime(uint8_t MotorIndex, float Distance);
+		bool FindDueJog(uint8_t* MotorIndexReturn);
+		bool SendJogStep(uint8_t MotorIndex);
+		bool CheckSequence();
+		bool DispatchSequenceStep(const SequenceStep* Step);
+		bool SequenceStepDone(const SequenceStep* Step);
+		void FinishSequence(bool Completed);
+		void CommandQueueRemove(uint8_t Offset);
 		void EnqueueGetLimitNegative(uint8_t MotorIndex);
 		void EnqueueGetLimitPositive(uint8_t MotorIndex);
 		void EnqueueErrorCommandRequest(uint8_t MotorIndex);
 		void EnqueueErrorStatusRequest(uint8_t MotorIndex);
 		void EnqueuePositionRequest(uint8_t MotorIndex);
 		StatusType ConvertStatus(char* StatusChar);
-		void ParseReply();
-		void CheckErrorStatusPoll();
+		bool ParseReply();
+		bool FindDueStatusPoll(uint8_t* MotorIndexReturn);
+		void ShortenWait(int32_t* Wait, uint32_t Deadline, uint32_t Now);
+		void DiscardStrayInput();
+		bool SchedulerPrefersPoll();
+		void SchedulerAdvance();
+		void SendStatusPoll(uint8_t MotorIndex);
+		bool FindNextStreamMotor(uint8_t* MotorIndexReturn);
+		void SendStreamSample(uint8_t MotorIndex);
+		void PushPositionSample(uint8_t MotorIndex, float Position);
+		void PublishSnapshot(uint8_t MotorIndex, uint32_t Time);
+		bool CurrentCommandIsSample();
+		bool FindDueAnalogueSample(uint8_t* MotorIndexReturn);
+		void SendAnalogueSample(uint8_t MotorIndex);
+		void AddAnalogueReading(uint8_t MotorIndex, float Reading);
+		uint32_t CurrentReplyTime();
+		bool FindDueGPIOWatch(uint8_t* MotorIndexReturn);
+		void SendGPIOWatchPoll(uint8_t MotorIndex);
+		void CheckGPIOEdges(uint8_t MotorIndex, uint8_t Previous, uint8_t Current);
 		void CheckPositionPoll();
 		void PrepareErrorStatusPolling(uint8_t MotorIndex);
 		void PrepareErrorStatusPolling(uint8_t MotorIndex, bool Enable);
 		void PreparePositionPolling(uint8_t MotorIndex);
 		void PreparePositionPolling(uint8_t MotorIndex, bool Enable);
 		void PollPositionRealNeededMotors();
+		bool BusIsBusy();
 		void ModeTransitionToIdle();
 		void ModeTransitionToWaitForReply();
+		void ModeTransitionToTransmitting();
+		void TimerStart(TimerType Timer, uint32_t Duration);
+		void TimerStart(TimerType Timer, uint32_t StartTime, uint32_t Duration);
+		void TimerStop(TimerType Timer);
+		bool TimerPending(TimerType Timer);
+		bool TimerExpired(TimerType Timer);
 		void UpdatePosition(uint8_t MotorIndex, float Position);
+		void UpdateVelocity(uint8_t MotorAddress, float VelocityToSet);
+		void UpdateAcceleration(uint8_t MotorAddress, float AccelerationToSet);
+		void UpdateAfterHoming();
 		void UpdateGPIOInput(uint8_t MotorAddress, uint8_t GPIOInputToSet);
 		void UpdatePositionLimitPositive(uint8_t MotorAddress, float PositionLimitPositiveToSet);
 		void UpdatePositionLimitNegative(uint8_t MotorAddress, float PositionLimitNegativeToSet);
@@ -176,46 +501,117 @@ class SMC100Chained
 		bool ConvertMotorAddressToIndex(uint8_t Address, uint8_t* MotorIndexReturn);
 		void CheckAllPollPosition();
 		void CheckAllPollStatus();
+		void LoadCurrentCommand(uint8_t MotorIndex, CommandType Type, CommandGetSetType GetOrSet, float Parameter, CommandSourceType Source);
 		void SendErrorCommands(uint8_t MotorIndex);
+		void ReportOutcome(uint8_t MotorIndex, CommandType Command, OutcomeType Outcome, char Code);
+		void ReportCurrentOutcome(OutcomeType Outcome, char Code);
 		void UpdateCommandErrors(uint8_t MotorIndex, char ErrorCode);
 		const char* ConvertToErrorString(char ErrorCode);
-		static const uint32_t PollStatusTimeInterval;
-		static const uint32_t PollPositionTimeInterval;
+		static const uint32_t PollStatusTimeIntervalDefault;
+		static const uint32_t PollPositionTimeIntervalDefault;
+		static const uint32_t JogStepTimeDefault;
 		static const CommandStruct CommandLibrary[];
 		static const StatusCharSet StatusLibrary[];
-		static const uint32_t CommandReplyTimeMax;
-		static const uint32_t WipeInputEvery;
+		static const char* const EventNames[];
+		static const int EventLogPrintSpace;
+		static const uint32_t LatencyBucketFirstLimit;
+		static const uint32_t ReplyProcessingTime;
+		static const uint8_t ReplyTurnaroundCharacters;
+		static const uint8_t RetryBackoffCharacters;
+		static const uint32_t IdleCheckIntervalDefault;
 		static const char CarriageReturnCharacter;
 		static const char NewLineCharacter;
 		static const char GetCharacter;
-		static const uint32_t WaitAfterSendingTimeMax;
+		static const uint8_t RetryCountDefault;
+		static const uint32_t RetryBackoffMax;
+		static const uint32_t CommandLatencyBudgetDefault;
 		static const char NoErrorCharacter;
+		static const uint32_t BaudRateDefault;
+		static const uint8_t FormatFloatDecimals;
+		static const uint32_t FormatFloatScale;
+		static const float FormatFloatMax;
+		static const uint8_t GPIOWatchQuietPolls;
 		MotorStatus MotorState[SMC100ChainedMaxMotors];
 		uint8_t MotorCount;
 		bool Busy;
 		bool Verbose;
+		EventRecord EventLog[SMC100ChainedEventLogCount];
+		uint8_t EventLogTail;
+		uint8_t EventLogCount;
+		uint16_t EventLogDropped;
+		uint16_t EventLogDroppedReported;
+		StatsStruct Stats;
+		uint32_t StatsResetTime;
+		uint32_t BusBusyStartTime;
 		ModeType Mode;
-		HardwareSerial* SerialPort;
+		SMC100ChainedTransport* Transport;
+#if defined(ARDUINO)
+		SMC100ChainedArduinoTransport ArduinoTransport;
+#endif
 		FinishedListener AllCompleteCallback;
 		FinishedListener MoveCompleteCallback;
 		FinishedListener HomeCompleteCallback;
 		FinishedListener GPIOReturnCallback;
 		FinishedListener CurrentCommandCompleteCallback;
+		FailedListener CommandFailedCallback;
+		ConfigStruct Config;
+		uint32_t ByteTransmitTime;
+		uint8_t CurrentCommandRetries;
 		bool NeedToFireMoveComplete;
 		bool NeedToFireHomeComplete;
 		bool PollStatus;
 		bool PollPosition;
+		uint8_t PollNextMotorIndex;
+		uint8_t SchedulerSlot;
+		uint8_t StreamNextMotorIndex;
+		PositionSample StreamSamples[SMC100ChainedMaxMotors][SMC100ChainedStreamBufferCount];
+		volatile uint8_t StreamHead[SMC100ChainedMaxMotors];
+		volatile uint8_t StreamTail[SMC100ChainedMaxMotors];
+		AxisSnapshot Snapshots[SMC100ChainedMaxMotors];
+		volatile uint32_t SnapshotSequence;
+		uint8_t AnalogueNextMotorIndex;
+		AnalogueSamplerState AnalogueSampler[SMC100ChainedMaxMotors];
+		AnalogueSample AnalogueSamples[SMC100ChainedMaxMotors][SMC100ChainedAnalogueBufferCount];
+		volatile uint8_t AnalogueHead[SMC100ChainedMaxMotors];
+		volatile uint8_t AnalogueTail[SMC100ChainedMaxMotors];
+		AnalogueBlockListener AnalogueBlockCallback;
+		uint8_t GPIOWatchNextMotorIndex;
+		GPIOWatchState GPIOWatch[SMC100ChainedMaxMotors];
+		GPIOEdgeListener GPIOEdgeCallback;
+		RejectedListener CommandRejectedCallback;
+		OutcomeListener CommandOutcomeCallback;
+		void* CommandOutcomeContext;
+		CommandType FollowedCommand;
+		uint8_t JogNextMotorIndex;
+		JogState Jog[SMC100ChainedMaxMotors];
+		const SequenceStep* Sequence;
+		uint8_t SequenceCount;
+		uint8_t SequenceIndex;
+		bool SequenceWaiting;
+		uint32_t SequenceStepTime;
+		uint32_t SequencePollTime;
+		SequenceListener SequenceCallback;
+		bool LastEnqueueRejected;
+		bool QueueHeld;
+		bool QueueReleased;
+		uint32_t RejectedCount;
+		CommandSourceType CurrentCommandSource;
 		const CommandStruct* CurrentCommand;
 		CommandGetSetType CurrentCommandGetOrSet;
 		float CurrentCommandParameter;
 		uint8_t CurrentCommandAddress;
 		uint8_t CurrentCommandMotorIndex;
-		uint32_t LastWipeTime;
 		uint32_t TransmitTime;
+		uint32_t TransmitStartTime;
 		uint8_t ReplyBufferIndex;
-		uint32_t PollStatusTimeLast;
-		uint32_t PollPositionTimeLast;
+		bool ReplyDiscarding;
+		uint32_t TimerDeadline[static_cast<uint8_t>(TimerType::Count)];
+		bool TimerActive[static_cast<uint8_t>(TimerType::Count)];
 		char ReplyBuffer[SMC100ChainedReplyBufferSize];
+		char TransmitBuffer[SMC100ChainedTransmitBufferSize];
+		uint8_t TransmitLength;
+		uint8_t TransmitIndex;
+		int TransmitRoomIdle;
 		CommandQueueEntry CommandQueue[SMC100ChainedQueueCount];
 		uint8_t CommandQueueHead;
 		uint8_t CommandQueueTail;
@@ -0,0 +1,58 @@
+#include "SMC100ChainedArduinoTransport.h"
+
+#if defined(ARDUINO)
+
+SMC100ChainedArduinoTransport::SMC100ChainedArduinoTransport(HardwareSerial* serial, Print* logport)
+{
+	SerialPort = serial;
+	LogPort = logport;
+}
+
+void SMC100ChainedArduinoTransport::Begin(uint32_t BaudRate)
+{
+	SerialPort->begin(BaudRate);
+}
+
+int SMC100ChainedArduinoTransport::Available()
+{
+	return SerialPort->available();
+}
+
+int SMC100ChainedArduinoTransport::Read()
+{
+	return SerialPort->read();
+}
+
+size_t SMC100ChainedArduinoTransport::Write(const uint8_t* Data, size_t Length)
+{
+	return SerialPort->write(Data, Length);
+}
+
+int SMC100ChainedArduinoTransport::AvailableForWrite()
+{
+	return SerialPort->availableForWrite();
+}
+
+uint32_t SMC100ChainedArduinoTransport::Micros()
+{
+	return micros();
+}
+
+void SMC100ChainedArduinoTransport::Log(const char* Text)
+{
+	if (LogPort != NULL)
+	{
+		LogPort->print(Text);
+	}
+}
+
+int SMC100ChainedArduinoTransport::LogAvailableForWrite()
+{
+	if (LogPort == NULL)
+	{
+		return SMC100ChainedArduinoTransportLogRoomUnlimited;
+	}
+	return LogPort->availableForWrite();
+}
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef SMC100ChainedArduinoTransport_h	//check for multiple inclusions
+#define SMC100ChainedArduinoTransport_h
+
+#if defined(ARDUINO)
+
+#include "Arduino.h"
+#include "SMC100ChainedTransport.h"
+
+#define SMC100ChainedArduinoTransportLogRoomUnlimited 1024
+
+class SMC100ChainedArduinoTransport : public SMC100ChainedTransport
+{
+	public:
+		SMC100ChainedArduinoTransport(HardwareSerial* serial = NULL, Print* logport = NULL);
+		void Begin(uint32_t BaudRate);
+		int Available();
+		int Read();
+		size_t Write(const uint8_t* Data, size_t Length);
+		int AvailableForWrite();
+		uint32_t Micros();
+		void Log(const char* Text);
+		int LogAvailableForWrite();
+	private:
+		HardwareSerial* SerialPort;
+		Print* LogPort;
+};
+
+#endif
+
+#endif
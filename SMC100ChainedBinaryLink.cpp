@@ -0,0 +1,469 @@
+#include "SMC100ChainedBinaryLink.h"
+
+SMC100ChainedBinaryLink::SMC100ChainedBinaryLink(SMC100ChainedTransport* bus, SMC100ChainedTransport* host)
+{
+	Bus = bus;
+	Host = host;
+	Chain = NULL;
+	Sequence = 0;
+	FramesDropped = 0;
+	EventPending = false;
+	PublishedSnapshotSequence = 0;
+	for (uint8_t Index = 0; Index < SMC100ChainedMaxMotors; ++Index)
+	{
+		PublishedTime[Index] = 0;
+	}
+	PendingErrorHead = 0;
+	PendingErrorCount = 0;
+	StatsMotorIndex = 0;
+	StatsPart = 0;
+	LogLine[0] = '\0';
+	LogLineLength = 0;
+}
+
+void SMC100ChainedBinaryLink::Attach(SMC100Chained* chain)
+{
+	//The chain is built on this link as its transport, so it can only be attached once both exist.
+	Chain = chain;
+	PublishedSnapshotSequence = Chain->GetSnapshotSequence();
+	Chain->SetCommandOutcomeCallback(HandleOutcome, this);
+}
+
+void SMC100ChainedBinaryLink::Check()
+{
+	//Call before the chain's Check() so typed events are taken before the text event log would print them.
+	if (Chain == NULL)
+	{
+		return;
+	}
+	CheckHostInput();
+	CheckErrors();
+	CheckEvents();
+	CheckSnapshots();
+	CheckStats();
+}
+
+void SMC100ChainedBinaryLink::HandleOutcome(void* Context, uint8_t MotorIndex, SMC100Chained::CommandType Command, SMC100Chained::OutcomeType Outcome, char Code)
+{
+	//Runs inside the chain's Check(), so the error is only queued here and framed once the host has room.
+	SMC100ChainedBinaryLink* Link = static_cast<SMC100ChainedBinaryLink*>(Context);
+	SMC100ChainedProtocol::ErrorKind Kind;
+	switch (Outcome)
+	{
+		case SMC100Chained::OutcomeType::TimedOut:
+			Kind = SMC100ChainedProtocol::ErrorKind::Timeout;
+			break;
+		case SMC100Chained::OutcomeType::NotSent:
+			Kind = SMC100ChainedProtocol::ErrorKind::NotSent;
+			break;
+		case SMC100Chained::OutcomeType::Rejected:
+			Kind = SMC100ChainedProtocol::ErrorKind::Rejected;
+			break;
+		case SMC100Chained::OutcomeType::ControllerError:
+			Kind = SMC100ChainedProtocol::ErrorKind::ControllerError;
+			break;
+		case SMC100Chained::OutcomeType::HardwareFault:
+			Kind = SMC100ChainedProtocol::ErrorKind::HardwareFault;
+			break;
+		default:
+			return;
+	}
+	if (Link->PendingErrorCount >= SMC100ChainedBinaryLinkErrorCount)
+	{
+		Link->FramesDropped++;
+		return;
+	}
+	uint8_t Index = (Link->PendingErrorHead + Link->PendingErrorCount) % SMC100ChainedBinaryLinkErrorCount;
+	SMC100ChainedProtocol::ErrorMessage* Error = &Link->PendingErrors[Index];
+	const char* Mnemonic = SMC100Chained::GetMnemonic(Command);
+	Error->MotorIndex = MotorIndex;
+	Error->Command[0] = Mnemonic[0];
+	Error->Command[1] = Mnemonic[1];
+	Error->Kind = Kind;
+	Error->Code = Code;
+	Error->Fault = (Outcome == SMC100Chained::OutcomeType::HardwareFault) ? Link->Chain->GetHardwareErrors(MotorIndex) : 0;
+	Link->PendingErrorCount++;
+}
+
+void SMC100ChainedBinaryLink::CheckErrors()
+{
+	uint8_t Frame[SMC100ChainedProtocolMaxEncoded];
+	while (PendingErrorCount > 0)
+	{
+		size_t Length = SMC100ChainedProtocol::BuildError(Sequence, PendingErrors[PendingErrorHead], Frame);
+		if (Host->AvailableForWrite() < (int)Length)
+		{
+			return;
+		}
+		SendFrame(Frame, Length);
+		PendingErrorHead = (PendingErrorHead + 1) % SMC100ChainedBinaryLinkErrorCount;
+		PendingErrorCount--;
+	}
+}
+
+void SMC100ChainedBinaryLink::CheckHostInput()
+{
+	while (Host->Available() > 0)
+	{
+		int Byte = Host->Read();
+		if (Byte < 0)
+		{
+			return;
+		}
+		if (HostDecoder.Push((uint8_t)Byte))
+		{
+			HandleMessage(HostDecoder.GetMessage());
+		}
+	}
+}
+
+void SMC100ChainedBinaryLink::HandleMessage(const SMC100ChainedProtocol::Message& Incoming)
+{
+	uint8_t Frame[SMC100ChainedProtocolMaxEncoded];
+	switch (Incoming.Type)
+	{
+		case SMC100ChainedProtocol::MessageType::Command:
+		{
+			SMC100ChainedProtocol::AckMessage Ack;
+			Ack.CommandSequence = Incoming.Sequence;
+			Ack.Accepted = Dispatch(Incoming.Command);
+			SendFrame(Frame, SMC100ChainedProtocol::BuildAck(Sequence, Ack, Frame));
+			break;
+		}
+		case SMC100ChainedProtocol::MessageType::RequestStats:
+			SendStats(Incoming.MotorIndex);
+			break;
+		case SMC100ChainedProtocol::MessageType::RequestSnapshots:
+			SendSnapshots();
+			break;
+		default:
+			break;
+	}
+}
+
+bool SMC100ChainedBinaryLink::Dispatch(const SMC100ChainedProtocol::CommandMessage& Command)
+{
+	if (Command.MotorIndex >= Chain->GetMotorCount())
+	{
+		return false;
+	}
+	uint32_t RejectedBefore = Chain->GetRejectedCount();
+	switch (Command.Request)
+	{
+		case SMC100ChainedProtocol::RequestType::Home:
+			Chain->Home(Command.MotorIndex);
+			break;
+		case SMC100ChainedProtocol::RequestType::Enable:
+			Chain->Enable(Command.MotorIndex, (Command.Parameter > 0.5));
+			break;
+		case SMC100ChainedProtocol::RequestType::MoveAbsolute:
+			Chain->MoveAbsolute(Command.MotorIndex, Command.Parameter);
+			break;
+		case SMC100ChainedProtocol::RequestType::MoveRelative:
+			Chain->MoveRelative(Command.MotorIndex, Command.Parameter);
+			break;
+		case SMC100ChainedProtocol::RequestType::SetVelocity:
+			Chain->SendSetVelocity(Command.MotorIndex, Command.Parameter);
+			break;
+		case SMC100ChainedProtocol::RequestType::SetAcceleration:
+			Chain->SendSetAcceleration(Command.MotorIndex, Command.Parameter);
+			break;
+		case SMC100ChainedProtocol::RequestType::GetPosition:
+			Chain->SendGetPosition(Command.MotorIndex);
+			break;
+		case SMC100ChainedProtocol::RequestType::StartJog:
+			Chain->StartJog(Command.MotorIndex, Command.Parameter);
+			break;
+		case SMC100ChainedProtocol::RequestType::StopJog:
+			Chain->StopJog(Command.MotorIndex);
+			break;
+		default:
+			return false;
+	}
+	return (Chain->GetRejectedCount() == RejectedBefore);
+}
+
+void SMC100ChainedBinaryLink::CheckEvents()
+{
+	//The frame is built before the room check because the worst case encoded size is larger than some UART buffers, AVR reports only 63 bytes.
+	//An event taken from the log that does not fit yet is kept and retried on the next call.
+	uint8_t Frame[SMC100ChainedProtocolMaxEncoded];
+	while (true)
+	{
+		if (!EventPending)
+		{
+			if (!Chain->ReadEvent(&PendingEvent))
+			{
+				return;
+			}
+			EventPending = true;
+		}
+		SMC100ChainedProtocol::EventMessage Event;
+		Event.Time = PendingEvent.Time;
+		Event.Event = static_cast<uint8_t>(PendingEvent.Event);
+		Event.MotorIndex = PendingEvent.MotorIndex;
+		Event.Command = static_cast<uint8_t>(PendingEvent.Command);
+		Event.GetOrSet = static_cast<uint8_t>(PendingEvent.GetOrSet);
+		Event.Parameter = PendingEvent.Parameter;
+		size_t Length = SMC100ChainedProtocol::BuildEvent(Sequence, Event, Frame);
+		if (Host->AvailableForWrite() < (int)Length)
+		{
+			return;
+		}
+		SendFrame(Frame, Length);
+		EventPending = false;
+	}
+}
+
+void SMC100ChainedBinaryLink::CheckSnapshots()
+{
+	//Only axes whose reply time moved since the last frame are sent, so an idle chain costs no bandwidth.
+	uint32_t SnapshotSequence = Chain->GetSnapshotSequence();
+	if (SnapshotSequence == PublishedSnapshotSequence)
+	{
+		return;
+	}
+	SMC100Chained::AxisSnapshot Snapshots[SMC100ChainedMaxMotors];
+	uint8_t Count = Chain->ReadAllSnapshots(Snapshots, SMC100ChainedMaxMotors);
+	if (Count == 0)
+	{
+		return;
+	}
+	uint8_t Frame[SMC100ChainedProtocolMaxEncoded];
+	for (uint8_t Index = 0; Index < Count; ++Index)
+	{
+		if (Snapshots[Index].Time == PublishedTime[Index])
+		{
+			continue;
+		}
+		SMC100ChainedProtocol::SnapshotMessage Snapshot;
+		Snapshot.MotorIndex = Index;
+		Snapshot.Time = Snapshots[Index].Time;
+		Snapshot.Position = Snapshots[Index].Position;
+		Snapshot.Status = static_cast<uint8_t>(Snapshots[Index].Status);
+		Snapshot.HasBeenHomed = Snapshots[Index].HasBeenHomed;
+		size_t Length = SMC100ChainedProtocol::BuildSnapshot(Sequence, Snapshot, Frame);
+		if (Host->AvailableForWrite() < (int)Length)
+		{
+			//Try again next call, the sequence is left stale so the remaining axes are not lost.
+			return;
+		}
+		SendFrame(Frame, Length);
+		PublishedTime[Index] = Snapshots[Index].Time;
+	}
+	PublishedSnapshotSequence = SnapshotSequence;
+}
+
+void SMC100ChainedBinaryLink::SendSnapshots()
+{
+	for (uint8_t Index = 0; Index < SMC100ChainedMaxMotors; ++Index)
+	{
+		PublishedTime[Index] = PublishedTime[Index] - 1;
+	}
+	PublishedSnapshotSequence = Chain->GetSnapshotSequence() - 1;
+	CheckSnapshots();
+}
+
+void SMC100ChainedBinaryLink::SendStats(uint8_t MotorIndex)
+{
+	if ( (Chain == NULL) || (MotorIndex >= Chain->GetMotorCount()) )
+	{
+		return;
+	}
+	StatsMotorIndex = MotorIndex;
+	StatsPart = 1;
+	CheckStats();
+}
+
+void SMC100ChainedBinaryLink::CheckStats()
+{
+	//The full counter set is larger than one frame, the parts go out in order and those that do not fit wait for the next call.
+	if (StatsPart == 0)
+	{
+		return;
+	}
+	SMC100Chained::StatsStruct Snapshot;
+	Chain->GetStats(&Snapshot);
+	uint8_t Frame[SMC100ChainedProtocolMaxEncoded];
+	while (StatsPart != 0)
+	{
+		size_t Length = BuildStatsPart(Snapshot, StatsPart, Frame);
+		if (Host->AvailableForWrite() < (int)Length)
+		{
+			return;
+		}
+		SendFrame(Frame, Length);
+		StatsPart++;
+		if (StatsPart > 3 + SMC100ChainedBinaryLinkCommandStatsFrames)
+		{
+			StatsPart = 0;
+		}
+	}
+}
+
+size_t SMC100ChainedBinaryLink::BuildStatsPart(const SMC100Chained::StatsStruct& Snapshot, uint8_t Part, uint8_t* Frame)
+{
+	//Part 1 is the axis counters, 2 its latency histogram, 3 the chain totals and the rest the per command counters.
+	const SMC100Chained::AxisStats* Axis = &Snapshot.Axes[StatsMotorIndex];
+	if (Part == 1)
+	{
+		SMC100ChainedProtocol::StatsMessage Stats;
+		Stats.MotorIndex = StatsMotorIndex;
+		Stats.Sent = Axis->Sent;
+		Stats.Replies = Axis->Replies;
+		Stats.Timeouts = Axis->Timeouts;
+		Stats.Retries = Axis->Retries;
+		Stats.AddressMismatches = Axis->AddressMismatches;
+		Stats.MnemonicMismatches = Axis->MnemonicMismatches;
+		Stats.BufferOverflows = Axis->BufferOverflows;
+		Stats.CommandErrors = Axis->CommandErrors;
+		Stats.QueueOverflows = Axis->QueueOverflows;
+		Stats.RenderFailures = Axis->RenderFailures;
+		Stats.DeadlinesMissed = Axis->DeadlinesMissed;
+		Stats.Polls = Axis->Polls;
+		Stats.StreamSamples = Axis->StreamSamples;
+		Stats.StreamOverruns = Axis->StreamOverruns;
+		Stats.AnalogueSamples = Axis->AnalogueSamples;
+		Stats.AnalogueOverruns = Axis->AnalogueOverruns;
+		Stats.GPIOEdges = Axis->GPIOEdges;
+		Stats.CommandsRejected = Axis->CommandsRejected;
+		Stats.PollJitterTotal = Axis->PollJitterTotal;
+		Stats.PollJitterMax = Axis->PollJitterMax;
+		Stats.LatencyMax = Axis->LatencyMax;
+		return SMC100ChainedProtocol::BuildStats(Sequence, Stats, Frame);
+	}
+	if (Part == 2)
+	{
+		SMC100ChainedProtocol::LatencyStatsMessage Latency;
+		Latency.MotorIndex = StatsMotorIndex;
+		for (uint8_t Index = 0; Index < SMC100ChainedProtocolLatencyBuckets; ++Index)
+		{
+			Latency.Histogram[Index] = Axis->LatencyHistogram[Index];
+		}
+		return SMC100ChainedProtocol::BuildLatencyStats(Sequence, Latency, Frame);
+	}
+	if (Part == 3)
+	{
+		SMC100ChainedProtocol::ChainStatsMessage Totals;
+		Totals.BusBusyTime = Snapshot.BusBusyTime;
+		Totals.ElapsedTime = Snapshot.ElapsedTime;
+		Totals.Resyncs = Snapshot.Resyncs;
+		Totals.BytesDiscarded = Snapshot.BytesDiscarded;
+		Totals.FramesDropped = FramesDropped;
+		return SMC100ChainedProtocol::BuildChainStats(Sequence, Totals, Frame);
+	}
+	SMC100ChainedProtocol::CommandStatsMessage Commands;
+	Commands.FirstCommand = (Part - 4) * SMC100ChainedProtocolCommandStatsPerFrame;
+	Commands.Count = 0;
+	for (uint8_t Index = Commands.FirstCommand; (Index < SMC100ChainedCommandTypeCount) && (Commands.Count < SMC100ChainedProtocolCommandStatsPerFrame); ++Index)
+	{
+		Commands.Sent[Commands.Count] = Snapshot.Commands[Index].Sent;
+		Commands.Replies[Commands.Count] = Snapshot.Commands[Index].Replies;
+		Commands.Timeouts[Commands.Count] = Snapshot.Commands[Index].Timeouts;
+		Commands.Count++;
+	}
+	return SMC100ChainedProtocol::BuildCommandStats(Sequence, Commands, Frame);
+}
+
+bool SMC100ChainedBinaryLink::SendFrame(const uint8_t* Frame, size_t Length)
+{
+	//Never blocks the bus loop, a frame that does not fit whole is dropped and counted.
+	if ( (Length == 0) || (Host->AvailableForWrite() < (int)Length) )
+	{
+		FramesDropped++;
+		return false;
+	}
+	Host->Write(Frame, Length);
+	Sequence++;
+	return true;
+}
+
+uint16_t SMC100ChainedBinaryLink::GetFramesDropped()
+{
+	return FramesDropped;
+}
+
+uint16_t SMC100ChainedBinaryLink::GetFrameErrors()
+{
+	return HostDecoder.GetErrors();
+}
+
+void SMC100ChainedBinaryLink::FlushLogLine()
+{
+	if (LogLineLength == 0)
+	{
+		return;
+	}
+	LogLine[LogLineLength] = '\0';
+	uint8_t Frame[SMC100ChainedProtocolMaxEncoded];
+	SendFrame(Frame, SMC100ChainedProtocol::BuildLog(Sequence, LogLine, Frame));
+	LogLineLength = 0;
+}
+
+void SMC100ChainedBinaryLink::Log(const char* Text)
+{
+	//The chain logs a line in fragments, they are collected so each diagnostic line becomes one frame.
+	while (*Text != '\0')
+	{
+		if (*Text == '\n')
+		{
+			FlushLogLine();
+		}
+		else
+		{
+			if (LogLineLength >= SMC100ChainedBinaryLinkLogLineSize)
+			{
+				FlushLogLine();
+			}
+			LogLine[LogLineLength] = *Text;
+			LogLineLength++;
+		}
+		Text++;
+	}
+}
+
+int SMC100ChainedBinaryLink::LogAvailableForWrite()
+{
+	//Event records go out as typed frames from CheckEvents(), reporting no room keeps the chain from also printing them as text.
+	return 0;
+}
+
+void SMC100ChainedBinaryLink::Begin(uint32_t BaudRate)
+{
+	Bus->Begin(BaudRate);
+}
+
+int SMC100ChainedBinaryLink::Available()
+{
+	return Bus->Available();
+}
+
+int SMC100ChainedBinaryLink::Read()
+{
+	return Bus->Read();
+}
+
+size_t SMC100ChainedBinaryLink::Write(const uint8_t* Data, size_t Length)
+{
+	return Bus->Write(Data, Length);
+}
+
+int SMC100ChainedBinaryLink::AvailableForWrite()
+{
+	return Bus->AvailableForWrite();
+}
+
+uint32_t SMC100ChainedBinaryLink::Micros()
+{
+	return Bus->Micros();
+}
+
+bool SMC100ChainedBinaryLink::Wait(uint32_t Timeout)
+{
+	return Bus->Wait(Timeout);
+}
+
+void SMC100ChainedBinaryLink::Wake()
+{
+	Bus->Wake();
+}
@@ -0,0 +1,66 @@
+#ifndef SMC100ChainedBinaryLink_h	//check for multiple inclusions
+#define SMC100ChainedBinaryLink_h
+
+#include "SMC100Chained.h"
+#include "SMC100ChainedProtocol.h"
+
+#define SMC100ChainedBinaryLinkLogLineSize SMC100ChainedProtocolMaxPayload
+#define SMC100ChainedBinaryLinkErrorCount 8
+#define SMC100ChainedBinaryLinkCommandStatsFrames ((SMC100ChainedCommandTypeCount + SMC100ChainedProtocolCommandStatsPerFrame - 1) / SMC100ChainedProtocolCommandStatsPerFrame)
+
+#if (SMC100ChainedLatencyBucketCount != SMC100ChainedProtocolLatencyBuckets) || (SMC100ChainedCommandTypeCount != SMC100ChainedProtocolCommandTypes)
+#error "SMC100ChainedProtocol stats sizes must match SMC100Chained"
+#endif
+
+class SMC100ChainedBinaryLink : public SMC100ChainedTransport
+{
+	public:
+		SMC100ChainedBinaryLink(SMC100ChainedTransport* bus, SMC100ChainedTransport* host);
+		void Attach(SMC100Chained* chain);
+		void Check();
+		void SendStats(uint8_t MotorIndex);
+		void SendSnapshots();
+		uint16_t GetFramesDropped();
+		uint16_t GetFrameErrors();
+		void Begin(uint32_t BaudRate);
+		int Available();
+		int Read();
+		size_t Write(const uint8_t* Data, size_t Length);
+		int AvailableForWrite();
+		uint32_t Micros();
+		void Log(const char* Text);
+		int LogAvailableForWrite();
+		bool Wait(uint32_t Timeout);
+		void Wake();
+	private:
+		bool SendFrame(const uint8_t* Frame, size_t Length);
+		void CheckHostInput();
+		void HandleMessage(const SMC100ChainedProtocol::Message& Incoming);
+		bool Dispatch(const SMC100ChainedProtocol::CommandMessage& Command);
+		void CheckEvents();
+		void CheckSnapshots();
+		void CheckErrors();
+		void CheckStats();
+		size_t BuildStatsPart(const SMC100Chained::StatsStruct& Snapshot, uint8_t Part, uint8_t* Frame);
+		static void HandleOutcome(void* Context, uint8_t MotorIndex, SMC100Chained::CommandType Command, SMC100Chained::OutcomeType Outcome, char Code);
+		void FlushLogLine();
+		SMC100ChainedTransport* Bus;
+		SMC100ChainedTransport* Host;
+		SMC100Chained* Chain;
+		SMC100ChainedProtocol::Decoder HostDecoder;
+		uint8_t Sequence;
+		uint16_t FramesDropped;
+		SMC100Chained::EventRecord PendingEvent;
+		bool EventPending;
+		uint32_t PublishedSnapshotSequence;
+		uint32_t PublishedTime[SMC100ChainedMaxMotors];
+		SMC100ChainedProtocol::ErrorMessage PendingErrors[SMC100ChainedBinaryLinkErrorCount];
+		uint8_t PendingErrorHead;
+		uint8_t PendingErrorCount;
+		uint8_t StatsMotorIndex;
+		uint8_t StatsPart;
+		char LogLine[SMC100ChainedBinaryLinkLogLineSize + 1];
+		uint8_t LogLineLength;
+};
+
+#endif
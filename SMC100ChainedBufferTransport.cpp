@@ -0,0 +1,125 @@
+#include "SMC100ChainedBufferTransport.h"
+
+SMC100ChainedBufferTransport::SMC100ChainedBufferTransport()
+{
+	ReceiveHead = 0;
+	ReceiveCount = 0;
+	TransmitHead = 0;
+	TransmitCount = 0;
+	Time = 0;
+	BaudRate = 0;
+	LogCallback = NULL;
+}
+
+void SMC100ChainedBufferTransport::Begin(uint32_t BaudRateToSet)
+{
+	BaudRate = BaudRateToSet;
+}
+
+int SMC100ChainedBufferTransport::Available()
+{
+	return (int)ReceiveCount;
+}
+
+int SMC100ChainedBufferTransport::Read()
+{
+	if (ReceiveCount == 0)
+	{
+		return -1;
+	}
+	uint8_t Value = ReceiveBuffer[ReceiveHead];
+	ReceiveHead = (ReceiveHead + 1) % SMC100ChainedBufferTransportSize;
+	ReceiveCount--;
+	return Value;
+}
+
+size_t SMC100ChainedBufferTransport::Write(const uint8_t* Data, size_t Length)
+{
+	size_t Written = 0;
+	while ( (Written < Length) && (TransmitCount < SMC100ChainedBufferTransportSize) )
+	{
+		TransmitBuffer[(TransmitHead + TransmitCount) % SMC100ChainedBufferTransportSize] = Data[Written];
+		TransmitCount++;
+		Written++;
+	}
+	return Written;
+}
+
+int SMC100ChainedBufferTransport::AvailableForWrite()
+{
+	//Bytes count as sent once the test pulls them, which is when the room comes back.
+	return (int)(SMC100ChainedBufferTransportSize - TransmitCount);
+}
+
+uint32_t SMC100ChainedBufferTransport::Micros()
+{
+	return Time;
+}
+
+void SMC100ChainedBufferTransport::Log(const char* Text)
+{
+	if (LogCallback != NULL)
+	{
+		LogCallback(Text);
+	}
+}
+
+int SMC100ChainedBufferTransport::LogAvailableForWrite()
+{
+	return SMC100ChainedBufferTransportLogRoom;
+}
+
+void SMC100ChainedBufferTransport::SetMicros(uint32_t TimeToSet)
+{
+	Time = TimeToSet;
+}
+
+void SMC100ChainedBufferTransport::AdvanceMicros(uint32_t Duration)
+{
+	Time += Duration;
+}
+
+void SMC100ChainedBufferTransport::SetLogCallback(LogListener Callback)
+{
+	LogCallback = Callback;
+}
+
+uint32_t SMC100ChainedBufferTransport::GetBaudRate()
+{
+	return BaudRate;
+}
+
+size_t SMC100ChainedBufferTransport::PushReceived(const uint8_t* Data, size_t Length)
+{
+	size_t Pushed = 0;
+	while ( (Pushed < Length) && (ReceiveCount < SMC100ChainedBufferTransportSize) )
+	{
+		ReceiveBuffer[(ReceiveHead + ReceiveCount) % SMC100ChainedBufferTransportSize] = Data[Pushed];
+		ReceiveCount++;
+		Pushed++;
+	}
+	return Pushed;
+}
+
+size_t SMC100ChainedBufferTransport::PushReceived(const char* Text)
+{
+	size_t Length = 0;
+	while (Text[Length] != '\0')
+	{
+		Length++;
+	}
+	return PushReceived(reinterpret_cast<const uint8_t*>(Text), Length);
+}
+
+size_t SMC100ChainedBufferTransport::PullTransmitted(uint8_t* Data, size_t MaxLength)
+{
+	size_t Pulled = 0;
+	while ( (Pulled < MaxLength) && (TransmitCount > 0) )
+	{
+		Data[Pulled] = TransmitBuffer[TransmitHead];
+		TransmitHead = (TransmitHead + 1) % SMC100ChainedBufferTransportSize;
+		TransmitCount--;
+		Pulled++;
+	}
+	return Pulled;
+}
@@ -0,0 +1,41 @@
+#ifndef SMC100ChainedBufferTransport_h	//check for multiple inclusions
+#define SMC100ChainedBufferTransport_h
+
+#include "SMC100ChainedTransport.h"
+
+#define SMC100ChainedBufferTransportSize 128
+#define SMC100ChainedBufferTransportLogRoom 1024
+
+class SMC100ChainedBufferTransport : public SMC100ChainedTransport
+{
+	public:
+		typedef void ( *LogListener )(const char* Text);
+		SMC100ChainedBufferTransport();
+		void Begin(uint32_t BaudRate);
+		int Available();
+		int Read();
+		size_t Write(const uint8_t* Data, size_t Length);
+		int AvailableForWrite();
+		uint32_t Micros();
+		void Log(const char* Text);
+		int LogAvailableForWrite();
+		void SetMicros(uint32_t Time);
+		void AdvanceMicros(uint32_t Duration);
+		void SetLogCallback(LogListener Callback);
+		uint32_t GetBaudRate();
+		size_t PushReceived(const uint8_t* Data, size_t Length);
+		size_t PushReceived(const char* Text);
+		size_t PullTransmitted(uint8_t* Data, size_t MaxLength);
+	private:
+		uint8_t ReceiveBuffer[SMC100ChainedBufferTransportSize];
+		size_t ReceiveHead;
+		size_t ReceiveCount;
+		uint8_t TransmitBuffer[SMC100ChainedBufferTransportSize];
+		size_t TransmitHead;
+		size_t TransmitCount;
+		uint32_t Time;
+		uint32_t BaudRate;
+		LogListener LogCallback;
+};
+
+#endif
@@ -0,0 +1,206 @@
+#include "SMC100ChainedCaptureTransport.h"
+
+const uint8_t SMC100ChainedCaptureTransport::Magic[4] = {'S', 'M', 'C', 'C'};
+
+SMC100ChainedCaptureTransport::SMC100ChainedCaptureTransport(SMC100ChainedTransport* inner)
+{
+	Inner = inner;
+	Writer = NULL;
+#if !defined(ARDUINO)
+	File = NULL;
+#endif
+	Capturing = false;
+	PendingLength = 0;
+	PendingReceived = false;
+	PendingTime = 0;
+	PendingLastByteTime = 0;
+	LastRecordTime = 0;
+	BytesCaptured = 0;
+}
+
+void SMC100ChainedCaptureTransport::Start(CaptureWriter WriterToSet)
+{
+	Stop();
+	Writer = WriterToSet;
+	WriteHeader();
+}
+
+#if !defined(ARDUINO)
+bool SMC100ChainedCaptureTransport::Open(const char* Path)
+{
+	Stop();
+	File = fopen(Path, "wb");
+	if (File == NULL)
+	{
+		return false;
+	}
+	WriteHeader();
+	return true;
+}
+
+void SMC100ChainedCaptureTransport::Close()
+{
+	Stop();
+}
+#endif
+
+void SMC100ChainedCaptureTransport::WriteHeader()
+{
+	//Record times are deltas from here, so the log does not depend on where the clock happened to be.
+	LastRecordTime = Inner->Micros();
+	PendingLength = 0;
+	BytesCaptured = 0;
+	Capturing = true;
+	uint8_t Header[SMC100ChainedCaptureHeaderSize] = {Magic[0], Magic[1], Magic[2], Magic[3], SMC100ChainedCaptureVersion};
+	Emit(Header, sizeof(Header));
+}
+
+void SMC100ChainedCaptureTransport::Stop()
+{
+	if (!Capturing)
+	{
+		return;
+	}
+	Flush();
+	Capturing = false;
+	Writer = NULL;
+#if !defined(ARDUINO)
+	if (File != NULL)
+	{
+		fclose(File);
+		File = NULL;
+	}
+#endif
+}
+
+bool SMC100ChainedCaptureTransport::IsCapturing()
+{
+	return Capturing;
+}
+
+uint32_t SMC100ChainedCaptureTransport::GetBytesCaptured()
+{
+	return BytesCaptured;
+}
+
+void SMC100ChainedCaptureTransport::Capture(bool Received, const uint8_t* Data, size_t Length)
+{
+	//Bytes in one direction that follow each other closely share a record, so a reply costs one header rather than one per byte.
+	if (!Capturing)
+	{
+		return;
+	}
+	uint32_t Now = Inner->Micros();
+	for (size_t Index = 0; Index < Length; ++Index)
+	{
+		bool Continues = (PendingLength > 0) && (PendingReceived == Received) && (PendingLength < SMC100ChainedCaptureRecordMax) && ((Now - PendingLastByteTime) < SMC100ChainedCaptureMergeGap);
+		if (!Continues)
+		{
+			Flush();
+			PendingReceived = Received;
+			PendingTime = Now;
+		}
+		Pending[PendingLength] = Data[Index];
+		PendingLength++;
+		PendingLastByteTime = Now;
+	}
+}
+
+void SMC100ChainedCaptureTransport::Flush()
+{
+	//Record is a direction and length byte, the time since the previous record as a base 128 varint, then the bytes.
+	if ( !Capturing || (PendingLength == 0) )
+	{
+		return;
+	}
+	uint8_t Header[6];
+	uint8_t HeaderLength = 0;
+	Header[HeaderLength] = PendingLength | (PendingReceived ? SMC100ChainedCaptureReceivedFlag : 0);
+	HeaderLength++;
+	uint32_t Delta = PendingTime - LastRecordTime;
+	do
+	{
+		uint8_t Byte = Delta & 0x7F;
+		Delta >>= 7;
+		Header[HeaderLength] = (Delta > 0) ? (Byte | 0x80) : Byte;
+		HeaderLength++;
+	}
+	while (Delta > 0);
+	Emit(Header, HeaderLength);
+	Emit(Pending, PendingLength);
+	LastRecordTime = PendingTime;
+	PendingLength = 0;
+}
+
+void SMC100ChainedCaptureTransport::Emit(const uint8_t* Data, size_t Length)
+{
+	BytesCaptured += Length;
+	if (Writer != NULL)
+	{
+		Writer(Data, Length);
+	}
+#if !defined(ARDUINO)
+	if (File != NULL)
+	{
+		fwrite(Data, 1, Length, File);
+	}
+#endif
+}
+
+void SMC100ChainedCaptureTransport::Begin(uint32_t BaudRate)
+{
+	Inner->Begin(BaudRate);
+}
+
+int SMC100ChainedCaptureTransport::Available()
+{
+	return Inner->Available();
+}
+
+int SMC100ChainedCaptureTransport::Read()
+{
+	int Value = Inner->Read();
+	if (Value >= 0)
+	{
+		uint8_t Byte = (uint8_t)Value;
+		Capture(true, &Byte, 1);
+	}
+	return Value;
+}
+
+size_t SMC100ChainedCaptureTransport::Write(const uint8_t* Data, size_t Length)
+{
+	size_t Written = Inner->Write(Data, Length);
+	Capture(false, Data, Written);
+	return Written;
+}
+
+int SMC100ChainedCaptureTransport::AvailableForWrite()
+{
+	return Inner->AvailableForWrite();
+}
+
+uint32_t SMC100ChainedCaptureTransport::Micros()
+{
+	return Inner->Micros();
+}
+
+void SMC100ChainedCaptureTransport::Log(const char* Text)
+{
+	Inner->Log(Text);
+}
+
+int SMC100ChainedCaptureTransport::LogAvailableForWrite()
+{
+	return Inner->LogAvailableForWrite();
+}
+
+bool SMC100ChainedCaptureTransport::Wait(uint32_t Timeout)
+{
+	return Inner->Wait(Timeout);
+}
+
+void SMC100ChainedCaptureTransport::Wake()
+{
+	Inner->Wake();
+}
@@ -0,0 +1,60 @@
+#ifndef SMC100ChainedCaptureTransport_h	//check for multiple inclusions
+#define SMC100ChainedCaptureTransport_h
+
+#include "SMC100ChainedTransport.h"
+
+#if !defined(ARDUINO)
+#include <stdio.h>
+#endif
+
+#define SMC100ChainedCaptureVersion 1
+#define SMC100ChainedCaptureHeaderSize 5
+#define SMC100ChainedCaptureRecordMax 127
+#define SMC100ChainedCaptureReceivedFlag 0x80
+#define SMC100ChainedCaptureMergeGap 1000
+
+class SMC100ChainedCaptureTransport : public SMC100ChainedTransport
+{
+	public:
+		typedef void ( *CaptureWriter )(const uint8_t* Data, size_t Length);
+		SMC100ChainedCaptureTransport(SMC100ChainedTransport* inner);
+		void Start(CaptureWriter Writer);
+#if !defined(ARDUINO)
+		bool Open(const char* Path);
+		void Close();
+#endif
+		void Stop();
+		void Flush();
+		bool IsCapturing();
+		uint32_t GetBytesCaptured();
+		void Begin(uint32_t BaudRate);
+		int Available();
+		int Read();
+		size_t Write(const uint8_t* Data, size_t Length);
+		int AvailableForWrite();
+		uint32_t Micros();
+		void Log(const char* Text);
+		int LogAvailableForWrite();
+		bool Wait(uint32_t Timeout);
+		void Wake();
+	private:
+		static const uint8_t Magic[4];
+		void Capture(bool Received, const uint8_t* Data, size_t Length);
+		void Emit(const uint8_t* Data, size_t Length);
+		void WriteHeader();
+		SMC100ChainedTransport* Inner;
+		CaptureWriter Writer;
+#if !defined(ARDUINO)
+		FILE* File;
+#endif
+		bool Capturing;
+		uint8_t Pending[SMC100ChainedCaptureRecordMax];
+		uint8_t PendingLength;
+		bool PendingReceived;
+		uint32_t PendingTime;
+		uint32_t PendingLastByteTime;
+		uint32_t LastRecordTime;
+		uint32_t BytesCaptured;
+};
+
+#endif
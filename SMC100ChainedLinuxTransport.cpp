@@ -0,0 +1,331 @@
+#include "SMC100ChainedLinuxTransport.h"
+
+#if defined(__linux__) && !defined(ARDUINO)
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+
+SMC100ChainedLinuxTransport::SMC100ChainedLinuxTransport()
+{
+	PortDescriptor = -1;
+	EpollDescriptor = -1;
+	TimerDescriptor = -1;
+	WakeDescriptor = -1;
+	BaudRate = 0;
+	ReceiveIndex = 0;
+	ReceiveCount = 0;
+	LogCallback = NULL;
+}
+
+SMC100ChainedLinuxTransport::~SMC100ChainedLinuxTransport()
+{
+	Close();
+}
+
+bool SMC100ChainedLinuxTransport::Open(const char* Device)
+{
+	Close();
+	PortDescriptor = open(Device, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+	if (PortDescriptor < 0)
+	{
+		Log("<SMCERROR>(Could not open serial device.)\n");
+		return false;
+	}
+	struct termios Settings;
+	if (tcgetattr(PortDescriptor, &Settings) != 0)
+	{
+		Log("<SMCERROR>(Serial device is not a terminal.)\n");
+		Close();
+		return false;
+	}
+	//Raw 8N1 with reads that never block, the engine does its own framing and timing.
+	cfmakeraw(&Settings);
+	Settings.c_cflag |= (CLOCAL | CREAD);
+	Settings.c_cflag &= ~(CSTOPB | CRTSCTS);
+	Settings.c_cc[VMIN] = 0;
+	Settings.c_cc[VTIME] = 0;
+	if (tcsetattr(PortDescriptor, TCSANOW, &Settings) != 0)
+	{
+		Log("<SMCERROR>(Could not configure serial device.)\n");
+		Close();
+		return false;
+	}
+	if ( (BaudRate != 0) && !ApplyBaudRate() )
+	{
+		Close();
+		return false;
+	}
+	tcflush(PortDescriptor, TCIOFLUSH);
+	EpollDescriptor = epoll_create1(EPOLL_CLOEXEC);
+	TimerDescriptor = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	WakeDescriptor = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if ( (EpollDescriptor < 0) || (TimerDescriptor < 0) || (WakeDescriptor < 0) )
+	{
+		Log("<SMCERROR>(Could not create event descriptors.)\n");
+		Close();
+		return false;
+	}
+	struct epoll_event Event;
+	memset(&Event, 0, sizeof(Event));
+	Event.events = EPOLLIN;
+	int Descriptors[3] = {PortDescriptor, TimerDescriptor, WakeDescriptor};
+	for (uint8_t Index = 0; Index < 3; ++Index)
+	{
+		Event.data.fd = Descriptors[Index];
+		if (epoll_ctl(EpollDescriptor, EPOLL_CTL_ADD, Descriptors[Index], &Event) != 0)
+		{
+			Log("<SMCERROR>(Could not register event descriptors.)\n");
+			Close();
+			return false;
+		}
+	}
+	ReceiveIndex = 0;
+	ReceiveCount = 0;
+	return true;
+}
+
+void SMC100ChainedLinuxTransport::Close()
+{
+	if (WakeDescriptor >= 0)
+	{
+		close(WakeDescriptor);
+		WakeDescriptor = -1;
+	}
+	if (TimerDescriptor >= 0)
+	{
+		close(TimerDescriptor);
+		TimerDescriptor = -1;
+	}
+	if (EpollDescriptor >= 0)
+	{
+		close(EpollDescriptor);
+		EpollDescriptor = -1;
+	}
+	if (PortDescriptor >= 0)
+	{
+		close(PortDescriptor);
+		PortDescriptor = -1;
+	}
+}
+
+bool SMC100ChainedLinuxTransport::IsOpen()
+{
+	return (PortDescriptor >= 0);
+}
+
+bool SMC100ChainedLinuxTransport::Wait(uint32_t Timeout)
+{
+	//Sleeps until a byte arrives or Timeout microseconds pass, timerfd gives the sub millisecond resolution epoll lacks.
+	if (EpollDescriptor < 0)
+	{
+		return false;
+	}
+	if (ReceiveCount > 0)
+	{
+		return true;
+	}
+	int EpollTimeout = -1;
+	if (Timeout == 0)
+	{
+		EpollTimeout = 0;
+	}
+	else
+	{
+		struct itimerspec TimerSetting;
+		memset(&TimerSetting, 0, sizeof(TimerSetting));
+		TimerSetting.it_value.tv_sec = Timeout / 1000000;
+		TimerSetting.it_value.tv_nsec = (Timeout % 1000000) * 1000;
+		timerfd_settime(TimerDescriptor, 0, &TimerSetting, NULL);
+	}
+	struct epoll_event Events[3];
+	int EventCount = epoll_wait(EpollDescriptor, Events, 3, EpollTimeout);
+	bool Readable = false;
+	for (int Index = 0; Index < EventCount; ++Index)
+	{
+		if ( (Events[Index].data.fd == TimerDescriptor) || (Events[Index].data.fd == WakeDescriptor) )
+		{
+			uint64_t Count = 0;
+			ssize_t Ignored = read(Events[Index].data.fd, &Count, sizeof(Count));
+			(void)Ignored;
+		}
+		else
+		{
+			Readable = true;
+		}
+	}
+	return Readable;
+}
+
+void SMC100ChainedLinuxTransport::Wake()
+{
+	//Lets another thread cut a Wait() short after it queued work for this port.
+	if (WakeDescriptor >= 0)
+	{
+		uint64_t Count = 1;
+		ssize_t Ignored = write(WakeDescriptor, &Count, sizeof(Count));
+		(void)Ignored;
+	}
+}
+
+int SMC100ChainedLinuxTransport::GetEventFileDescriptor()
+{
+	return EpollDescriptor;
+}
+
+void SMC100ChainedLinuxTransport::SetLogCallback(LogListener Callback)
+{
+	LogCallback = Callback;
+}
+
+void SMC100ChainedLinuxTransport::Begin(uint32_t BaudRateToSet)
+{
+	BaudRate = BaudRateToSet;
+	if (PortDescriptor >= 0)
+	{
+		ApplyBaudRate();
+	}
+}
+
+bool SMC100ChainedLinuxTransport::ApplyBaudRate()
+{
+	speed_t Speed;
+	switch (BaudRate)
+	{
+		case 9600:
+			Speed = B9600;
+			break;
+		case 19200:
+			Speed = B19200;
+			break;
+		case 38400:
+			Speed = B38400;
+			break;
+		case 57600:
+			Speed = B57600;
+			break;
+		case 115200:
+			Speed = B115200;
+			break;
+		case 230400:
+			Speed = B230400;
+			break;
+		case 460800:
+			Speed = B460800;
+			break;
+		case 921600:
+			Speed = B921600;
+			break;
+		default:
+			Log("<SMCERROR>(Baud rate not supported by termios.)\n");
+			return false;
+	}
+	struct termios Settings;
+	if (tcgetattr(PortDescriptor, &Settings) != 0)
+	{
+		return false;
+	}
+	cfsetispeed(&Settings, Speed);
+	cfsetospeed(&Settings, Speed);
+	return (tcsetattr(PortDescriptor, TCSADRAIN, &Settings) == 0);
+}
+
+void SMC100ChainedLinuxTransport::FillReceiveBuffer()
+{
+	if (PortDescriptor < 0)
+	{
+		return;
+	}
+	ssize_t ReadCount = read(PortDescriptor, ReceiveBuffer, SMC100ChainedLinuxReceiveBufferSize);
+	if (ReadCount > 0)
+	{
+		ReceiveIndex = 0;
+		ReceiveCount = (uint16_t)ReadCount;
+	}
+}
+
+int SMC100ChainedLinuxTransport::Available()
+{
+	if (ReceiveCount == 0)
+	{
+		FillReceiveBuffer();
+	}
+	return ReceiveCount;
+}
+
+int SMC100ChainedLinuxTransport::Read()
+{
+	if (Available() == 0)
+	{
+		return -1;
+	}
+	ReceiveCount--;
+	return ReceiveBuffer[ReceiveIndex++];
+}
+
+size_t SMC100ChainedLinuxTransport::Write(const uint8_t* Data, size_t Length)
+{
+	size_t Written = 0;
+	while ( (PortDescriptor >= 0) && (Written < Length) )
+	{
+		ssize_t Count = write(PortDescriptor, Data + Written, Length - Written);
+		if (Count > 0)
+		{
+			Written += (size_t)Count;
+		}
+		else if ( (Count < 0) && (errno == EINTR) )
+		{
+			continue;
+		}
+		else
+		{
+			break;
+		}
+	}
+	return Written;
+}
+
+int SMC100ChainedLinuxTransport::AvailableForWrite()
+{
+	//TIOCOUTQ only sees the kernel queue, bytes already inside a USB adapter count as sent.
+	int Queued = 0;
+	if ( (PortDescriptor < 0) || (ioctl(PortDescriptor, TIOCOUTQ, &Queued) != 0) )
+	{
+		return 0;
+	}
+	return SMC100ChainedLinuxTransmitQueueSize - Queued;
+}
+
+uint32_t SMC100ChainedLinuxTransport::Micros()
+{
+	struct timespec Now;
+	clock_gettime(CLOCK_MONOTONIC, &Now);
+	return (uint32_t)( ( (uint64_t)Now.tv_sec * 1000000ULL ) + (uint64_t)(Now.tv_nsec / 1000) );
+}
+
+void SMC100ChainedLinuxTransport::Log(const char* Text)
+{
+	if (LogCallback != NULL)
+	{
+		LogCallback(Text);
+	}
+	else
+	{
+		fputs(Text, stderr);
+	}
+}
+
+int SMC100ChainedLinuxTransport::LogAvailableForWrite()
+{
+	return SMC100ChainedLinuxTransmitQueueSize;
+}
+
+#endif
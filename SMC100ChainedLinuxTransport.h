@@ -0,0 +1,48 @@
+#ifndef SMC100ChainedLinuxTransport_h	//check for multiple inclusions
+#define SMC100ChainedLinuxTransport_h
+
+#if defined(__linux__) && !defined(ARDUINO)
+
+#include "SMC100ChainedTransport.h"
+
+#define SMC100ChainedLinuxReceiveBufferSize 256
+#define SMC100ChainedLinuxTransmitQueueSize 4096
+
+class SMC100ChainedLinuxTransport : public SMC100ChainedTransport
+{
+	public:
+		typedef void ( *LogListener )(const char* Text);
+		SMC100ChainedLinuxTransport();
+		~SMC100ChainedLinuxTransport();
+		bool Open(const char* Device);
+		void Close();
+		bool IsOpen();
+		bool Wait(uint32_t Timeout);
+		void Wake();
+		int GetEventFileDescriptor();
+		void SetLogCallback(LogListener Callback);
+		void Begin(uint32_t BaudRate);
+		int Available();
+		int Read();
+		size_t Write(const uint8_t* Data, size_t Length);
+		int AvailableForWrite();
+		uint32_t Micros();
+		void Log(const char* Text);
+		int LogAvailableForWrite();
+	private:
+		bool ApplyBaudRate();
+		void FillReceiveBuffer();
+		int PortDescriptor;
+		int EpollDescriptor;
+		int TimerDescriptor;
+		int WakeDescriptor;
+		uint32_t BaudRate;
+		uint8_t ReceiveBuffer[SMC100ChainedLinuxReceiveBufferSize];
+		uint16_t ReceiveIndex;
+		uint16_t ReceiveCount;
+		LogListener LogCallback;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,485 @@
+#include "SMC100ChainedManager.h"
+#include <math.h>
+#include <string.h>
+
+#if defined(SMC100ChainedManagerThreads)
+#include <chrono>
+#endif
+
+const uint32_t SMC100ChainedManager::SynchronizedPollTime = 100;
+
+SMC100ChainedManager::SMC100ChainedManager()
+{
+	ChainCount = 0;
+	AxisCount = 0;
+	NextChain = 0;
+	SynchronizedChainMask = 0;
+	SynchronizedStarts = 0;
+	for (uint8_t Index = 0; Index < SMC100ChainedManagerMaxChains; ++Index)
+	{
+		Chains[Index] = NULL;
+	}
+#if defined(SMC100ChainedManagerThreads)
+	ThreadsRunning = false;
+#endif
+}
+
+SMC100ChainedManager::~SMC100ChainedManager()
+{
+#if defined(SMC100ChainedManagerThreads)
+	StopThreads();
+#endif
+}
+
+int8_t SMC100ChainedManager::AddChain(SMC100Chained* Chain)
+{
+	if ( (ChainCount >= SMC100ChainedManagerMaxChains) || (Chain == NULL) )
+	{
+		return -1;
+	}
+	//Axes are numbered in the order chains are added, so the first axis of the second chain follows the last axis of the first.
+	uint8_t ChainIndex = ChainCount;
+	Chains[ChainIndex] = Chain;
+	ChainCount++;
+	for (uint8_t MotorIndex = 0; (MotorIndex < Chain->GetMotorCount()) && (AxisCount < SMC100ChainedManagerMaxAxes); ++MotorIndex)
+	{
+		Axes[AxisCount].Chain = ChainIndex;
+		Axes[AxisCount].MotorIndex = MotorIndex;
+		AxisCount++;
+	}
+	return (int8_t)ChainIndex;
+}
+
+uint8_t SMC100ChainedManager::GetChainCount()
+{
+	return ChainCount;
+}
+
+uint8_t SMC100ChainedManager::GetAxisCount()
+{
+	return AxisCount;
+}
+
+SMC100Chained* SMC100ChainedManager::GetChain(uint8_t ChainIndex)
+{
+	if (ChainIndex >= ChainCount)
+	{
+		return NULL;
+	}
+	return Chains[ChainIndex];
+}
+
+bool SMC100ChainedManager::GetAxisLocation(uint8_t Axis, AxisLocation* LocationReturn)
+{
+	if (Axis >= AxisCount)
+	{
+		return false;
+	}
+	*LocationReturn = Axes[Axis];
+	return true;
+}
+
+void SMC100ChainedManager::Begin()
+{
+	for (uint8_t ChainIndex = 0; ChainIndex < ChainCount; ++ChainIndex)
+	{
+		LockChain(ChainIndex);
+		Chains[ChainIndex]->Begin();
+		UnlockChain(ChainIndex, true);
+	}
+}
+
+void SMC100ChainedManager::Check()
+{
+	//Single loop service for MCUs. The first chain rotates so none is always served last.
+	if ( (SynchronizedChainMask != 0) && CheckSynchronizedStart() )
+	{
+		SynchronizedChainMask = 0;
+		return;
+	}
+	for (uint8_t Offset = 0; Offset < ChainCount; ++Offset)
+	{
+		Chains[(NextChain + Offset) % ChainCount]->Check();
+	}
+	if (ChainCount > 0)
+	{
+		NextChain = (NextChain + 1) % ChainCount;
+	}
+}
+
+uint32_t SMC100ChainedManager::TimeUntilNextCheck()
+{
+	uint32_t Wait = 0xFFFFFFFF;
+	for (uint8_t ChainIndex = 0; ChainIndex < ChainCount; ++ChainIndex)
+	{
+		LockChain(ChainIndex);
+		uint32_t ChainWait = Chains[ChainIndex]->TimeUntilNextCheck();
+		UnlockChain(ChainIndex, false);
+		if (ChainWait < Wait)
+		{
+			Wait = ChainWait;
+		}
+	}
+	return Wait;
+}
+
+void SMC100ChainedManager::Home(uint8_t Axis)
+{
+	if (Axis >= AxisCount)
+	{
+		return;
+	}
+	LockChain(Axes[Axis].Chain);
+	Chains[Axes[Axis].Chain]->Home(Axes[Axis].MotorIndex);
+	UnlockChain(Axes[Axis].Chain, true);
+}
+
+void SMC100ChainedManager::Enable(uint8_t Axis, bool Setting)
+{
+	if (Axis >= AxisCount)
+	{
+		return;
+	}
+	LockChain(Axes[Axis].Chain);
+	Chains[Axes[Axis].Chain]->Enable(Axes[Axis].MotorIndex, Setting);
+	UnlockChain(Axes[Axis].Chain, true);
+}
+
+void SMC100ChainedManager::MoveAbsolute(uint8_t Axis, float Target)
+{
+	if (Axis >= AxisCount)
+	{
+		return;
+	}
+	LockChain(Axes[Axis].Chain);
+	Chains[Axes[Axis].Chain]->MoveAbsolute(Axes[Axis].MotorIndex, Target);
+	UnlockChain(Axes[Axis].Chain, true);
+}
+
+void SMC100ChainedManager::MoveRelative(uint8_t Axis, float Distance)
+{
+	if (Axis >= AxisCount)
+	{
+		return;
+	}
+	LockChain(Axes[Axis].Chain);
+	Chains[Axes[Axis].Chain]->MoveRelative(Axes[Axis].MotorIndex, Distance);
+	UnlockChain(Axes[Axis].Chain, true);
+}
+
+void SMC100ChainedManager::SendGetPosition(uint8_t Axis)
+{
+	if (Axis >= AxisCount)
+	{
+		return;
+	}
+	LockChain(Axes[Axis].Chain);
+	Chains[Axes[Axis].Chain]->SendGetPosition(Axes[Axis].MotorIndex);
+	UnlockChain(Axes[Axis].Chain, true);
+}
+
+float SMC100ChainedManager::GetPosition(uint8_t Axis)
+{
+	if (Axis >= AxisCount)
+	{
+		return NAN;
+	}
+	LockChain(Axes[Axis].Chain);
+	float Position = Chains[Axes[Axis].Chain]->GetPosition(Axes[Axis].MotorIndex);
+	UnlockChain(Axes[Axis].Chain, false);
+	return Position;
+}
+
+bool SMC100ChainedManager::IsMoving(uint8_t Axis)
+{
+	if (Axis >= AxisCount)
+	{
+		return false;
+	}
+	LockChain(Axes[Axis].Chain);
+	bool Moving = Chains[Axes[Axis].Chain]->IsMoving(Axes[Axis].MotorIndex);
+	UnlockChain(Axes[Axis].Chain, false);
+	return Moving;
+}
+
+bool SMC100ChainedManager::IsHomed(uint8_t Axis)
+{
+	if (Axis >= AxisCount)
+	{
+		return false;
+	}
+	LockChain(Axes[Axis].Chain);
+	bool Homed = Chains[Axes[Axis].Chain]->IsHomed(Axes[Axis].MotorIndex);
+	UnlockChain(Axes[Axis].Chain, false);
+	return Homed;
+}
+
+bool SMC100ChainedManager::StartSynchronizedMove(const uint8_t* AxesToMove, const float* Targets, uint8_t Count)
+{
+	//Every chain involved is held, the moves are queued behind the hold, and all holds are dropped together once each chain has finished its current exchange.
+	if (SynchronizedChainMask != 0)
+	{
+		return false;
+	}
+	uint8_t ChainMask = 0;
+	for (uint8_t Index = 0; Index < Count; ++Index)
+	{
+		if (AxesToMove[Index] >= AxisCount)
+		{
+			return false;
+		}
+		ChainMask |= (1 << Axes[AxesToMove[Index]].Chain);
+	}
+	SynchronizedChainMask = ChainMask;
+	LockSynchronizedChains();
+	for (uint8_t ChainIndex = 0; ChainIndex < ChainCount; ++ChainIndex)
+	{
+		if (ChainMask & (1 << ChainIndex))
+		{
+			Chains[ChainIndex]->HoldQueue();
+		}
+	}
+	bool Queued = true;
+	for (uint8_t Index = 0; (Index < Count) && Queued; ++Index)
+	{
+		const AxisLocation* Location = &Axes[AxesToMove[Index]];
+		Chains[Location->Chain]->MoveAbsolute(Location->MotorIndex, Targets[Index]);
+		Queued = !Chains[Location->Chain]->LastEnqueueWasRejected();
+	}
+	if (!Queued)
+	{
+		//One refused axis fails the group, the moves already queued are withdrawn so none of them starts alone.
+		for (uint8_t ChainIndex = 0; ChainIndex < ChainCount; ++ChainIndex)
+		{
+			if (ChainMask & (1 << ChainIndex))
+			{
+				Chains[ChainIndex]->DiscardHeldCommands();
+				Chains[ChainIndex]->ReleaseQueue();
+			}
+		}
+		UnlockSynchronizedChains(true);
+		SynchronizedChainMask = 0;
+		return false;
+	}
+	UnlockSynchronizedChains(true);
+	return true;
+}
+
+bool SMC100ChainedManager::SynchronizedMovePending()
+{
+	return (SynchronizedChainMask != 0);
+}
+
+void SMC100ChainedManager::AbortSynchronizedMove()
+{
+	//The queued moves are not withdrawn, they simply start as each chain gets to them.
+	LockSynchronizedChains();
+	for (uint8_t ChainIndex = 0; ChainIndex < ChainCount; ++ChainIndex)
+	{
+		if (SynchronizedChainMask & (1 << ChainIndex))
+		{
+			Chains[ChainIndex]->ReleaseQueue();
+		}
+	}
+	UnlockSynchronizedChains(true);
+	SynchronizedChainMask = 0;
+}
+
+bool SMC100ChainedManager::CheckSynchronizedStart()
+{
+	//Returns true once the held chains were released and sent their first move.
+	for (uint8_t ChainIndex = 0; ChainIndex < ChainCount; ++ChainIndex)
+	{
+		if ( (SynchronizedChainMask & (1 << ChainIndex)) && !Chains[ChainIndex]->IsIdle() )
+		{
+			return false;
+		}
+	}
+	for (uint8_t ChainIndex = 0; ChainIndex < ChainCount; ++ChainIndex)
+	{
+		if (SynchronizedChainMask & (1 << ChainIndex))
+		{
+			Chains[ChainIndex]->ReleaseQueue();
+		}
+	}
+	for (uint8_t ChainIndex = 0; ChainIndex < ChainCount; ++ChainIndex)
+	{
+		if (SynchronizedChainMask & (1 << ChainIndex))
+		{
+			Chains[ChainIndex]->Check();
+		}
+	}
+	SynchronizedStarts++;
+	return true;
+}
+
+void SMC100ChainedManager::GetStats(ManagerStats* Snapshot)
+{
+	memset(Snapshot, 0, sizeof(ManagerStats));
+	SMC100Chained::StatsStruct ChainStats;
+	for (uint8_t ChainIndex = 0; ChainIndex < ChainCount; ++ChainIndex)
+	{
+		LockChain(ChainIndex);
+		Chains[ChainIndex]->GetStats(&ChainStats);
+		UnlockChain(ChainIndex, false);
+		for (uint8_t MotorIndex = 0; MotorIndex < Chains[ChainIndex]->GetMotorCount(); ++MotorIndex)
+		{
+			const SMC100Chained::AxisStats* Axis = &ChainStats.Axes[MotorIndex];
+			Snapshot->Sent += Axis->Sent;
+			Snapshot->Replies += Axis->Replies;
+			Snapshot->Timeouts += Axis->Timeouts;
+			Snapshot->Retries += Axis->Retries;
+			Snapshot->CommandErrors += Axis->CommandErrors;
+			Snapshot->CommandsRejected += Axis->CommandsRejected;
+			Snapshot->DeadlinesMissed += Axis->DeadlinesMissed;
+			Snapshot->QueueOverflows += Axis->QueueOverflows;
+		}
+		Snapshot->Resyncs += ChainStats.Resyncs;
+		Snapshot->BytesDiscarded += ChainStats.BytesDiscarded;
+		Snapshot->BusBusyTime[ChainIndex] = ChainStats.BusBusyTime;
+		if (ChainStats.ElapsedTime > Snapshot->ElapsedTime)
+		{
+			Snapshot->ElapsedTime = ChainStats.ElapsedTime;
+		}
+	}
+	Snapshot->SynchronizedStarts = SynchronizedStarts;
+}
+
+void SMC100ChainedManager::ResetStats()
+{
+	for (uint8_t ChainIndex = 0; ChainIndex < ChainCount; ++ChainIndex)
+	{
+		LockChain(ChainIndex);
+		Chains[ChainIndex]->ResetStats();
+		UnlockChain(ChainIndex, false);
+	}
+	SynchronizedStarts = 0;
+}
+
+void SMC100ChainedManager::LockSynchronizedChains()
+{
+	//Always in chain order so two callers can never hold the locks crosswise.
+	for (uint8_t ChainIndex = 0; ChainIndex < ChainCount; ++ChainIndex)
+	{
+		if (SynchronizedChainMask & (1 << ChainIndex))
+		{
+			LockChain(ChainIndex);
+		}
+	}
+}
+
+void SMC100ChainedManager::UnlockSynchronizedChains(bool WorkQueued)
+{
+	for (uint8_t ChainIndex = 0; ChainIndex < ChainCount; ++ChainIndex)
+	{
+		if (SynchronizedChainMask & (1 << ChainIndex))
+		{
+			UnlockChain(ChainIndex, WorkQueued);
+		}
+	}
+}
+
+#if defined(SMC100ChainedManagerThreads)
+
+void SMC100ChainedManager::LockChain(uint8_t ChainIndex)
+{
+	ChainLocks[ChainIndex].lock();
+}
+
+void SMC100ChainedManager::UnlockChain(uint8_t ChainIndex, bool WorkQueued)
+{
+	ChainLocks[ChainIndex].unlock();
+	//Whatever was just queued should not wait out the I/O thread's sleep, getters leave it asleep.
+	if (WorkQueued)
+	{
+		Chains[ChainIndex]->GetTransport()->Wake();
+	}
+}
+
+bool SMC100ChainedManager::StartThreads()
+{
+	if (ThreadsRunning)
+	{
+		return false;
+	}
+	ThreadsRunning = true;
+	for (uint8_t ChainIndex = 0; ChainIndex < ChainCount; ++ChainIndex)
+	{
+		Threads[ChainIndex] = std::thread(ThreadLoop, this, ChainIndex);
+	}
+	return true;
+}
+
+void SMC100ChainedManager::StopThreads()
+{
+	if (!ThreadsRunning)
+	{
+		return;
+	}
+	ThreadsRunning = false;
+	for (uint8_t ChainIndex = 0; ChainIndex < ChainCount; ++ChainIndex)
+	{
+		Chains[ChainIndex]->GetTransport()->Wake();
+		if (Threads[ChainIndex].joinable())
+		{
+			Threads[ChainIndex].join();
+		}
+	}
+}
+
+void SMC100ChainedManager::ThreadLoop(SMC100ChainedManager* Manager, uint8_t ChainIndex)
+{
+	//One thread per port, a slow chain only ever delays itself.
+	SMC100Chained* Chain = Manager->Chains[ChainIndex];
+	while (Manager->ThreadsRunning)
+	{
+		Manager->ChainLocks[ChainIndex].lock();
+		Chain->Check();
+		uint32_t Wait = Chain->TimeUntilNextCheck();
+		Manager->ChainLocks[ChainIndex].unlock();
+		Chain->GetTransport()->Wait(Wait);
+	}
+}
+
+bool SMC100ChainedManager::SynchronizedMove(const uint8_t* AxesToMove, const float* Targets, uint8_t Count, uint32_t Timeout)
+{
+	//Blocking form for threaded use. The release runs here with every involved chain locked, so all I/O threads see it together.
+	if (!StartSynchronizedMove(AxesToMove, Targets, Count))
+	{
+		return false;
+	}
+	std::chrono::steady_clock::time_point Deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(Timeout);
+	while (true)
+	{
+		LockSynchronizedChains();
+		bool Started = CheckSynchronizedStart();
+		//Once started the I/O threads have replies to wait for, until then there is nothing new for them.
+		UnlockSynchronizedChains(Started);
+		if (Started)
+		{
+			SynchronizedChainMask = 0;
+			return true;
+		}
+		if (std::chrono::steady_clock::now() > Deadline)
+		{
+			AbortSynchronizedMove();
+			return false;
+		}
+		std::this_thread::sleep_for(std::chrono::microseconds(SynchronizedPollTime));
+	}
+}
+
+#else
+
+void SMC100ChainedManager::LockChain(uint8_t ChainIndex)
+{
+	(void)ChainIndex;
+}
+
+void SMC100ChainedManager::UnlockChain(uint8_t ChainIndex, bool WorkQueued)
+{
+	(void)ChainIndex;
+	(void)WorkQueued;
+}
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef SMC100ChainedManager_h	//check for multiple inclusions
+#define SMC100ChainedManager_h
+
+#include "SMC100Chained.h"
+
+#if defined(__linux__) && !defined(ARDUINO)
+#define SMC100ChainedManagerThreads 1
+#include <thread>
+#include <mutex>
+#include <atomic>
+#endif
+
+#define SMC100ChainedManagerMaxChains 4
+#define SMC100ChainedManagerMaxAxes (SMC100ChainedManagerMaxChains * SMC100ChainedMaxMotors)
+
+class SMC100ChainedManager
+{
+	public:
+		struct AxisLocation
+		{
+			uint8_t Chain;
+			uint8_t MotorIndex;
+		};
+		struct ManagerStats
+		{
+			uint32_t Sent;
+			uint32_t Replies;
+			uint32_t Timeouts;
+			uint32_t Retries;
+			uint32_t CommandErrors;
+			uint32_t CommandsRejected;
+			uint32_t DeadlinesMissed;
+			uint32_t QueueOverflows;
+			uint32_t Resyncs;
+			uint32_t BytesDiscarded;
+			uint32_t BusBusyTime[SMC100ChainedManagerMaxChains];
+			uint32_t ElapsedTime;
+			uint32_t SynchronizedStarts;
+		};
+		SMC100ChainedManager();
+		~SMC100ChainedManager();
+		int8_t AddChain(SMC100Chained* Chain);
+		uint8_t GetChainCount();
+		uint8_t GetAxisCount();
+		SMC100Chained* GetChain(uint8_t ChainIndex);
+		bool GetAxisLocation(uint8_t Axis, AxisLocation* LocationReturn);
+		void Begin();
+		void Check();
+		uint32_t TimeUntilNextCheck();
+		void Home(uint8_t Axis);
+		void Enable(uint8_t Axis, bool Setting);
+		void MoveAbsolute(uint8_t Axis, float Target);
+		void MoveRelative(uint8_t Axis, float Distance);
+		void SendGetPosition(uint8_t Axis);
+		float GetPosition(uint8_t Axis);
+		bool IsMoving(uint8_t Axis);
+		bool IsHomed(uint8_t Axis);
+		bool StartSynchronizedMove(const uint8_t* Axes, const float* Targets, uint8_t Count);
+		bool SynchronizedMovePending();
+		void AbortSynchronizedMove();
+		void GetStats(ManagerStats* Snapshot);
+		void ResetStats();
+#if defined(SMC100ChainedManagerThreads)
+		bool StartThreads();
+		void StopThreads();
+		bool SynchronizedMove(const uint8_t* Axes, const float* Targets, uint8_t Count, uint32_t Timeout);
+#endif
+	private:
+		static const uint32_t SynchronizedPollTime;
+		bool CheckSynchronizedStart();
+		void LockChain(uint8_t ChainIndex);
+		void UnlockChain(uint8_t ChainIndex, bool WorkQueued);
+		void LockSynchronizedChains();
+		void UnlockSynchronizedChains(bool WorkQueued);
+		SMC100Chained* Chains[SMC100ChainedManagerMaxChains];
+		uint8_t ChainCount;
+		AxisLocation Axes[SMC100ChainedManagerMaxAxes];
+		uint8_t AxisCount;
+		uint8_t NextChain;
+		uint8_t SynchronizedChainMask;
+		uint32_t SynchronizedStarts;
+#if defined(SMC100ChainedManagerThreads)
+		static void ThreadLoop(SMC100ChainedManager* Manager, uint8_t ChainIndex);
+		std::thread Threads[SMC100ChainedManagerMaxChains];
+		std::mutex ChainLocks[SMC100ChainedManagerMaxChains];
+		std::atomic<bool> ThreadsRunning;
+#endif
+};
+
+#endif
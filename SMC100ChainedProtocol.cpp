@@ -0,0 +1,463 @@
+#include "SMC100ChainedProtocol.h"
+#include <string.h>
+
+SMC100ChainedProtocol::Decoder::Decoder()
+{
+	Errors = 0;
+	Reset();
+}
+
+void SMC100ChainedProtocol::Decoder::Reset()
+{
+	EncodedLength = 0;
+	Discarding = false;
+}
+
+bool SMC100ChainedProtocol::Decoder::Push(uint8_t Byte)
+{
+	//Zero only ever appears as the frame delimiter, so any damage is confined to one frame and the next zero resynchronises.
+	if (Byte != 0)
+	{
+		if (Discarding)
+		{
+			return false;
+		}
+		if (EncodedLength >= SMC100ChainedProtocolMaxEncoded)
+		{
+			Discarding = true;
+			Errors++;
+			return false;
+		}
+		Encoded[EncodedLength] = Byte;
+		EncodedLength++;
+		return false;
+	}
+	bool WasDiscarding = Discarding;
+	uint8_t Length = EncodedLength;
+	Reset();
+	if ( WasDiscarding || (Length == 0) )
+	{
+		return false;
+	}
+	uint8_t Frame[SMC100ChainedProtocolMaxEncoded];
+	size_t FrameLength = CobsDecode(Encoded, Length, Frame);
+	if (!ParseFrame(Frame, FrameLength, &Current))
+	{
+		Errors++;
+		return false;
+	}
+	return true;
+}
+
+const SMC100ChainedProtocol::Message& SMC100ChainedProtocol::Decoder::GetMessage()
+{
+	return Current;
+}
+
+const SMC100ChainedProtocol::ErrorMessage* SMC100ChainedProtocol::Decoder::GetError()
+{
+	if (Current.Type != MessageType::Error)
+	{
+		return NULL;
+	}
+	return &Current.Error;
+}
+
+uint16_t SMC100ChainedProtocol::Decoder::GetErrors()
+{
+	return Errors;
+}
+
+size_t SMC100ChainedProtocol::CobsEncode(const uint8_t* Input, size_t Length, uint8_t* Output)
+{
+	size_t ReadIndex = 0;
+	size_t WriteIndex = 1;
+	size_t CodeIndex = 0;
+	uint8_t Code = 1;
+	while (ReadIndex < Length)
+	{
+		if (Input[ReadIndex] == 0)
+		{
+			Output[CodeIndex] = Code;
+			Code = 1;
+			CodeIndex = WriteIndex;
+			WriteIndex++;
+		}
+		else
+		{
+			Output[WriteIndex] = Input[ReadIndex];
+			WriteIndex++;
+			Code++;
+			if (Code == 0xFF)
+			{
+				Output[CodeIndex] = Code;
+				Code = 1;
+				CodeIndex = WriteIndex;
+				WriteIndex++;
+			}
+		}
+		ReadIndex++;
+	}
+	Output[CodeIndex] = Code;
+	return WriteIndex;
+}
+
+size_t SMC100ChainedProtocol::CobsDecode(const uint8_t* Input, size_t Length, uint8_t* Output)
+{
+	size_t ReadIndex = 0;
+	size_t WriteIndex = 0;
+	while (ReadIndex < Length)
+	{
+		uint8_t Code = Input[ReadIndex];
+		ReadIndex++;
+		if ( (Code == 0) || ((ReadIndex + Code - 1) > Length) )
+		{
+			return 0;
+		}
+		for (uint8_t Index = 1; Index < Code; ++Index)
+		{
+			Output[WriteIndex] = Input[ReadIndex];
+			WriteIndex++;
+			ReadIndex++;
+		}
+		if ( (Code < 0xFF) && (ReadIndex < Length) )
+		{
+			Output[WriteIndex] = 0;
+			WriteIndex++;
+		}
+	}
+	return WriteIndex;
+}
+
+uint16_t SMC100ChainedProtocol::Crc16(const uint8_t* Data, size_t Length)
+{
+	//CRC-16/CCITT-FALSE, bitwise so it costs no table space on AVR.
+	uint16_t Crc = 0xFFFF;
+	for (size_t Index = 0; Index < Length; ++Index)
+	{
+		Crc ^= (uint16_t)Data[Index] << 8;
+		for (uint8_t Bit = 0; Bit < 8; ++Bit)
+		{
+			Crc = (Crc & 0x8000) ? ((Crc << 1) ^ 0x1021) : (Crc << 1);
+		}
+	}
+	return Crc;
+}
+
+size_t SMC100ChainedProtocol::EncodeFrame(MessageType Type, uint8_t Sequence, const uint8_t* Payload, size_t Length, uint8_t* Output)
+{
+	//Frame is type, sequence, payload and a little endian CRC over all of it, COBS encoded and closed by a zero.
+	if (Length > SMC100ChainedProtocolMaxPayload)
+	{
+		return 0;
+	}
+	uint8_t Frame[SMC100ChainedProtocolMaxFrame];
+	Frame[0] = static_cast<uint8_t>(Type);
+	Frame[1] = Sequence;
+	memcpy(Frame + 2, Payload, Length);
+	uint16_t Crc = Crc16(Frame, Length + 2);
+	PutUnsigned(Frame + Length + 2, Crc, 2);
+	size_t EncodedLength = CobsEncode(Frame, Length + 4, Output);
+	Output[EncodedLength] = 0;
+	return EncodedLength + 1;
+}
+
+bool SMC100ChainedProtocol::ParseFrame(const uint8_t* Frame, size_t Length, Message* MessageReturn)
+{
+	if ( (Length < 4) || (Length > SMC100ChainedProtocolMaxFrame) )
+	{
+		return false;
+	}
+	if (Crc16(Frame, Length - 2) != GetUnsigned(Frame + Length - 2, 2))
+	{
+		return false;
+	}
+	const uint8_t* Payload = Frame + 2;
+	size_t PayloadLength = Length - 4;
+	MessageReturn->Type = static_cast<MessageType>(Frame[0]);
+	MessageReturn->Sequence = Frame[1];
+	MessageReturn->Text[0] = '\0';
+	switch (MessageReturn->Type)
+	{
+		case MessageType::Snapshot:
+			if (PayloadLength != 11)
+			{
+				return false;
+			}
+			MessageReturn->Snapshot.MotorIndex = Payload[0];
+			MessageReturn->Snapshot.Time = GetUnsigned(Payload + 1, 4);
+			MessageReturn->Snapshot.Position = GetFloat(Payload + 5);
+			MessageReturn->Snapshot.Status = Payload[9];
+			MessageReturn->Snapshot.HasBeenHomed = (Payload[10] != 0);
+			return true;
+		case MessageType::Event:
+			if (PayloadLength != 12)
+			{
+				return false;
+			}
+			MessageReturn->Event.Time = GetUnsigned(Payload, 4);
+			MessageReturn->Event.Event = Payload[4];
+			MessageReturn->Event.MotorIndex = Payload[5];
+			MessageReturn->Event.Command = Payload[6];
+			MessageReturn->Event.GetOrSet = Payload[7];
+			MessageReturn->Event.Parameter = GetFloat(Payload + 8);
+			return true;
+		case MessageType::Log:
+			memcpy(MessageReturn->Text, Payload, PayloadLength);
+			MessageReturn->Text[PayloadLength] = '\0';
+			return true;
+		case MessageType::Stats:
+		{
+			if (PayloadLength != 49)
+			{
+				return false;
+			}
+			StatsMessage* Stats = &MessageReturn->Stats;
+			Stats->MotorIndex = Payload[0];
+			uint16_t* Counters[] = {&Stats->Sent, &Stats->Replies, &Stats->Timeouts, &Stats->Retries, &Stats->AddressMismatches, &Stats->MnemonicMismatches, &Stats->BufferOverflows, &Stats->CommandErrors, &Stats->QueueOverflows, &Stats->RenderFailures, &Stats->DeadlinesMissed, &Stats->Polls, &Stats->StreamSamples, &Stats->StreamOverruns, &Stats->AnalogueSamples, &Stats->AnalogueOverruns, &Stats->GPIOEdges, &Stats->CommandsRejected};
+			const uint8_t* Field = Payload + 1;
+			for (uint8_t Index = 0; Index < sizeof(Counters) / sizeof(Counters[0]); ++Index)
+			{
+				*Counters[Index] = GetUnsigned(Field, 2);
+				Field += 2;
+			}
+			Stats->PollJitterTotal = GetUnsigned(Field, 4);
+			Stats->PollJitterMax = GetUnsigned(Field + 4, 4);
+			Stats->LatencyMax = GetUnsigned(Field + 8, 4);
+			return true;
+		}
+		case MessageType::LatencyStats:
+			if (PayloadLength != 1 + (2 * SMC100ChainedProtocolLatencyBuckets))
+			{
+				return false;
+			}
+			MessageReturn->LatencyStats.MotorIndex = Payload[0];
+			for (uint8_t Index = 0; Index < SMC100ChainedProtocolLatencyBuckets; ++Index)
+			{
+				MessageReturn->LatencyStats.Histogram[Index] = GetUnsigned(Payload + 1 + (2 * Index), 2);
+			}
+			return true;
+		case MessageType::ChainStats:
+			if (PayloadLength != 16)
+			{
+				return false;
+			}
+			MessageReturn->ChainStats.BusBusyTime = GetUnsigned(Payload, 4);
+			MessageReturn->ChainStats.ElapsedTime = GetUnsigned(Payload + 4, 4);
+			MessageReturn->ChainStats.Resyncs = GetUnsigned(Payload + 8, 2);
+			MessageReturn->ChainStats.BytesDiscarded = GetUnsigned(Payload + 10, 4);
+			MessageReturn->ChainStats.FramesDropped = GetUnsigned(Payload + 14, 2);
+			return true;
+		case MessageType::CommandStats:
+			if ( (PayloadLength < 2) || (Payload[1] > SMC100ChainedProtocolCommandStatsPerFrame) || (PayloadLength != 2 + (6 * (size_t)Payload[1])) )
+			{
+				return false;
+			}
+			MessageReturn->CommandStats.FirstCommand = Payload[0];
+			MessageReturn->CommandStats.Count = Payload[1];
+			for (uint8_t Index = 0; Index < Payload[1]; ++Index)
+			{
+				MessageReturn->CommandStats.Sent[Index] = GetUnsigned(Payload + 2 + (6 * Index), 2);
+				MessageReturn->CommandStats.Replies[Index] = GetUnsigned(Payload + 4 + (6 * Index), 2);
+				MessageReturn->CommandStats.Timeouts[Index] = GetUnsigned(Payload + 6 + (6 * Index), 2);
+			}
+			return true;
+		case MessageType::Error:
+			if ( (PayloadLength != 7) || (Payload[3] >= static_cast<uint8_t>(ErrorKind::Count)) )
+			{
+				return false;
+			}
+			MessageReturn->Error.MotorIndex = Payload[0];
+			MessageReturn->Error.Command[0] = (char)Payload[1];
+			MessageReturn->Error.Command[1] = (char)Payload[2];
+			MessageReturn->Error.Kind = static_cast<ErrorKind>(Payload[3]);
+			MessageReturn->Error.Code = (char)Payload[4];
+			MessageReturn->Error.Fault = GetUnsigned(Payload + 5, 2);
+			return true;
+		case MessageType::Ack:
+			if (PayloadLength != 2)
+			{
+				return false;
+			}
+			MessageReturn->Ack.CommandSequence = Payload[0];
+			MessageReturn->Ack.Accepted = (Payload[1] != 0);
+			return true;
+		case MessageType::Command:
+			if ( (PayloadLength != 6) || (Payload[0] >= static_cast<uint8_t>(RequestType::Count)) )
+			{
+				return false;
+			}
+			MessageReturn->Command.Request = static_cast<RequestType>(Payload[0]);
+			MessageReturn->Command.MotorIndex = Payload[1];
+			MessageReturn->Command.Parameter = GetFloat(Payload + 2);
+			return true;
+		case MessageType::RequestStats:
+		case MessageType::RequestSnapshots:
+			if (PayloadLength != 1)
+			{
+				return false;
+			}
+			MessageReturn->MotorIndex = Payload[0];
+			return true;
+		default:
+			return false;
+	}
+}
+
+size_t SMC100ChainedProtocol::BuildSnapshot(uint8_t Sequence, const SnapshotMessage& Snapshot, uint8_t* Output)
+{
+	uint8_t Payload[11];
+	Payload[0] = Snapshot.MotorIndex;
+	PutUnsigned(Payload + 1, Snapshot.Time, 4);
+	PutFloat(Payload + 5, Snapshot.Position);
+	Payload[9] = Snapshot.Status;
+	Payload[10] = Snapshot.HasBeenHomed ? 1 : 0;
+	return EncodeFrame(MessageType::Snapshot, Sequence, Payload, sizeof(Payload), Output);
+}
+
+size_t SMC100ChainedProtocol::BuildEvent(uint8_t Sequence, const EventMessage& Event, uint8_t* Output)
+{
+	uint8_t Payload[12];
+	PutUnsigned(Payload, Event.Time, 4);
+	Payload[4] = Event.Event;
+	Payload[5] = Event.MotorIndex;
+	Payload[6] = Event.Command;
+	Payload[7] = Event.GetOrSet;
+	PutFloat(Payload + 8, Event.Parameter);
+	return EncodeFrame(MessageType::Event, Sequence, Payload, sizeof(Payload), Output);
+}
+
+size_t SMC100ChainedProtocol::BuildStats(uint8_t Sequence, const StatsMessage& Stats, uint8_t* Output)
+{
+	//The full axis counter set, its encoded frame still fits the 63 byte AVR transmit buffer.
+	uint8_t Payload[49];
+	const uint16_t Counters[] = {Stats.Sent, Stats.Replies, Stats.Timeouts, Stats.Retries, Stats.AddressMismatches, Stats.MnemonicMismatches, Stats.BufferOverflows, Stats.CommandErrors, Stats.QueueOverflows, Stats.RenderFailures, Stats.DeadlinesMissed, Stats.Polls, Stats.StreamSamples, Stats.StreamOverruns, Stats.AnalogueSamples, Stats.AnalogueOverruns, Stats.GPIOEdges, Stats.CommandsRejected};
+	Payload[0] = Stats.MotorIndex;
+	uint8_t Length = 1;
+	for (uint8_t Index = 0; Index < sizeof(Counters) / sizeof(Counters[0]); ++Index)
+	{
+		Length += PutUnsigned(Payload + Length, Counters[Index], 2);
+	}
+	Length += PutUnsigned(Payload + Length, Stats.PollJitterTotal, 4);
+	Length += PutUnsigned(Payload + Length, Stats.PollJitterMax, 4);
+	Length += PutUnsigned(Payload + Length, Stats.LatencyMax, 4);
+	return EncodeFrame(MessageType::Stats, Sequence, Payload, Length, Output);
+}
+
+size_t SMC100ChainedProtocol::BuildLatencyStats(uint8_t Sequence, const LatencyStatsMessage& Stats, uint8_t* Output)
+{
+	uint8_t Payload[1 + (2 * SMC100ChainedProtocolLatencyBuckets)];
+	Payload[0] = Stats.MotorIndex;
+	for (uint8_t Index = 0; Index < SMC100ChainedProtocolLatencyBuckets; ++Index)
+	{
+		PutUnsigned(Payload + 1 + (2 * Index), Stats.Histogram[Index], 2);
+	}
+	return EncodeFrame(MessageType::LatencyStats, Sequence, Payload, sizeof(Payload), Output);
+}
+
+size_t SMC100ChainedProtocol::BuildChainStats(uint8_t Sequence, const ChainStatsMessage& Stats, uint8_t* Output)
+{
+	uint8_t Payload[16];
+	PutUnsigned(Payload, Stats.BusBusyTime, 4);
+	PutUnsigned(Payload + 4, Stats.ElapsedTime, 4);
+	PutUnsigned(Payload + 8, Stats.Resyncs, 2);
+	PutUnsigned(Payload + 10, Stats.BytesDiscarded, 4);
+	PutUnsigned(Payload + 14, Stats.FramesDropped, 2);
+	return EncodeFrame(MessageType::ChainStats, Sequence, Payload, sizeof(Payload), Output);
+}
+
+size_t SMC100ChainedProtocol::BuildCommandStats(uint8_t Sequence, const CommandStatsMessage& Stats, uint8_t* Output)
+{
+	if (Stats.Count > SMC100ChainedProtocolCommandStatsPerFrame)
+	{
+		return 0;
+	}
+	uint8_t Payload[2 + (6 * SMC100ChainedProtocolCommandStatsPerFrame)];
+	Payload[0] = Stats.FirstCommand;
+	Payload[1] = Stats.Count;
+	for (uint8_t Index = 0; Index < Stats.Count; ++Index)
+	{
+		PutUnsigned(Payload + 2 + (6 * Index), Stats.Sent[Index], 2);
+		PutUnsigned(Payload + 4 + (6 * Index), Stats.Replies[Index], 2);
+		PutUnsigned(Payload + 6 + (6 * Index), Stats.Timeouts[Index], 2);
+	}
+	return EncodeFrame(MessageType::CommandStats, Sequence, Payload, 2 + (6 * Stats.Count), Output);
+}
+
+size_t SMC100ChainedProtocol::BuildError(uint8_t Sequence, const ErrorMessage& Error, uint8_t* Output)
+{
+	uint8_t Payload[7];
+	Payload[0] = Error.MotorIndex;
+	Payload[1] = (uint8_t)Error.Command[0];
+	Payload[2] = (uint8_t)Error.Command[1];
+	Payload[3] = static_cast<uint8_t>(Error.Kind);
+	Payload[4] = (uint8_t)Error.Code;
+	PutUnsigned(Payload + 5, Error.Fault, 2);
+	return EncodeFrame(MessageType::Error, Sequence, Payload, sizeof(Payload), Output);
+}
+
+size_t SMC100ChainedProtocol::BuildAck(uint8_t Sequence, const AckMessage& Ack, uint8_t* Output)
+{
+	uint8_t Payload[2];
+	Payload[0] = Ack.CommandSequence;
+	Payload[1] = Ack.Accepted ? 1 : 0;
+	return EncodeFrame(MessageType::Ack, Sequence, Payload, sizeof(Payload), Output);
+}
+
+size_t SMC100ChainedProtocol::BuildLog(uint8_t Sequence, const char* Text, uint8_t* Output)
+{
+	size_t Length = strlen(Text);
+	if (Length > SMC100ChainedProtocolMaxPayload)
+	{
+		Length = SMC100ChainedProtocolMaxPayload;
+	}
+	return EncodeFrame(MessageType::Log, Sequence, (const uint8_t*)Text, Length, Output);
+}
+
+size_t SMC100ChainedProtocol::BuildCommand(uint8_t Sequence, RequestType Request, uint8_t MotorIndex, float Parameter, uint8_t* Output)
+{
+	uint8_t Payload[6];
+	Payload[0] = static_cast<uint8_t>(Request);
+	Payload[1] = MotorIndex;
+	PutFloat(Payload + 2, Parameter);
+	return EncodeFrame(MessageType::Command, Sequence, Payload, sizeof(Payload), Output);
+}
+
+size_t SMC100ChainedProtocol::BuildRequest(uint8_t Sequence, MessageType Type, uint8_t MotorIndex, uint8_t* Output)
+{
+	return EncodeFrame(Type, Sequence, &MotorIndex, 1, Output);
+}
+
+uint8_t SMC100ChainedProtocol::PutUnsigned(uint8_t* Buffer, uint32_t Value, uint8_t Size)
+{
+	for (uint8_t Index = 0; Index < Size; ++Index)
+	{
+		Buffer[Index] = (uint8_t)(Value >> (8 * Index));
+	}
+	return Size;
+}
+
+uint8_t SMC100ChainedProtocol::PutFloat(uint8_t* Buffer, float Value)
+{
+	uint32_t Bits;
+	memcpy(&Bits, &Value, sizeof(Bits));
+	return PutUnsigned(Buffer, Bits, 4);
+}
+
+uint32_t SMC100ChainedProtocol::GetUnsigned(const uint8_t* Buffer, uint8_t Size)
+{
+	uint32_t Value = 0;
+	for (uint8_t Index = 0; Index < Size; ++Index)
+	{
+		Value |= (uint32_t)Buffer[Index] << (8 * Index);
+	}
+	return Value;
+}
+
+float SMC100ChainedProtocol::GetFloat(const uint8_t* Buffer)
+{
+	uint32_t Bits = GetUnsigned(Buffer, 4);
+	float Value;
+	memcpy(&Value, &Bits, sizeof(Value));
+	return Value;
+}
@@ -0,0 +1,194 @@
+#ifndef SMC100ChainedProtocol_h	//check for multiple inclusions
+#define SMC100ChainedProtocol_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SMC100ChainedProtocolMaxPayload 64
+#define SMC100ChainedProtocolMaxFrame (SMC100ChainedProtocolMaxPayload + 4)
+#define SMC100ChainedProtocolMaxEncoded (SMC100ChainedProtocolMaxFrame + (SMC100ChainedProtocolMaxFrame / 254) + 2)
+#define SMC100ChainedProtocolLatencyBuckets 12
+#define SMC100ChainedProtocolCommandTypes 20
+#define SMC100ChainedProtocolCommandStatsPerFrame 8
+
+class SMC100ChainedProtocol
+{
+	public:
+		enum class MessageType : uint8_t
+		{
+			Snapshot = 0x01,
+			Event = 0x02,
+			Log = 0x03,
+			Stats = 0x04,
+			Ack = 0x05,
+			Error = 0x06,
+			LatencyStats = 0x07,
+			ChainStats = 0x08,
+			CommandStats = 0x09,
+			Command = 0x80,
+			RequestStats = 0x81,
+			RequestSnapshots = 0x82,
+		};
+		enum class RequestType : uint8_t
+		{
+			Home = 0,
+			Enable = 1,
+			MoveAbsolute = 2,
+			MoveRelative = 3,
+			SetVelocity = 4,
+			SetAcceleration = 5,
+			GetPosition = 6,
+			StartJog = 7,
+			StopJog = 8,
+			Count = 9,
+		};
+		struct SnapshotMessage
+		{
+			uint8_t MotorIndex;
+			uint32_t Time;
+			float Position;
+			uint8_t Status;
+			bool HasBeenHomed;
+		};
+		struct EventMessage
+		{
+			uint32_t Time;
+			uint8_t Event;
+			uint8_t MotorIndex;
+			uint8_t Command;
+			uint8_t GetOrSet;
+			float Parameter;
+		};
+		enum class ErrorKind : uint8_t
+		{
+			Timeout = 0,
+			Rejected = 1,
+			ControllerError = 2,
+			HardwareFault = 3,
+			NotSent = 4,
+			Count = 5,
+		};
+		struct ErrorMessage
+		{
+			uint8_t MotorIndex;
+			char Command[2];
+			ErrorKind Kind;
+			char Code;
+			uint16_t Fault;
+		};
+		struct StatsMessage
+		{
+			uint8_t MotorIndex;
+			uint16_t Sent;
+			uint16_t Replies;
+			uint16_t Timeouts;
+			uint16_t Retries;
+			uint16_t AddressMismatches;
+			uint16_t MnemonicMismatches;
+			uint16_t BufferOverflows;
+			uint16_t CommandErrors;
+			uint16_t QueueOverflows;
+			uint16_t RenderFailures;
+			uint16_t DeadlinesMissed;
+			uint16_t Polls;
+			uint16_t StreamSamples;
+			uint16_t StreamOverruns;
+			uint16_t AnalogueSamples;
+			uint16_t AnalogueOverruns;
+			uint16_t GPIOEdges;
+			uint16_t CommandsRejected;
+			uint32_t PollJitterTotal;
+			uint32_t PollJitterMax;
+			uint32_t LatencyMax;
+		};
+		struct LatencyStatsMessage
+		{
+			uint8_t MotorIndex;
+			uint16_t Histogram[SMC100ChainedProtocolLatencyBuckets];
+		};
+		struct ChainStatsMessage
+		{
+			uint32_t BusBusyTime;
+			uint32_t ElapsedTime;
+			uint16_t Resyncs;
+			uint32_t BytesDiscarded;
+			uint16_t FramesDropped;
+		};
+		struct CommandStatsMessage
+		{
+			uint8_t FirstCommand;
+			uint8_t Count;
+			uint16_t Sent[SMC100ChainedProtocolCommandStatsPerFrame];
+			uint16_t Replies[SMC100ChainedProtocolCommandStatsPerFrame];
+			uint16_t Timeouts[SMC100ChainedProtocolCommandStatsPerFrame];
+		};
+		struct AckMessage
+		{
+			uint8_t CommandSequence;
+			bool Accepted;
+		};
+		struct CommandMessage
+		{
+			RequestType Request;
+			uint8_t MotorIndex;
+			float Parameter;
+		};
+		struct Message
+		{
+			MessageType Type;
+			uint8_t Sequence;
+			union
+			{
+				SnapshotMessage Snapshot;
+				EventMessage Event;
+				StatsMessage Stats;
+				LatencyStatsMessage LatencyStats;
+				ChainStatsMessage ChainStats;
+				CommandStatsMessage CommandStats;
+				ErrorMessage Error;
+				AckMessage Ack;
+				CommandMessage Command;
+				uint8_t MotorIndex;
+			};
+			char Text[SMC100ChainedProtocolMaxPayload + 1];
+		};
+		class Decoder
+		{
+			public:
+				Decoder();
+				bool Push(uint8_t Byte);
+				const Message& GetMessage();
+				const ErrorMessage* GetError();
+				uint16_t GetErrors();
+				void Reset();
+			private:
+				uint8_t Encoded[SMC100ChainedProtocolMaxEncoded];
+				uint8_t EncodedLength;
+				bool Discarding;
+				uint16_t Errors;
+				Message Current;
+		};
+		static size_t CobsEncode(const uint8_t* Input, size_t Length, uint8_t* Output);
+		static size_t CobsDecode(const uint8_t* Input, size_t Length, uint8_t* Output);
+		static uint16_t Crc16(const uint8_t* Data, size_t Length);
+		static size_t EncodeFrame(MessageType Type, uint8_t Sequence, const uint8_t* Payload, size_t Length, uint8_t* Output);
+		static bool ParseFrame(const uint8_t* Frame, size_t Length, Message* MessageReturn);
+		static size_t BuildSnapshot(uint8_t Sequence, const SnapshotMessage& Snapshot, uint8_t* Output);
+		static size_t BuildEvent(uint8_t Sequence, const EventMessage& Event, uint8_t* Output);
+		static size_t BuildStats(uint8_t Sequence, const StatsMessage& Stats, uint8_t* Output);
+		static size_t BuildLatencyStats(uint8_t Sequence, const LatencyStatsMessage& Stats, uint8_t* Output);
+		static size_t BuildChainStats(uint8_t Sequence, const ChainStatsMessage& Stats, uint8_t* Output);
+		static size_t BuildCommandStats(uint8_t Sequence, const CommandStatsMessage& Stats, uint8_t* Output);
+		static size_t BuildError(uint8_t Sequence, const ErrorMessage& Error, uint8_t* Output);
+		static size_t BuildAck(uint8_t Sequence, const AckMessage& Ack, uint8_t* Output);
+		static size_t BuildLog(uint8_t Sequence, const char* Text, uint8_t* Output);
+		static size_t BuildCommand(uint8_t Sequence, RequestType Request, uint8_t MotorIndex, float Parameter, uint8_t* Output);
+		static size_t BuildRequest(uint8_t Sequence, MessageType Type, uint8_t MotorIndex, uint8_t* Output);
+	private:
+		static uint8_t PutUnsigned(uint8_t* Buffer, uint32_t Value, uint8_t Size);
+		static uint8_t PutFloat(uint8_t* Buffer, float Value);
+		static uint32_t GetUnsigned(const uint8_t* Buffer, uint8_t Size);
+		static float GetFloat(const uint8_t* Buffer);
+};
+
+#endif
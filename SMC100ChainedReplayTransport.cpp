@@ -0,0 +1,320 @@
+#include "SMC100ChainedReplayTransport.h"
+
+#if !defined(ARDUINO)
+
+#include <stdlib.h>
+#include <string.h>
+
+SMC100ChainedReplayTransport::SMC100ChainedReplayTransport()
+{
+	Recording = NULL;
+	RecordingLength = 0;
+	OwnedRecording = NULL;
+	RecordedRoundTrips = 0;
+	RecordedElapsed = 0;
+	LogCallback = NULL;
+	Rewind();
+}
+
+SMC100ChainedReplayTransport::~SMC100ChainedReplayTransport()
+{
+	free(OwnedRecording);
+}
+
+bool SMC100ChainedReplayTransport::Load(const uint8_t* Data, size_t Length)
+{
+	//The data is not copied and has to outlive the replay.
+	if ( (Data == NULL) || (Length < SMC100ChainedCaptureHeaderSize) || (memcmp(Data, "SMCC", 4) != 0) || (Data[4] != SMC100ChainedCaptureVersion) )
+	{
+		return false;
+	}
+	Recording = Data;
+	RecordingLength = Length;
+	//One pass over the transmitted side gives the figures a replay is judged against.
+	RecordedRoundTrips = 0;
+	Cursor Scan;
+	Scan.Offset = SMC100ChainedCaptureHeaderSize;
+	Scan.Time = 0;
+	uint32_t FirstTransmitTime = 0;
+	if (NextRecord(&Scan, false))
+	{
+		FirstTransmitTime = Scan.Time;
+	}
+	Scan.Offset = SMC100ChainedCaptureHeaderSize;
+	Scan.Time = 0;
+	while (NextRecord(&Scan, false))
+	{
+		for (uint8_t Index = 0; Index < Scan.Length; ++Index)
+		{
+			if (Scan.Data[Index] == '\n')
+			{
+				RecordedRoundTrips++;
+			}
+		}
+	}
+	Scan.Offset = SMC100ChainedCaptureHeaderSize;
+	Scan.Time = 0;
+	RecordedElapsed = 0;
+	while (NextRecord(&Scan, true))
+	{
+		RecordedElapsed = Scan.Time - FirstTransmitTime;
+	}
+	Rewind();
+	return true;
+}
+
+bool SMC100ChainedReplayTransport::LoadFile(const char* Path)
+{
+	FILE* File = fopen(Path, "rb");
+	if (File == NULL)
+	{
+		return false;
+	}
+	fseek(File, 0, SEEK_END);
+	long Size = ftell(File);
+	fseek(File, 0, SEEK_SET);
+	if (Size <= 0)
+	{
+		fclose(File);
+		return false;
+	}
+	uint8_t* Data = (uint8_t*)malloc(Size);
+	if ( (Data == NULL) || (fread(Data, 1, Size, File) != (size_t)Size) )
+	{
+		free(Data);
+		fclose(File);
+		return false;
+	}
+	fclose(File);
+	if (!Load(Data, Size))
+	{
+		free(Data);
+		return false;
+	}
+	free(OwnedRecording);
+	OwnedRecording = Data;
+	return true;
+}
+
+void SMC100ChainedReplayTransport::Rewind()
+{
+	ReceivedCursor.Offset = SMC100ChainedCaptureHeaderSize;
+	ReceivedCursor.Time = 0;
+	ReceivedCursor.Valid = false;
+	TransmitCursor = ReceivedCursor;
+	if (Recording != NULL)
+	{
+		NextRecord(&ReceivedCursor, true);
+		NextRecord(&TransmitCursor, false);
+	}
+	Now = 0;
+	FirstWriteTime = 0;
+	LastReadTime = 0;
+	HaveWritten = false;
+	Offset = 0;
+	RoundTrips = 0;
+	Mismatches = 0;
+}
+
+bool SMC100ChainedReplayTransport::NextRecord(Cursor* Position, bool Received)
+{
+	//Times are accumulated over records of both directions, since each delta is from the record just before it.
+	Position->Valid = false;
+	while (Position->Offset < RecordingLength)
+	{
+		uint8_t Header = Recording[Position->Offset];
+		Position->Offset++;
+		uint32_t Delta = 0;
+		uint8_t Shift = 0;
+		uint8_t Byte;
+		do
+		{
+			if ( (Position->Offset >= RecordingLength) || (Shift > 28) )
+			{
+				return false;
+			}
+			Byte = Recording[Position->Offset];
+			Position->Offset++;
+			Delta |= (uint32_t)(Byte & 0x7F) << Shift;
+			Shift += 7;
+		}
+		while (Byte & 0x80);
+		uint8_t Length = Header & ~SMC100ChainedCaptureReceivedFlag;
+		if ( (Length == 0) || ((Position->Offset + Length) > RecordingLength) )
+		{
+			return false;
+		}
+		Position->Time += Delta;
+		const uint8_t* Data = Recording + Position->Offset;
+		Position->Offset += Length;
+		if ( ((Header & SMC100ChainedCaptureReceivedFlag) != 0) == Received )
+		{
+			Position->Data = Data;
+			Position->Length = Length;
+			Position->Index = 0;
+			Position->Valid = true;
+			return true;
+		}
+	}
+	return false;
+}
+
+uint32_t SMC100ChainedReplayTransport::ReceivedDueTime()
+{
+	return ReceivedCursor.Time + Offset;
+}
+
+bool SMC100ChainedReplayTransport::ReceivedReady()
+{
+	//A reply recorded after a command is held back until the chain has started sending that command, however late that is.
+	if (!ReceivedCursor.Valid)
+	{
+		return false;
+	}
+	return !( TransmitCursor.Valid && (TransmitCursor.Index == 0) && ((int32_t)(ReceivedCursor.Time - TransmitCursor.Time) > 0) );
+}
+
+bool SMC100ChainedReplayTransport::ReceivedDue()
+{
+	return ReceivedReady() && ((int32_t)(Now - ReceivedDueTime()) >= 0);
+}
+
+bool SMC100ChainedReplayTransport::IsFinished()
+{
+	return !ReceivedCursor.Valid && !TransmitCursor.Valid;
+}
+
+void SMC100ChainedReplayTransport::GetResult(ReplayResult* ResultReturn)
+{
+	//Both elapsed figures run from the first transmitted byte to the last received one, so idle time at either end does not count.
+	ResultReturn->Elapsed = HaveWritten ? (LastReadTime - FirstWriteTime) : 0;
+	ResultReturn->RecordedElapsed = RecordedElapsed;
+	ResultReturn->RoundTrips = RoundTrips;
+	ResultReturn->RecordedRoundTrips = RecordedRoundTrips;
+	ResultReturn->Mismatches = Mismatches;
+	ResultReturn->UnusedReceived = 0;
+	Cursor Scan = ReceivedCursor;
+	if (Scan.Valid)
+	{
+		ResultReturn->UnusedReceived = Scan.Length - Scan.Index;
+		while (NextRecord(&Scan, true))
+		{
+			ResultReturn->UnusedReceived += Scan.Length;
+		}
+	}
+	ResultReturn->Finished = IsFinished();
+}
+
+void SMC100ChainedReplayTransport::SetLogCallback(LogListener Callback)
+{
+	LogCallback = Callback;
+}
+
+void SMC100ChainedReplayTransport::Begin(uint32_t BaudRate)
+{
+	(void)BaudRate;
+}
+
+int SMC100ChainedReplayTransport::Available()
+{
+	if (!ReceivedDue())
+	{
+		return 0;
+	}
+	return ReceivedCursor.Length - ReceivedCursor.Index;
+}
+
+int SMC100ChainedReplayTransport::Read()
+{
+	if (!ReceivedDue())
+	{
+		return -1;
+	}
+	uint8_t Value = ReceivedCursor.Data[ReceivedCursor.Index];
+	ReceivedCursor.Index++;
+	LastReadTime = Now;
+	if (ReceivedCursor.Index >= ReceivedCursor.Length)
+	{
+		NextRecord(&ReceivedCursor, true);
+	}
+	return Value;
+}
+
+size_t SMC100ChainedReplayTransport::Write(const uint8_t* Data, size_t Length)
+{
+	//Replies are re-anchored on when the chain actually sends, so a slower dispatch shows up as a longer elapsed time.
+	if ( !HaveWritten && (Length > 0) )
+	{
+		FirstWriteTime = Now;
+		HaveWritten = true;
+	}
+	for (size_t Index = 0; Index < Length; ++Index)
+	{
+		if (TransmitCursor.Valid)
+		{
+			if (TransmitCursor.Index == 0)
+			{
+				Offset = (int32_t)(Now - TransmitCursor.Time);
+			}
+			if (TransmitCursor.Data[TransmitCursor.Index] != Data[Index])
+			{
+				Mismatches++;
+			}
+			TransmitCursor.Index++;
+			if (TransmitCursor.Index >= TransmitCursor.Length)
+			{
+				NextRecord(&TransmitCursor, false);
+			}
+		}
+		else
+		{
+			Mismatches++;
+		}
+		if (Data[Index] == '\n')
+		{
+			RoundTrips++;
+		}
+	}
+	return Length;
+}
+
+int SMC100ChainedReplayTransport::AvailableForWrite()
+{
+	return SMC100ChainedReplayWriteRoom;
+}
+
+uint32_t SMC100ChainedReplayTransport::Micros()
+{
+	return Now;
+}
+
+void SMC100ChainedReplayTransport::Log(const char* Text)
+{
+	if (LogCallback != NULL)
+	{
+		LogCallback(Text);
+	}
+}
+
+int SMC100ChainedReplayTransport::LogAvailableForWrite()
+{
+	return SMC100ChainedReplayWriteRoom;
+}
+
+bool SMC100ChainedReplayTransport::Wait(uint32_t Timeout)
+{
+	//Time only moves here, jumping straight to the next recorded reply, so a replay runs as fast as the host allows and always the same way.
+	if (ReceivedDue())
+	{
+		return true;
+	}
+	if ( ReceivedReady() && ((ReceivedDueTime() - Now) <= Timeout) )
+	{
+		Now = ReceivedDueTime();
+		return true;
+	}
+	Now += Timeout;
+	return false;
+}
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef SMC100ChainedReplayTransport_h	//check for multiple inclusions
+#define SMC100ChainedReplayTransport_h
+
+#if !defined(ARDUINO)
+
+#include "SMC100ChainedCaptureTransport.h"
+
+#define SMC100ChainedReplayWriteRoom 1024
+
+class SMC100ChainedReplayTransport : public SMC100ChainedTransport
+{
+	public:
+		typedef void ( *LogListener )(const char* Text);
+		struct ReplayResult
+		{
+			uint32_t Elapsed;
+			uint32_t RecordedElapsed;
+			uint32_t RoundTrips;
+			uint32_t RecordedRoundTrips;
+			uint32_t Mismatches;
+			uint32_t UnusedReceived;
+			bool Finished;
+		};
+		SMC100ChainedReplayTransport();
+		~SMC100ChainedReplayTransport();
+		bool Load(const uint8_t* Data, size_t Length);
+		bool LoadFile(const char* Path);
+		void Rewind();
+		bool IsFinished();
+		void GetResult(ReplayResult* ResultReturn);
+		void SetLogCallback(LogListener Callback);
+		void Begin(uint32_t BaudRate);
+		int Available();
+		int Read();
+		size_t Write(const uint8_t* Data, size_t Length);
+		int AvailableForWrite();
+		uint32_t Micros();
+		void Log(const char* Text);
+		int LogAvailableForWrite();
+		bool Wait(uint32_t Timeout);
+	private:
+		struct Cursor
+		{
+			size_t Offset;
+			uint32_t Time;
+			const uint8_t* Data;
+			uint8_t Length;
+			uint8_t Index;
+			bool Valid;
+		};
+		bool NextRecord(Cursor* Position, bool Received);
+		bool ReceivedReady();
+		bool ReceivedDue();
+		uint32_t ReceivedDueTime();
+		const uint8_t* Recording;
+		size_t RecordingLength;
+		uint8_t* OwnedRecording;
+		Cursor ReceivedCursor;
+		Cursor TransmitCursor;
+		uint32_t Now;
+		uint32_t FirstWriteTime;
+		uint32_t LastReadTime;
+		bool HaveWritten;
+		int32_t Offset;
+		uint32_t RoundTrips;
+		uint32_t RecordedRoundTrips;
+		uint32_t RecordedElapsed;
+		uint32_t Mismatches;
+		LogListener LogCallback;
+};
+
+#endif
+
+#endif
@@ -0,0 +1,487 @@
+#include "SMC100ChainedSharedMemory.h"
+
+#if defined(__linux__) && !defined(ARDUINO)
+
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+const uint32_t SMC100ChainedSharedMemory::LayoutMagic = 0x534D4332;
+const uint32_t SMC100ChainedSharedMemory::StatsIntervalDefault = 100000;
+
+SMC100ChainedSharedMemory::SMC100ChainedSharedMemory()
+{
+	Chain = NULL;
+	Shared = NULL;
+	Owner = false;
+	PublishedSnapshotSequence = 0;
+	StatsInterval = StatsIntervalDefault;
+	StatsPublishedTime = 0;
+	SegmentName[0] = '\0';
+}
+
+SMC100ChainedSharedMemory::~SMC100ChainedSharedMemory()
+{
+	Close();
+}
+
+bool SMC100ChainedSharedMemory::Create(const char* Name, SMC100Chained* chain, uint16_t Mode)
+{
+	//The process that owns the bus creates the segment, every other process attaches to it.
+	if ( (chain == NULL) || !Map(Name, true, Mode) )
+	{
+		return false;
+	}
+	Chain = chain;
+	Shared->AxisCount = Chain->GetMotorCount();
+	Shared->Sequence.store(0, std::memory_order_relaxed);
+	Shared->StatsSequence.store(0, std::memory_order_relaxed);
+	Shared->CommandsRejected.store(0, std::memory_order_relaxed);
+	for (uint8_t Index = 0; Index < SMC100ChainedMaxMotors; ++Index)
+	{
+		Shared->StreamHead[Index].store(0, std::memory_order_relaxed);
+	}
+	Shared->CommandHead.store(0, std::memory_order_relaxed);
+	Shared->CommandTail.store(0, std::memory_order_relaxed);
+	for (uint32_t Index = 0; Index < SMC100ChainedSharedMemoryCommandCount; ++Index)
+	{
+		Shared->Commands[Index].Sequence.store(Index, std::memory_order_relaxed);
+	}
+	PublishedSnapshotSequence = Chain->GetSnapshotSequence();
+	PublishAxes();
+	StatsPublishedTime = Chain->GetTransport()->Micros();
+	PublishStats();
+	//Readers check the magic last, so they never attach to a half initialised segment.
+	std::atomic_thread_fence(std::memory_order_release);
+	Shared->Size = sizeof(Layout);
+	Shared->Magic = LayoutMagic;
+	return true;
+}
+
+bool SMC100ChainedSharedMemory::Remove(const char* Name)
+{
+	//Create() will not take over an existing segment, a daemon that knows the previous owner is gone clears it with this first.
+	return ( (Name != NULL) && ( (shm_unlink(Name) == 0) || (errno == ENOENT) ) );
+}
+
+bool SMC100ChainedSharedMemory::Attach(const char* Name)
+{
+	if (!Map(Name, false, 0))
+	{
+		return false;
+	}
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if ( (Shared->Magic != LayoutMagic) || (Shared->Size != sizeof(Layout)) )
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+bool SMC100ChainedSharedMemory::Map(const char* Name, bool owner, uint16_t Mode)
+{
+	if ( (Shared != NULL) || (Name == NULL) || (strlen(Name) >= sizeof(SegmentName)) )
+	{
+		return false;
+	}
+	//The owner only ever creates a new segment, a live one belonging to another daemon is never truncated under its readers.
+	int Descriptor = owner ? shm_open(Name, O_RDWR | O_CREAT | O_EXCL, (mode_t)Mode) : shm_open(Name, O_RDWR, 0);
+	if (Descriptor < 0)
+	{
+		return false;
+	}
+	//The umask would otherwise narrow the requested mode.
+	if ( owner && ( (fchmod(Descriptor, (mode_t)Mode) != 0) || (ftruncate(Descriptor, sizeof(Layout)) != 0) ) )
+	{
+		close(Descriptor);
+		shm_unlink(Name);
+		return false;
+	}
+	struct stat Status;
+	if ( (fstat(Descriptor, &Status) != 0) || ((size_t)Status.st_size < sizeof(Layout)) )
+	{
+		close(Descriptor);
+		return false;
+	}
+	void* Address = mmap(NULL, sizeof(Layout), PROT_READ | PROT_WRITE, MAP_SHARED, Descriptor, 0);
+	close(Descriptor);
+	if (Address == MAP_FAILED)
+	{
+		if (owner)
+		{
+			shm_unlink(Name);
+		}
+		return false;
+	}
+	Shared = (Layout*)Address;
+	Owner = owner;
+	strcpy(SegmentName, Name);
+	return true;
+}
+
+void SMC100ChainedSharedMemory::Close()
+{
+	if (Shared == NULL)
+	{
+		return;
+	}
+	if (Owner)
+	{
+		Shared->Magic = 0;
+		shm_unlink(SegmentName);
+	}
+	munmap(Shared, sizeof(Layout));
+	Shared = NULL;
+	Chain = NULL;
+	Owner = false;
+}
+
+bool SMC100ChainedSharedMemory::IsOpen()
+{
+	return (Shared != NULL);
+}
+
+void SMC100ChainedSharedMemory::Publish()
+{
+	//Called from the thread that runs Check(), after it, so the copy never races the chain itself.
+	if ( (Shared == NULL) || !Owner )
+	{
+		return;
+	}
+	for (uint8_t Index = 0; Index < Shared->AxisCount; ++Index)
+	{
+		PublishStream(Index);
+	}
+	//Counters move on every exchange, so they go out on their own period rather than with each snapshot.
+	uint32_t Now = Chain->GetTransport()->Micros();
+	bool StatsDue = ( (Now - StatsPublishedTime) >= StatsInterval );
+	uint32_t SnapshotSequence = Chain->GetSnapshotSequence();
+	if ( (SnapshotSequence != PublishedSnapshotSequence) || StatsDue )
+	{
+		PublishedSnapshotSequence = SnapshotSequence;
+		PublishAxes();
+	}
+	if (StatsDue)
+	{
+		StatsPublishedTime = Now;
+		PublishStats();
+	}
+}
+
+void SMC100ChainedSharedMemory::SetStatsInterval(uint32_t Interval)
+{
+	StatsInterval = Interval;
+}
+
+void SMC100ChainedSharedMemory::PublishAxes()
+{
+	//Motor records change with replies that do not touch the snapshots, so the periodic pass refreshes them too.
+	uint32_t Sequence = Shared->Sequence.load(std::memory_order_relaxed);
+	Shared->Sequence.store(Sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	Chain->ReadAllSnapshots(Shared->Axes, Shared->AxisCount);
+	for (uint8_t Index = 0; Index < Shared->AxisCount; ++Index)
+	{
+		Chain->GetMotorStatus(Index, &Shared->Motors[Index]);
+		//The callback is an address in this process only.
+		Shared->Motors[Index].FinishedCallback = NULL;
+	}
+	Shared->Sequence.store(Sequence + 2, std::memory_order_release);
+}
+
+void SMC100ChainedSharedMemory::PublishStats()
+{
+	uint32_t Sequence = Shared->StatsSequence.load(std::memory_order_relaxed);
+	Shared->StatsSequence.store(Sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	Chain->GetStats(&Shared->Stats);
+	Shared->StatsSequence.store(Sequence + 2, std::memory_order_release);
+}
+
+void SMC100ChainedSharedMemory::PublishStream(uint8_t MotorIndex)
+{
+	//The shared stream is a broadcast ring, the publisher overwrites old samples and every reader keeps its own cursor.
+	SMC100Chained::PositionSample Samples[SMC100ChainedStreamBufferCount];
+	uint8_t Count = Chain->ReadPositionStream(MotorIndex, Samples, SMC100ChainedStreamBufferCount);
+	if (Count == 0)
+	{
+		return;
+	}
+	uint32_t Head = Shared->StreamHead[MotorIndex].load(std::memory_order_relaxed);
+	for (uint8_t Index = 0; Index < Count; ++Index)
+	{
+		Shared->Stream[MotorIndex][(Head + Index) % SMC100ChainedSharedMemoryStreamCount] = Samples[Index];
+	}
+	Shared->StreamHead[MotorIndex].store(Head + Count, std::memory_order_release);
+}
+
+uint8_t SMC100ChainedSharedMemory::ProcessCommands()
+{
+	if ( (Shared == NULL) || !Owner )
+	{
+		return 0;
+	}
+	uint8_t Count = 0;
+	uint32_t Tail = Shared->CommandTail.load(std::memory_order_relaxed);
+	//Commands left in the shared ring wait for the next call, draining into a full chain queue would overwrite queued work.
+	while ( (Count < SMC100ChainedSharedMemoryCommandCount) && (Chain->GetQueueFree() > 1) )
+	{
+		CommandSlot* Slot = &Shared->Commands[Tail % SMC100ChainedSharedMemoryCommandCount];
+		if (Slot->Sequence.load(std::memory_order_acquire) != (Tail + 1))
+		{
+			break;
+		}
+		RequestType Type = Slot->Type;
+		uint8_t MotorIndex = Slot->MotorIndex;
+		float Parameter = Slot->Parameter;
+		Slot->Sequence.store(Tail + SMC100ChainedSharedMemoryCommandCount, std::memory_order_release);
+		Tail++;
+		Shared->CommandTail.store(Tail, std::memory_order_relaxed);
+		if (!Dispatch(Type, MotorIndex, Parameter))
+		{
+			Shared->CommandsRejected.fetch_add(1, std::memory_order_relaxed);
+		}
+		Count++;
+	}
+	return Count;
+}
+
+bool SMC100ChainedSharedMemory::Dispatch(RequestType Type, uint8_t MotorIndex, float Parameter)
+{
+	if (MotorIndex >= Chain->GetMotorCount())
+	{
+		return false;
+	}
+	uint32_t RejectedBefore = Chain->GetRejectedCount();
+	switch (Type)
+	{
+		case RequestType::Home:
+			Chain->Home(MotorIndex);
+			break;
+		case RequestType::Enable:
+			Chain->Enable(MotorIndex, (Parameter > 0.5));
+			break;
+		case RequestType::MoveAbsolute:
+			Chain->MoveAbsolute(MotorIndex, Parameter);
+			break;
+		case RequestType::MoveRelative:
+			Chain->MoveRelative(MotorIndex, Parameter);
+			break;
+		case RequestType::SetVelocity:
+			Chain->SendSetVelocity(MotorIndex, Parameter);
+			break;
+		case RequestType::SetAcceleration:
+			Chain->SendSetAcceleration(MotorIndex, Parameter);
+			break;
+		case RequestType::GetPosition:
+			Chain->SendGetPosition(MotorIndex);
+			break;
+		case RequestType::StartJog:
+			Chain->StartJog(MotorIndex, Parameter);
+			break;
+		case RequestType::StopJog:
+			Chain->StopJog(MotorIndex);
+			break;
+		default:
+			return false;
+	}
+	return (Chain->GetRejectedCount() == RejectedBefore);
+}
+
+uint8_t SMC100ChainedSharedMemory::GetAxisCount()
+{
+	if (Shared == NULL)
+	{
+		return 0;
+	}
+	return Shared->AxisCount;
+}
+
+uint32_t SMC100ChainedSharedMemory::GetSequence()
+{
+	if (Shared == NULL)
+	{
+		return 0;
+	}
+	return Shared->Sequence.load(std::memory_order_acquire);
+}
+
+bool SMC100ChainedSharedMemory::ReadSnapshot(uint8_t MotorIndex, SMC100Chained::AxisSnapshot* SnapshotReturn)
+{
+	if ( (Shared == NULL) || (MotorIndex >= Shared->AxisCount) )
+	{
+		return false;
+	}
+	for (uint8_t Attempt = 0; Attempt < SMC100ChainedSharedMemoryRetries; ++Attempt)
+	{
+		uint32_t Before = Shared->Sequence.load(std::memory_order_acquire);
+		if ( (Before & 1) == 0 )
+		{
+			*SnapshotReturn = Shared->Axes[MotorIndex];
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (Shared->Sequence.load(std::memory_order_relaxed) == Before)
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+uint8_t SMC100ChainedSharedMemory::ReadAllSnapshots(SMC100Chained::AxisSnapshot* SnapshotsReturn, uint8_t MaxCount)
+{
+	if (Shared == NULL)
+	{
+		return 0;
+	}
+	uint8_t Count = (MaxCount < Shared->AxisCount) ? MaxCount : Shared->AxisCount;
+	for (uint8_t Attempt = 0; Attempt < SMC100ChainedSharedMemoryRetries; ++Attempt)
+	{
+		uint32_t Before = Shared->Sequence.load(std::memory_order_acquire);
+		if ( (Before & 1) == 0 )
+		{
+			memcpy(SnapshotsReturn, Shared->Axes, Count * sizeof(SMC100Chained::AxisSnapshot));
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (Shared->Sequence.load(std::memory_order_relaxed) == Before)
+			{
+				return Count;
+			}
+		}
+	}
+	return 0;
+}
+
+bool SMC100ChainedSharedMemory::ReadMotorStatus(uint8_t MotorIndex, SMC100Chained::MotorStatus* StatusReturn)
+{
+	if ( (Shared == NULL) || (MotorIndex >= Shared->AxisCount) )
+	{
+		return false;
+	}
+	for (uint8_t Attempt = 0; Attempt < SMC100ChainedSharedMemoryRetries; ++Attempt)
+	{
+		uint32_t Before = Shared->Sequence.load(std::memory_order_acquire);
+		if ( (Before & 1) == 0 )
+		{
+			memcpy(StatusReturn, &Shared->Motors[MotorIndex], sizeof(SMC100Chained::MotorStatus));
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (Shared->Sequence.load(std::memory_order_relaxed) == Before)
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+bool SMC100ChainedSharedMemory::ReadStats(SMC100Chained::StatsStruct* StatsReturn)
+{
+	if (Shared == NULL)
+	{
+		return false;
+	}
+	for (uint8_t Attempt = 0; Attempt < SMC100ChainedSharedMemoryRetries; ++Attempt)
+	{
+		uint32_t Before = Shared->StatsSequence.load(std::memory_order_acquire);
+		if ( (Before & 1) == 0 )
+		{
+			memcpy(StatsReturn, &Shared->Stats, sizeof(SMC100Chained::StatsStruct));
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (Shared->StatsSequence.load(std::memory_order_relaxed) == Before)
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+uint32_t SMC100ChainedSharedMemory::GetCommandsRejected()
+{
+	//Submissions are fire and forget, a reader compares this before and after to learn that some were dropped or refused.
+	if (Shared == NULL)
+	{
+		return 0;
+	}
+	return Shared->CommandsRejected.load(std::memory_order_relaxed);
+}
+
+uint8_t SMC100ChainedSharedMemory::ReadPositionStream(uint8_t MotorIndex, uint32_t* Cursor, SMC100Chained::PositionSample* Samples, uint8_t MaxCount)
+{
+	//A reader that fell more than a ring behind skips ahead, samples overwritten during the copy are dropped from the front.
+	if ( (Shared == NULL) || (MotorIndex >= Shared->AxisCount) )
+	{
+		return 0;
+	}
+	uint32_t Head = Shared->StreamHead[MotorIndex].load(std::memory_order_acquire);
+	uint32_t Start = *Cursor;
+	if ( (Head - Start) > SMC100ChainedSharedMemoryStreamCount )
+	{
+		Start = Head - SMC100ChainedSharedMemoryStreamCount;
+	}
+	uint32_t Available = Head - Start;
+	uint8_t Count = (Available < MaxCount) ? Available : MaxCount;
+	for (uint8_t Index = 0; Index < Count; ++Index)
+	{
+		Samples[Index] = Shared->Stream[MotorIndex][(Start + Index) % SMC100ChainedSharedMemoryStreamCount];
+	}
+	std::atomic_thread_fence(std::memory_order_acquire);
+	uint32_t HeadAfter = Shared->StreamHead[MotorIndex].load(std::memory_order_relaxed);
+	uint32_t Overwritten = 0;
+	if ( (HeadAfter - Start) > SMC100ChainedSharedMemoryStreamCount )
+	{
+		Overwritten = (HeadAfter - Start) - SMC100ChainedSharedMemoryStreamCount;
+	}
+	if (Overwritten >= Count)
+	{
+		*Cursor = HeadAfter - SMC100ChainedSharedMemoryStreamCount;
+		return 0;
+	}
+	if (Overwritten > 0)
+	{
+		memmove(Samples, Samples + Overwritten, (Count - Overwritten) * sizeof(SMC100Chained::PositionSample));
+	}
+	*Cursor = Start + Count;
+	return Count - Overwritten;
+}
+
+bool SMC100ChainedSharedMemory::SubmitCommand(RequestType Type, uint8_t MotorIndex, float Parameter)
+{
+	//Bounded multi producer ring, each slot carries its own sequence so producers in different processes only contend on the head.
+	if (Shared == NULL)
+	{
+		return false;
+	}
+	uint32_t Head = Shared->CommandHead.load(std::memory_order_relaxed);
+	CommandSlot* Slot;
+	while (true)
+	{
+		Slot = &Shared->Commands[Head % SMC100ChainedSharedMemoryCommandCount];
+		int32_t Difference = (int32_t)(Slot->Sequence.load(std::memory_order_acquire) - Head);
+		if (Difference == 0)
+		{
+			if (Shared->CommandHead.compare_exchange_weak(Head, Head + 1, std::memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		else if (Difference < 0)
+		{
+			return false;
+		}
+		else
+		{
+			Head = Shared->CommandHead.load(std::memory_order_relaxed);
+		}
+	}
+	Slot->Type = Type;
+	Slot->MotorIndex = MotorIndex;
+	Slot->Parameter = Parameter;
+	Slot->Sequence.store(Head + 1, std::memory_order_release);
+	return true;
+}
+
+#endif
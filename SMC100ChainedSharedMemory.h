@@ -0,0 +1,90 @@
+#ifndef SMC100ChainedSharedMemory_h	//check for multiple inclusions
+#define SMC100ChainedSharedMemory_h
+
+#if defined(__linux__) && !defined(ARDUINO)
+
+#include "SMC100Chained.h"
+#include <atomic>
+
+#define SMC100ChainedSharedMemoryStreamCount 64
+#define SMC100ChainedSharedMemoryCommandCount 32
+#define SMC100ChainedSharedMemoryRetries 8
+
+class SMC100ChainedSharedMemory
+{
+	public:
+		enum class RequestType : uint8_t
+		{
+			Home = 0,
+			Enable = 1,
+			MoveAbsolute = 2,
+			MoveRelative = 3,
+			SetVelocity = 4,
+			SetAcceleration = 5,
+			GetPosition = 6,
+			StartJog = 7,
+			StopJog = 8,
+		};
+		SMC100ChainedSharedMemory();
+		~SMC100ChainedSharedMemory();
+		bool Create(const char* Name, SMC100Chained* chain, uint16_t Mode = 0660);
+		static bool Remove(const char* Name);
+		bool Attach(const char* Name);
+		void Close();
+		bool IsOpen();
+		void Publish();
+		void SetStatsInterval(uint32_t Interval);
+		uint8_t ProcessCommands();
+		uint8_t GetAxisCount();
+		uint32_t GetSequence();
+		bool ReadSnapshot(uint8_t MotorIndex, SMC100Chained::AxisSnapshot* SnapshotReturn);
+		uint8_t ReadAllSnapshots(SMC100Chained::AxisSnapshot* SnapshotsReturn, uint8_t MaxCount);
+		bool ReadMotorStatus(uint8_t MotorIndex, SMC100Chained::MotorStatus* StatusReturn);
+		bool ReadStats(SMC100Chained::StatsStruct* StatsReturn);
+		uint32_t GetCommandsRejected();
+		uint8_t ReadPositionStream(uint8_t MotorIndex, uint32_t* Cursor, SMC100Chained::PositionSample* Samples, uint8_t MaxCount);
+		bool SubmitCommand(RequestType Type, uint8_t MotorIndex, float Parameter);
+	private:
+		struct CommandSlot
+		{
+			std::atomic<uint32_t> Sequence;
+			RequestType Type;
+			uint8_t MotorIndex;
+			float Parameter;
+		};
+		struct Layout
+		{
+			uint32_t Magic;
+			uint32_t Size;
+			uint8_t AxisCount;
+			std::atomic<uint32_t> Sequence;
+			SMC100Chained::AxisSnapshot Axes[SMC100ChainedMaxMotors];
+			SMC100Chained::MotorStatus Motors[SMC100ChainedMaxMotors];
+			std::atomic<uint32_t> StatsSequence;
+			SMC100Chained::StatsStruct Stats;
+			std::atomic<uint32_t> StreamHead[SMC100ChainedMaxMotors];
+			SMC100Chained::PositionSample Stream[SMC100ChainedMaxMotors][SMC100ChainedSharedMemoryStreamCount];
+			std::atomic<uint32_t> CommandHead;
+			std::atomic<uint32_t> CommandTail;
+			CommandSlot Commands[SMC100ChainedSharedMemoryCommandCount];
+			std::atomic<uint32_t> CommandsRejected;
+		};
+		static const uint32_t LayoutMagic;
+		static const uint32_t StatsIntervalDefault;
+		bool Map(const char* Name, bool Owner, uint16_t Mode);
+		void PublishAxes();
+		void PublishStats();
+		void PublishStream(uint8_t MotorIndex);
+		bool Dispatch(RequestType Type, uint8_t MotorIndex, float Parameter);
+		SMC100Chained* Chain;
+		Layout* Shared;
+		bool Owner;
+		uint32_t PublishedSnapshotSequence;
+		uint32_t StatsInterval;
+		uint32_t StatsPublishedTime;
+		char SegmentName[64];
+};
+
+#endif
+
+#endif
@@ -0,0 +1,386 @@
+#include "SMC100ChainedThreaded.h"
+#include <math.h>
+
+#if !defined(ARDUINO)
+
+SMC100ChainedThreaded::SMC100ChainedThreaded(SMC100Chained* chain)
+{
+	Chain = chain;
+	ProducerCount = 0;
+	EventsDropped = 0;
+	Running = false;
+	for (uint8_t Index = 0; Index < SMC100ChainedThreadedMaxProducers; ++Index)
+	{
+		Requests[Index].Head = 0;
+		Requests[Index].Tail = 0;
+		Events[Index].Head = 0;
+		Events[Index].Tail = 0;
+	}
+	for (uint8_t Index = 0; Index < SMC100ChainedThreadedPendingCount; ++Index)
+	{
+		Pending[Index].Active = false;
+	}
+	PendingOrder = 0;
+	Dispatching = false;
+	Chain->SetCommandOutcomeCallback(HandleOutcome, this);
+}
+
+SMC100ChainedThreaded::~SMC100ChainedThreaded()
+{
+	Stop();
+	Chain->SetCommandOutcomeCallback(NULL, NULL);
+}
+
+int8_t SMC100ChainedThreaded::RegisterProducer()
+{
+	//Each producer thread gets its own request and event ring, so every ring has exactly one writer and one reader.
+	uint8_t Producer = ProducerCount.fetch_add(1);
+	if (Producer >= SMC100ChainedThreadedMaxProducers)
+	{
+		ProducerCount = SMC100ChainedThreadedMaxProducers;
+		return -1;
+	}
+	return (int8_t)Producer;
+}
+
+bool SMC100ChainedThreaded::Submit(uint8_t Producer, const Request& NewRequest)
+{
+	if (Producer >= ProducerCount)
+	{
+		return false;
+	}
+	if (!RingPush(&Requests[Producer], NewRequest))
+	{
+		return false;
+	}
+	Chain->GetTransport()->Wake();
+	return true;
+}
+
+bool SMC100ChainedThreaded::Submit(uint8_t Producer, RequestType Type, uint8_t MotorIndex, float Parameter, uint32_t Tag)
+{
+	Request NewRequest;
+	NewRequest.Type = Type;
+	NewRequest.MotorIndex = MotorIndex;
+	NewRequest.Parameter = Parameter;
+	NewRequest.Tag = Tag;
+	return Submit(Producer, NewRequest);
+}
+
+bool SMC100ChainedThreaded::PollEvent(uint8_t Producer, Event* EventReturn)
+{
+	if (Producer >= ProducerCount)
+	{
+		return false;
+	}
+	return RingPop(&Events[Producer], EventReturn);
+}
+
+uint32_t SMC100ChainedThreaded::GetEventsDropped()
+{
+	return EventsDropped;
+}
+
+bool SMC100ChainedThreaded::Start()
+{
+	if (Running)
+	{
+		return false;
+	}
+	Running = true;
+	Thread = std::thread(&SMC100ChainedThreaded::ThreadLoop, this);
+	return true;
+}
+
+void SMC100ChainedThreaded::Stop()
+{
+	if (!Running)
+	{
+		return;
+	}
+	Running = false;
+	Chain->GetTransport()->Wake();
+	if (Thread.joinable())
+	{
+		Thread.join();
+	}
+}
+
+template <typename EntryType>
+bool SMC100ChainedThreaded::RingPush(Ring<EntryType>* Target, const EntryType& Entry)
+{
+	//Head is only written by the producer and Tail only by the consumer, acquire and release order the entry with the index.
+	uint32_t Head = Target->Head.load(std::memory_order_relaxed);
+	if ( (Head - Target->Tail.load(std::memory_order_acquire)) >= SMC100ChainedThreadedRingSize )
+	{
+		return false;
+	}
+	Target->Entries[Head % SMC100ChainedThreadedRingSize] = Entry;
+	Target->Head.store(Head + 1, std::memory_order_release);
+	return true;
+}
+
+template <typename EntryType>
+bool SMC100ChainedThreaded::RingPop(Ring<EntryType>* Source, EntryType* EntryReturn)
+{
+	uint32_t Tail = Source->Tail.load(std::memory_order_relaxed);
+	if (Tail == Source->Head.load(std::memory_order_acquire))
+	{
+		return false;
+	}
+	*EntryReturn = Source->Entries[Tail % SMC100ChainedThreadedRingSize];
+	Source->Tail.store(Tail + 1, std::memory_order_release);
+	return true;
+}
+
+void SMC100ChainedThreaded::ThreadLoop()
+{
+	//The chain is only ever touched from this thread.
+	while (Running)
+	{
+		DrainRequests();
+		Chain->Check();
+		CheckPending();
+		//Requests held back for room are not announced again by Wake(), so the loop must not sleep on them.
+		uint32_t Wait = Chain->TimeUntilNextCheck();
+		if ( RequestsWaiting() && HasPendingRoom() && (Chain->GetQueueFree() > 1) )
+		{
+			Wait = 0;
+		}
+		Chain->GetTransport()->Wait(Wait);
+	}
+}
+
+void SMC100ChainedThreaded::DrainRequests()
+{
+	uint8_t Count = ProducerCount;
+	if (Count > SMC100ChainedThreadedMaxProducers)
+	{
+		Count = SMC100ChainedThreadedMaxProducers;
+	}
+	Request Incoming;
+	for (uint8_t Producer = 0; Producer < Count; ++Producer)
+	{
+		//Requests stay in their ring while the chain queue or the pending list has no room, which pushes back on Submit.
+		while ( (Chain->GetQueueFree() > 1) && HasPendingRoom() && RingPop(&Requests[Producer], &Incoming) )
+		{
+			Dispatch(Producer, Incoming);
+		}
+	}
+}
+
+bool SMC100ChainedThreaded::RequestsWaiting()
+{
+	uint8_t Count = ProducerCount;
+	if (Count > SMC100ChainedThreadedMaxProducers)
+	{
+		Count = SMC100ChainedThreadedMaxProducers;
+	}
+	for (uint8_t Producer = 0; Producer < Count; ++Producer)
+	{
+		if (Requests[Producer].Head.load(std::memory_order_acquire) != Requests[Producer].Tail.load(std::memory_order_relaxed))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool SMC100ChainedThreaded::HasPendingRoom()
+{
+	for (uint8_t Index = 0; Index < SMC100ChainedThreadedPendingCount; ++Index)
+	{
+		if (!Pending[Index].Active)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void SMC100ChainedThreaded::Dispatch(uint8_t Producer, const Request& Incoming)
+{
+	if (Incoming.MotorIndex >= Chain->GetMotorCount())
+	{
+		PushEvent(Producer, EventType::Rejected, Incoming.MotorIndex, Incoming.Tag);
+		return;
+	}
+	//Each request is tracked by the command it queues, moves and homing then also wait for the axis to stop.
+	uint32_t RejectedBefore = Chain->GetRejectedCount();
+	SMC100Chained::CommandType Command = SMC100Chained::CommandType::None;
+	bool WaitForStop = false;
+	Dispatching = true;
+	switch (Incoming.Type)
+	{
+		case RequestType::Home:
+			if (Chain->IsHomed(Incoming.MotorIndex))
+			{
+				//Nothing is sent for an axis that is already homed.
+				Chain->Home(Incoming.MotorIndex);
+				Dispatching = false;
+				PushEvent(Producer, EventType::Completed, Incoming.MotorIndex, Incoming.Tag);
+				return;
+			}
+			Chain->Home(Incoming.MotorIndex);
+			Command = SMC100Chained::CommandType::Home;
+			WaitForStop = true;
+			break;
+		case RequestType::Enable:
+			Chain->Enable(Incoming.MotorIndex, (Incoming.Parameter > 0.5));
+			Command = SMC100Chained::CommandType::Enable;
+			break;
+		case RequestType::MoveAbsolute:
+			Chain->MoveAbsolute(Incoming.MotorIndex, Incoming.Parameter);
+			Command = SMC100Chained::CommandType::MoveAbs;
+			WaitForStop = true;
+			break;
+		case RequestType::MoveRelative:
+			Chain->MoveRelative(Incoming.MotorIndex, Incoming.Parameter);
+			Command = SMC100Chained::CommandType::MoveRel;
+			WaitForStop = true;
+			break;
+		case RequestType::SetVelocity:
+			Chain->SendSetVelocity(Incoming.MotorIndex, Incoming.Parameter);
+			Command = SMC100Chained::CommandType::Velocity;
+			break;
+		case RequestType::SetAcceleration:
+			Chain->SendSetAcceleration(Incoming.MotorIndex, Incoming.Parameter);
+			Command = SMC100Chained::CommandType::Acceleration;
+			break;
+		case RequestType::GetPosition:
+			Chain->SendGetPosition(Incoming.MotorIndex);
+			Command = SMC100Chained::CommandType::PositionReal;
+			break;
+		case RequestType::StartJog:
+			//A jog is under way once the controller has taken its first step.
+			Chain->StartJog(Incoming.MotorIndex, Incoming.Parameter);
+			Command = SMC100Chained::CommandType::MoveRel;
+			break;
+		case RequestType::StopJog:
+			//A jog stopped before its first step went out is finished all the same.
+			for (uint8_t Index = 0; Index < SMC100ChainedThreadedPendingCount; ++Index)
+			{
+				PendingEntry* Entry = &Pending[Index];
+				if ( Entry->Active && (Entry->MotorIndex == Incoming.MotorIndex) && (Entry->Command == SMC100Chained::CommandType::MoveRel) && !Entry->WaitForStop )
+				{
+					Entry->Active = false;
+					PushEvent(Entry->Producer, EventType::Completed, Entry->MotorIndex, Entry->Tag);
+				}
+			}
+			Chain->StopJog(Incoming.MotorIndex);
+			WaitForStop = true;
+			break;
+	}
+	Dispatching = false;
+	if (Chain->GetRejectedCount() != RejectedBefore)
+	{
+		PushEvent(Producer, EventType::Rejected, Incoming.MotorIndex, Incoming.Tag);
+		return;
+	}
+	for (uint8_t Index = 0; Index < SMC100ChainedThreadedPendingCount; ++Index)
+	{
+		if (!Pending[Index].Active)
+		{
+			Pending[Index].Active = true;
+			Pending[Index].WaitForStop = WaitForStop;
+			Pending[Index].Acknowledged = false;
+			Pending[Index].Command = Command;
+			Pending[Index].Producer = Producer;
+			Pending[Index].MotorIndex = Incoming.MotorIndex;
+			Pending[Index].Tag = Incoming.Tag;
+			Pending[Index].Order = PendingOrder++;
+			return;
+		}
+	}
+	EventsDropped++;
+}
+
+void SMC100ChainedThreaded::CheckPending()
+{
+	//Only the motion is watched here, every command has already been answered by the controller.
+	for (uint8_t Index = 0; Index < SMC100ChainedThreadedPendingCount; ++Index)
+	{
+		PendingEntry* Entry = &Pending[Index];
+		if ( !Entry->Active || !Entry->WaitForStop )
+		{
+			continue;
+		}
+		if ( ( Entry->Acknowledged || (Entry->Command == SMC100Chained::CommandType::None) ) && Chain->AxisIsStopped(Entry->MotorIndex) )
+		{
+			Entry->Active = false;
+			PushEvent(Entry->Producer, EventType::Completed, Entry->MotorIndex, Entry->Tag);
+		}
+	}
+}
+
+void SMC100ChainedThreaded::HandleOutcome(void* Context, uint8_t MotorIndex, SMC100Chained::CommandType Command, SMC100Chained::OutcomeType Outcome, char Code)
+{
+	(void)Code;
+	SMC100ChainedThreaded* Front = (SMC100ChainedThreaded*)Context;
+	//A refusal while a request is being queued belongs to that request, which Dispatch() reports itself.
+	if (Front->Dispatching)
+	{
+		return;
+	}
+	Front->ResolvePending(MotorIndex, Command, Outcome);
+}
+
+void SMC100ChainedThreaded::ResolvePending(uint8_t MotorIndex, SMC100Chained::CommandType Command, SMC100Chained::OutcomeType Outcome)
+{
+	//Commands to one axis are answered in the order they were queued, so the oldest matching request is the one answered.
+	PendingEntry* Oldest = NULL;
+	for (uint8_t Index = 0; Index < SMC100ChainedThreadedPendingCount; ++Index)
+	{
+		PendingEntry* Entry = &Pending[Index];
+		if ( !Entry->Active || Entry->Acknowledged || (Entry->MotorIndex != MotorIndex) || (Entry->Command != Command) )
+		{
+			continue;
+		}
+		if ( (Oldest == NULL) || ( (int32_t)(Entry->Order - Oldest->Order) < 0 ) )
+		{
+			Oldest = Entry;
+		}
+	}
+	if (Oldest == NULL)
+	{
+		return;
+	}
+	switch (Outcome)
+	{
+		case SMC100Chained::OutcomeType::Completed:
+			if (Oldest->WaitForStop)
+			{
+				Oldest->Acknowledged = true;
+				return;
+			}
+			PushEvent(Oldest->Producer, EventType::Completed, Oldest->MotorIndex, Oldest->Tag);
+			break;
+		case SMC100Chained::OutcomeType::TimedOut:
+		case SMC100Chained::OutcomeType::NotSent:
+			PushEvent(Oldest->Producer, EventType::Failed, Oldest->MotorIndex, Oldest->Tag);
+			break;
+		case SMC100Chained::OutcomeType::Rejected:
+		case SMC100Chained::OutcomeType::ControllerError:
+			PushEvent(Oldest->Producer, EventType::Rejected, Oldest->MotorIndex, Oldest->Tag);
+			break;
+		case SMC100Chained::OutcomeType::HardwareFault:
+			//A fault belongs to the axis rather than to a request, a move it stops is still finished by the stop.
+			return;
+	}
+	Oldest->Active = false;
+}
+
+void SMC100ChainedThreaded::PushEvent(uint8_t Producer, EventType Type, uint8_t MotorIndex, uint32_t Tag)
+{
+	Event NewEvent;
+	NewEvent.Type = Type;
+	NewEvent.MotorIndex = MotorIndex;
+	NewEvent.Tag = Tag;
+	NewEvent.Position = (MotorIndex < Chain->GetMotorCount()) ? Chain->GetPosition(MotorIndex) : NAN;
+	if (!RingPush(&Events[Producer], NewEvent))
+	{
+		EventsDropped++;
+	}
+}
+
+#endif
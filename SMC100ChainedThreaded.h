@@ -0,0 +1,104 @@
+#ifndef SMC100ChainedThreaded_h	//check for multiple inclusions
+#define SMC100ChainedThreaded_h
+
+#if !defined(ARDUINO)
+
+#include "SMC100Chained.h"
+#include <thread>
+#include <atomic>
+
+#define SMC100ChainedThreadedRingSize 64
+#define SMC100ChainedThreadedMaxProducers 4
+#define SMC100ChainedThreadedPendingCount 32
+
+class SMC100ChainedThreaded
+{
+	public:
+		enum class RequestType : uint8_t
+		{
+			Home,
+			Enable,
+			MoveAbsolute,
+			MoveRelative,
+			SetVelocity,
+			SetAcceleration,
+			GetPosition,
+			StartJog,
+			StopJog,
+		};
+		enum class EventType : uint8_t
+		{
+			Completed,
+			Rejected,
+			Failed,
+		};
+		struct Request
+		{
+			RequestType Type;
+			uint8_t MotorIndex;
+			float Parameter;
+			uint32_t Tag;
+		};
+		struct Event
+		{
+			EventType Type;
+			uint8_t MotorIndex;
+			uint32_t Tag;
+			float Position;
+		};
+		SMC100ChainedThreaded(SMC100Chained* chain);
+		~SMC100ChainedThreaded();
+		int8_t RegisterProducer();
+		bool Submit(uint8_t Producer, const Request& NewRequest);
+		bool Submit(uint8_t Producer, RequestType Type, uint8_t MotorIndex, float Parameter, uint32_t Tag);
+		bool PollEvent(uint8_t Producer, Event* EventReturn);
+		uint32_t GetEventsDropped();
+		bool Start();
+		void Stop();
+	private:
+		template <typename EntryType>
+		struct Ring
+		{
+			EntryType Entries[SMC100ChainedThreadedRingSize];
+			std::atomic<uint32_t> Head;
+			std::atomic<uint32_t> Tail;
+		};
+		struct PendingEntry
+		{
+			bool Active;
+			bool WaitForStop;
+			bool Acknowledged;
+			SMC100Chained::CommandType Command;
+			uint8_t Producer;
+			uint8_t MotorIndex;
+			uint32_t Tag;
+			uint32_t Order;
+		};
+		template <typename EntryType>
+		static bool RingPush(Ring<EntryType>* Target, const EntryType& Entry);
+		template <typename EntryType>
+		static bool RingPop(Ring<EntryType>* Source, EntryType* EntryReturn);
+		void ThreadLoop();
+		void DrainRequests();
+		bool RequestsWaiting();
+		bool HasPendingRoom();
+		void Dispatch(uint8_t Producer, const Request& Incoming);
+		void CheckPending();
+		static void HandleOutcome(void* Context, uint8_t MotorIndex, SMC100Chained::CommandType Command, SMC100Chained::OutcomeType Outcome, char Code);
+		void ResolvePending(uint8_t MotorIndex, SMC100Chained::CommandType Command, SMC100Chained::OutcomeType Outcome);
+		void PushEvent(uint8_t Producer, EventType Type, uint8_t MotorIndex, uint32_t Tag);
+		SMC100Chained* Chain;
+		Ring<Request> Requests[SMC100ChainedThreadedMaxProducers];
+		Ring<Event> Events[SMC100ChainedThreadedMaxProducers];
+		std::atomic<uint8_t> ProducerCount;
+		PendingEntry Pending[SMC100ChainedThreadedPendingCount];
+		uint32_t PendingOrder;
+		bool Dispatching;
+		std::atomic<uint32_t> EventsDropped;
+		std::atomic<bool> Running;
+		std::thread Thread;
+};
+
+#endif
+
+#endif
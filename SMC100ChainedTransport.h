@@ -0,0 +1,24 @@
+#ifndef SMC100ChainedTransport_h	//check for multiple inclusions
+#define SMC100ChainedTransport_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+class SMC100ChainedTransport
+{
+	public:
+		virtual void Begin(uint32_t BaudRate) = 0;
+		virtual int Available() = 0;
+		virtual int Read() = 0;
+		virtual size_t Write(const uint8_t* Data, size_t Length) = 0;
+		virtual int AvailableForWrite() = 0;
+		virtual uint32_t Micros() = 0;
+		virtual void Log(const char* Text) = 0;
+		virtual int LogAvailableForWrite() = 0;
+		virtual bool Wait(uint32_t Timeout) { (void)Timeout; return false; }
+		virtual void Wake() {}
+	protected:
+		~SMC100ChainedTransport() {}
+};
+
+#endif
@@ -0,0 +1,130 @@
+#include "SMC100Chained.h"
+#include "SMC100ChainedBufferTransport.h"
+#include "SMC100ChainedSimulator.h"
+#include "SMC100ChainedTestAccess.h"
+#include "SMC100ChainedTestSupport.h"
+
+#include <stdio.h>
+
+typedef SMC100ChainedTestAccess Access;
+typedef SMC100Chained::CommandType CommandType;
+typedef SMC100Chained::CommandGetSetType CommandGetSetType;
+
+static const uint8_t Addresses[] = {1, 2, 3};
+static const uint8_t AddressCount = 3;
+static const uint32_t Iterations = 200000;
+static volatile uint32_t Sink;
+
+//Each hot path is timed on its own and must run without a single heap allocation.
+static void Finish(const char* Name, uint64_t Start, uint32_t Operations, uint32_t AllocationsBefore)
+{
+	SMC100ChainedReport(Name, SMC100ChainedNanoseconds() - Start, Operations);
+	SMC100ChainedCheck(SMC100ChainedAllocationCount() == AllocationsBefore);
+}
+
+static void BenchQueue(SMC100Chained* Chain)
+{
+	uint32_t Allocations = SMC100ChainedAllocationCount();
+	uint64_t Start = SMC100ChainedNanoseconds();
+	for (uint32_t Index = 0; Index < Iterations; ++Index)
+	{
+		Access::CommandEnqueue(Chain, Index % AddressCount, CommandType::PositionReal, 0.0, CommandGetSetType::Get);
+		Access::CommandQueuePullToCurrentCommand(Chain);
+	}
+	Finish("CommandEnqueue+Pull, queue depth 1", Start, Iterations, Allocations);
+
+	//Pulling from a deep queue walks it for the earliest deadline, which is the worst case per pull.
+	Allocations = SMC100ChainedAllocationCount();
+	Start = SMC100ChainedNanoseconds();
+	uint32_t Operations = 0;
+	for (uint32_t Round = 0; Round < (Iterations / SMC100ChainedQueueCount); ++Round)
+	{
+		for (uint8_t Index = 0; Index < SMC100ChainedQueueCount; ++Index)
+		{
+			Access::CommandEnqueue(Chain, Index % AddressCount, CommandType::PositionReal, 0.0, CommandGetSetType::Get);
+		}
+		while (Access::CommandQueuePullToCurrentCommand(Chain))
+		{
+			Operations++;
+		}
+	}
+	Finish("CommandEnqueue+Pull, full queue", Start, Operations, Allocations);
+
+	Allocations = SMC100ChainedAllocationCount();
+	Start = SMC100ChainedNanoseconds();
+	for (uint32_t Index = 0; Index < Iterations; ++Index)
+	{
+		Access::CommandEnqueue(Chain, Index % AddressCount, CommandType::PositionReal, 0.0, CommandGetSetType::Get);
+	}
+	Finish("CommandEnqueue into a full ring", Start, Iterations, Allocations);
+	Access::ClearCommandQueue(Chain);
+}
+
+static void BenchParseReply(SMC100Chained* Chain, SMC100ChainedBufferTransport* Transport)
+{
+	struct
+	{
+		const char* Name;
+		uint8_t MotorIndex;
+		CommandType Type;
+		CommandGetSetType GetOrSet;
+		const char* Reply;
+	} Cases[] =
+	{
+		{"ParseReply TE", 0, CommandType::ErrorCommands, CommandGetSetType::Get, "1TE@"},
+		{"ParseReply TS", 1, CommandType::ErrorStatus, CommandGetSetType::Get, "2TS000032"},
+		{"ParseReply TP", 2, CommandType::PositionReal, CommandGetSetType::Get, "3TP-12.345678"},
+		{"ParseReply VA", 0, CommandType::Velocity, CommandGetSetType::Get, "1VA2.5"},
+		{"ParseReply RB", 1, CommandType::GPIOInput, CommandGetSetType::None, "2RB5"},
+		{"ParseReply address mismatch", 2, CommandType::PositionReal, CommandGetSetType::Get, "1TP1.0"},
+	};
+	uint8_t Drain[SMC100ChainedBufferTransportSize];
+	for (size_t Case = 0; Case < sizeof(Cases) / sizeof(Cases[0]); ++Case)
+	{
+		//Replies other than TE and TS send the TE follow up, which is part of what the engine does per reply.
+		uint32_t Allocations = SMC100ChainedAllocationCount();
+		uint64_t Start = SMC100ChainedNanoseconds();
+		for (uint32_t Index = 0; Index < Iterations; ++Index)
+		{
+			Access::SetCurrentCommand(Chain, Cases[Case].MotorIndex, Cases[Case].Type, Cases[Case].GetOrSet, 0.0);
+			Sink = Access::ParseReply(Chain, Cases[Case].Reply);
+			Transport->PullTransmitted(Drain, sizeof(Drain));
+		}
+		Finish(Cases[Case].Name, Start, Iterations, Allocations);
+	}
+}
+
+static void BenchConversions(SMC100Chained* Chain)
+{
+	const char* Codes[] = {"0A", "1E", "28", "32", "3C", "47"};
+	uint32_t Allocations = SMC100ChainedAllocationCount();
+	uint64_t Start = SMC100ChainedNanoseconds();
+	for (uint32_t Index = 0; Index < Iterations; ++Index)
+	{
+		Sink = (uint32_t)Access::ConvertStatus(Chain, Codes[Index % 6]);
+	}
+	Finish("ConvertStatus", Start, Iterations, Allocations);
+
+	Allocations = SMC100ChainedAllocationCount();
+	Start = SMC100ChainedNanoseconds();
+	uint8_t MotorIndex = 0;
+	for (uint32_t Index = 0; Index < Iterations; ++Index)
+	{
+		Sink = Access::ConvertMotorAddressToIndex(Chain, 1 + (Index % 4), &MotorIndex);
+	}
+	Sink = MotorIndex;
+	Finish("ConvertMotorAddressToIndex", Start, Iterations, Allocations);
+}
+
+int main()
+{
+	SMC100ChainedBufferTransport Transport;
+	Transport.SetLogCallback(SMC100ChainedSilentLog);
+	SMC100Chained Chain(&Transport, Addresses, AddressCount);
+	Chain.Begin();
+	Access::ClearCommandQueue(&Chain);
+	BenchQueue(&Chain);
+	BenchParseReply(&Chain, &Transport);
+	BenchConversions(&Chain);
+	return SMC100ChainedTestResult("SMC100ChainedQueueBench");
+}
@@ -0,0 +1,165 @@
+#include "SMC100Chained.h"
+#include "SMC100ChainedBufferTransport.h"
+#include "SMC100ChainedTestAccess.h"
+#include "SMC100ChainedTestSupport.h"
+
+#include <stdio.h>
+#include <string.h>
+
+typedef SMC100ChainedTestAccess Access;
+typedef SMC100Chained::CommandType CommandType;
+typedef SMC100Chained::CommandGetSetType CommandGetSetType;
+
+static const uint8_t Addresses[] = {1, 2, 3};
+static const uint8_t AddressCount = 3;
+static const uint32_t Iterations = 200000;
+static const uint8_t MaxChecks = 8;
+static volatile uint32_t Sink;
+
+static void Finish(const char* Name, uint64_t Start, uint32_t Operations, uint32_t AllocationsBefore)
+{
+	SMC100ChainedReport(Name, SMC100ChainedNanoseconds() - Start, Operations);
+	SMC100ChainedCheck(SMC100ChainedAllocationCount() == AllocationsBefore);
+}
+
+static void BenchFormatFloat()
+{
+	struct
+	{
+		const char* Name;
+		float Value;
+	} Cases[] =
+	{
+		{"FormatFloat 0", 0.0},
+		{"FormatFloat 25", 25.0},
+		{"FormatFloat -0.25", -0.25},
+		{"FormatFloat 12.345678", 12.345678},
+		{"FormatFloat -123456.5", -123456.5},
+	};
+	char Buffer[SMC100ChainedTransmitBufferSize];
+	for (size_t Case = 0; Case < sizeof(Cases) / sizeof(Cases[0]); ++Case)
+	{
+		uint32_t Allocations = SMC100ChainedAllocationCount();
+		uint64_t Start = SMC100ChainedNanoseconds();
+		for (uint32_t Index = 0; Index < Iterations; ++Index)
+		{
+			Sink = Access::FormatFloat(Buffer, Cases[Case].Value);
+		}
+		Finish(Cases[Case].Name, Start, Iterations, Allocations);
+	}
+}
+
+static void BenchRender(SMC100Chained* Chain)
+{
+	char Rendered[SMC100ChainedTransmitBufferSize];
+	uint32_t Allocations = SMC100ChainedAllocationCount();
+	uint64_t Start = SMC100ChainedNanoseconds();
+	for (uint32_t Index = 0; Index < Iterations; ++Index)
+	{
+		Access::SetCurrentCommand(Chain, 0, CommandType::PositionReal, CommandGetSetType::Get, 0.0);
+		Sink = Access::RenderCurrentCommand(Chain, Rendered);
+	}
+	Finish("RenderCurrentCommand TP?", Start, Iterations, Allocations);
+
+	Allocations = SMC100ChainedAllocationCount();
+	Start = SMC100ChainedNanoseconds();
+	for (uint32_t Index = 0; Index < Iterations; ++Index)
+	{
+		Access::SetCurrentCommand(Chain, 0, CommandType::MoveAbs, CommandGetSetType::Set, -12.345678 + (float)(Index & 0xFF));
+		Sink = Access::RenderCurrentCommand(Chain, Rendered);
+	}
+	Finish("RenderCurrentCommand PA float", Start, Iterations, Allocations);
+}
+
+static void BenchSend(SMC100Chained* Chain, SMC100ChainedBufferTransport* Transport)
+{
+	uint8_t Drain[SMC100ChainedBufferTransportSize];
+	uint32_t Allocations = SMC100ChainedAllocationCount();
+	uint64_t Start = SMC100ChainedNanoseconds();
+	for (uint32_t Index = 0; Index < Iterations; ++Index)
+	{
+		Access::SetIdle(Chain);
+		Access::SetCurrentCommand(Chain, 1, CommandType::PositionReal, CommandGetSetType::Get, 0.0);
+		Sink = Access::SendCurrentCommand(Chain);
+		Transport->PullTransmitted(Drain, sizeof(Drain));
+	}
+	Finish("SendCurrentCommand TP?", Start, Iterations, Allocations);
+
+	Allocations = SMC100ChainedAllocationCount();
+	Start = SMC100ChainedNanoseconds();
+	for (uint32_t Index = 0; Index < Iterations; ++Index)
+	{
+		Access::SetIdle(Chain);
+		Access::SetCurrentCommand(Chain, 2, CommandType::MoveRel, CommandGetSetType::Set, 0.001 * (float)(Index & 0x3FF));
+		Sink = Access::SendCurrentCommand(Chain);
+		Transport->PullTransmitted(Drain, sizeof(Drain));
+	}
+	Finish("SendCurrentCommand PR float", Start, Iterations, Allocations);
+}
+
+//Enqueue to wire covers the public call, the dispatch in Check() and the write, and is done once the whole line is in the transport.
+//No reply is given, so the chain is put back to idle with an empty queue before the next request.
+static void BenchEnqueueToWire(SMC100Chained* Chain, SMC100ChainedBufferTransport* Transport)
+{
+	uint8_t Line[SMC100ChainedBufferTransportSize];
+	Access::SetIdle(Chain);
+	Access::ClearCommandQueue(Chain);
+	Transport->PullTransmitted(Line, sizeof(Line));
+	uint32_t WrongLines = 0;
+	uint32_t Allocations = SMC100ChainedAllocationCount();
+	uint64_t Start = SMC100ChainedNanoseconds();
+	for (uint32_t Index = 0; Index < Iterations; ++Index)
+	{
+		Chain->SendGetPosition(0);
+		size_t Length = 0;
+		for (uint8_t Checks = 0; (Checks < MaxChecks) && ((Length == 0) || (Line[Length - 1] != '\n')); ++Checks)
+		{
+			Chain->Check();
+			Length += Transport->PullTransmitted(Line + Length, sizeof(Line) - Length);
+		}
+		if ( (Length != 6) || (memcmp(Line, "1TP?\r\n", 6) != 0) )
+		{
+			WrongLines++;
+		}
+		Access::SetIdle(Chain);
+		Access::ClearCommandQueue(Chain);
+	}
+	Finish("Enqueue to wire TP?", Start, Iterations, Allocations);
+	SMC100ChainedCheck(WrongLines == 0);
+
+	WrongLines = 0;
+	Allocations = SMC100ChainedAllocationCount();
+	Start = SMC100ChainedNanoseconds();
+	for (uint32_t Index = 0; Index < Iterations; ++Index)
+	{
+		Chain->SendSetVelocity(1, 2.5);
+		size_t Length = 0;
+		for (uint8_t Checks = 0; (Checks < MaxChecks) && ((Length == 0) || (Line[Length - 1] != '\n')); ++Checks)
+		{
+			Chain->Check();
+			Length += Transport->PullTransmitted(Line + Length, sizeof(Line) - Length);
+		}
+		if ( (Length != 8) || (memcmp(Line, "2VA2.5\r\n", 8) != 0) )
+		{
+			WrongLines++;
+		}
+		Access::SetIdle(Chain);
+		Access::ClearCommandQueue(Chain);
+	}
+	Finish("Enqueue to wire VA float", Start, Iterations, Allocations);
+	SMC100ChainedCheck(WrongLines == 0);
+}
+
+int main()
+{
+	SMC100ChainedBufferTransport Transport;
+	Transport.SetLogCallback(SMC100ChainedSilentLog);
+	SMC100Chained Chain(&Transport, Addresses, AddressCount);
+	Chain.Begin();
+	Access::ClearCommandQueue(&Chain);
+	BenchFormatFloat();
+	BenchRender(&Chain);
+	BenchSend(&Chain, &Transport);
+	BenchEnqueueToWire(&Chain, &Transport);
+	return SMC100ChainedTestResult("SMC100ChainedRenderBench");
+}
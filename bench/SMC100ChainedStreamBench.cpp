@@ -0,0 +1,112 @@
+#include "SMC100Chained.h"
+#include "SMC100ChainedBufferTransport.h"
+#include "SMC100ChainedSimulator.h"
+#include "SMC100ChainedTestSupport.h"
+
+#include <stdio.h>
+
+typedef SMC100Chained::PositionSample PositionSample;
+
+static const uint8_t Addresses[] = {1, 2, 3};
+static const uint8_t AddressCount = 3;
+static const uint32_t BusStep = 10;
+static const uint32_t DrainInterval = 1000;
+static const uint32_t SettleTime = 200000;
+static const uint32_t StreamTime = 1000000;
+static const uint32_t MoveTime = 400000;
+
+struct StreamResult
+{
+	uint32_t Samples[SMC100ChainedMaxMotors];
+	uint32_t OutOfOrder[SMC100ChainedMaxMotors];
+	uint32_t Backwards[SMC100ChainedMaxMotors];
+	uint32_t LastTime[SMC100ChainedMaxMotors];
+	float LastPosition[SMC100ChainedMaxMotors];
+};
+
+//The ring only holds SMC100ChainedStreamBufferCount samples, so it is drained far more often than the bus can fill it.
+static void Drain(SMC100Chained* Chain, uint8_t AxisCount, StreamResult* Result)
+{
+	PositionSample Samples[SMC100ChainedStreamBufferCount];
+	for (uint8_t MotorIndex = 0; MotorIndex < AxisCount; ++MotorIndex)
+	{
+		uint8_t Count = Chain->ReadPositionStream(MotorIndex, Samples, SMC100ChainedStreamBufferCount);
+		for (uint8_t Index = 0; Index < Count; ++Index)
+		{
+			if ( (Result->Samples[MotorIndex] > 0) && ((int32_t)(Samples[Index].Time - Result->LastTime[MotorIndex]) <= 0) )
+			{
+				Result->OutOfOrder[MotorIndex]++;
+			}
+			if ( (Result->Samples[MotorIndex] > 0) && (Samples[Index].Position < Result->LastPosition[MotorIndex]) )
+			{
+				Result->Backwards[MotorIndex]++;
+			}
+			Result->LastTime[MotorIndex] = Samples[Index].Time;
+			Result->LastPosition[MotorIndex] = Samples[Index].Position;
+			Result->Samples[MotorIndex]++;
+		}
+	}
+}
+
+//Rates are per second of simulated bus time, the wall time per sample is what the host spends on the engine and the simulator together.
+static void Stream(const char* Name, uint8_t AxisCount, bool Moving, uint32_t Duration)
+{
+	SMC100ChainedBufferTransport Transport;
+	Transport.SetLogCallback(SMC100ChainedSilentLog);
+	SMC100ChainedSimulator Simulator(&Transport, Addresses, AddressCount);
+	SMC100Chained Chain(&Transport, Addresses, AddressCount);
+	Chain.Begin();
+	for (uint8_t MotorIndex = 0; MotorIndex < AddressCount; ++MotorIndex)
+	{
+		Chain.Home(MotorIndex);
+	}
+	Simulator.Run(&Chain, SettleTime, BusStep);
+	StreamResult Result = {};
+	for (uint8_t MotorIndex = 0; MotorIndex < AxisCount; ++MotorIndex)
+	{
+		Chain.StartPositionStream(MotorIndex);
+	}
+	if (Moving)
+	{
+		Chain.MoveAbsolute(0, 1.0);
+	}
+	uint32_t Allocations = SMC100ChainedAllocationCount();
+	uint64_t Start = SMC100ChainedNanoseconds();
+	for (uint32_t Elapsed = 0; Elapsed < Duration; Elapsed += DrainInterval)
+	{
+		Simulator.Run(&Chain, DrainInterval, BusStep);
+		Drain(&Chain, AxisCount, &Result);
+	}
+	uint64_t WallTime = SMC100ChainedNanoseconds() - Start;
+	SMC100ChainedCheck(SMC100ChainedAllocationCount() == Allocations);
+	uint32_t Total = 0;
+	uint32_t Fewest = Result.Samples[0];
+	uint32_t Most = Result.Samples[0];
+	for (uint8_t MotorIndex = 0; MotorIndex < AxisCount; ++MotorIndex)
+	{
+		SMC100ChainedCheck(Result.Samples[MotorIndex] > 0);
+		SMC100ChainedCheck(Result.OutOfOrder[MotorIndex] == 0);
+		Total += Result.Samples[MotorIndex];
+		Fewest = (Result.Samples[MotorIndex] < Fewest) ? Result.Samples[MotorIndex] : Fewest;
+		Most = (Result.Samples[MotorIndex] > Most) ? Result.Samples[MotorIndex] : Most;
+	}
+	//Streaming axes are served in turn, so none may fall more than one sample behind another.
+	SMC100ChainedCheck((Most - Fewest) <= 1);
+	if (Moving)
+	{
+		SMC100ChainedCheck(Result.Backwards[0] == 0);
+		SMC100ChainedCheck(Result.LastPosition[0] > 0.0);
+	}
+	SMC100ChainedReport(Name, WallTime, Total);
+	double Seconds = (double)Duration / 1000000.0;
+	printf("    %.1f samples/s per axis, %.1f samples/s in total, %.2f ms between samples of one axis\n", (double)Total / (double)AxisCount / Seconds, (double)Total / Seconds, (double)Duration * (double)AxisCount / (double)Total / 1000.0);
+}
+
+int main()
+{
+	Stream("Position stream, 1 axis", 1, false, StreamTime);
+	Stream("Position stream, 2 axes", 2, false, StreamTime);
+	Stream("Position stream, 3 axes", 3, false, StreamTime);
+	Stream("Position stream, 1 axis while it moves", 1, true, MoveTime);
+	return SMC100ChainedTestResult("SMC100ChainedStreamBench");
+}
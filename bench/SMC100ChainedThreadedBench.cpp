@@ -0,0 +1,166 @@
+#include "SMC100ChainedThreaded.h"
+#include "SMC100ChainedBufferTransport.h"
+#include "SMC100ChainedSimulator.h"
+#include "SMC100ChainedTestSupport.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#define RequestsPerProducer 2000
+#define OutstandingPerProducer 16
+
+static const uint8_t Addresses[] = {1, 2, 3};
+static const uint8_t AddressCount = 3;
+static const uint32_t BusStep = 50;
+
+//The simulated bus runs on virtual time inside the I/O thread, so only the host side costs show up in wall time.
+class BenchBus : public SMC100ChainedBufferTransport
+{
+	public:
+		BenchBus() : Simulator(this, Addresses, AddressCount)
+		{
+		}
+		bool Wait(uint32_t Timeout)
+		{
+			Simulator.Check();
+			AdvanceMicros((Timeout < BusStep) ? Timeout : BusStep);
+			Simulator.Check();
+			return (Available() > 0);
+		}
+	private:
+		SMC100ChainedSimulator Simulator;
+};
+
+struct ProducerResult
+{
+	uint32_t Latency[RequestsPerProducer];
+	uint32_t Submitted;
+	uint32_t Completed;
+	uint32_t Rejected;
+	uint32_t RingFull;
+};
+
+static ProducerResult Results[SMC100ChainedThreadedMaxProducers];
+static uint32_t Latencies[SMC100ChainedThreadedMaxProducers * RequestsPerProducer];
+static std::atomic<bool> Go(false);
+static std::atomic<uint8_t> Finished(0);
+
+static void PollEvents(SMC100ChainedThreaded* Front, uint8_t Producer, ProducerResult* Result)
+{
+	SMC100ChainedThreaded::Event Incoming;
+	while (Front->PollEvent(Producer, &Incoming))
+	{
+		if (Incoming.Type == SMC100ChainedThreaded::EventType::Completed)
+		{
+			Result->Completed++;
+		}
+		else
+		{
+			Result->Rejected++;
+		}
+	}
+}
+
+static void ProducerLoop(SMC100ChainedThreaded* Front, uint8_t Producer)
+{
+	//Only the successful Submit() is timed, a full ring is counted separately as back pressure.
+	ProducerResult* Result = &Results[Producer];
+	while (!Go)
+	{
+		std::this_thread::yield();
+	}
+	while (Result->Submitted < RequestsPerProducer)
+	{
+		PollEvents(Front, Producer, Result);
+		if ((Result->Submitted - Result->Completed - Result->Rejected) >= OutstandingPerProducer)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+		uint64_t Start = SMC100ChainedNanoseconds();
+		bool Accepted = Front->Submit(Producer, SMC100ChainedThreaded::RequestType::GetPosition, (Producer + Result->Submitted) % AddressCount, 0.0, Result->Submitted);
+		uint64_t End = SMC100ChainedNanoseconds();
+		if (!Accepted)
+		{
+			Result->RingFull++;
+			std::this_thread::yield();
+			continue;
+		}
+		Result->Latency[Result->Submitted] = (uint32_t)(End - Start);
+		Result->Submitted++;
+	}
+	while ((Result->Completed + Result->Rejected) < Result->Submitted)
+	{
+		PollEvents(Front, Producer, Result);
+		std::this_thread::yield();
+	}
+	Finished++;
+}
+
+static void Run(uint8_t ProducerCount)
+{
+	BenchBus Bus;
+	Bus.SetLogCallback(SMC100ChainedSilentLog);
+	SMC100Chained Chain(&Bus, Addresses, AddressCount);
+	Chain.Begin();
+	SMC100ChainedThreaded Front(&Chain);
+	std::thread Producers[SMC100ChainedThreadedMaxProducers];
+	Go = false;
+	Finished = 0;
+	for (uint8_t Index = 0; Index < ProducerCount; ++Index)
+	{
+		Results[Index].Submitted = 0;
+		Results[Index].Completed = 0;
+		Results[Index].Rejected = 0;
+		Results[Index].RingFull = 0;
+		uint8_t Producer = (uint8_t)Front.RegisterProducer();
+		Producers[Index] = std::thread(ProducerLoop, &Front, Producer);
+	}
+	Front.Start();
+	//Thread creation allocates, so the count is taken once every thread exists and checked before any is joined.
+	uint32_t Allocations = SMC100ChainedAllocationCount();
+	uint64_t Start = SMC100ChainedNanoseconds();
+	Go = true;
+	while (Finished < ProducerCount)
+	{
+		std::this_thread::yield();
+	}
+	uint64_t Elapsed = SMC100ChainedNanoseconds() - Start;
+	SMC100ChainedCheck(SMC100ChainedAllocationCount() == Allocations);
+	Front.Stop();
+	for (uint8_t Index = 0; Index < ProducerCount; ++Index)
+	{
+		Producers[Index].join();
+	}
+	uint32_t Count = 0;
+	uint32_t RingFull = 0;
+	uint64_t Total = 0;
+	for (uint8_t Index = 0; Index < ProducerCount; ++Index)
+	{
+		SMC100ChainedCheck(Results[Index].Submitted == RequestsPerProducer);
+		SMC100ChainedCheck(Results[Index].Completed == RequestsPerProducer);
+		RingFull += Results[Index].RingFull;
+		for (uint32_t Request = 0; Request < Results[Index].Submitted; ++Request)
+		{
+			Latencies[Count++] = Results[Index].Latency[Request];
+			Total += Results[Index].Latency[Request];
+		}
+	}
+	SMC100ChainedCheck(Front.GetEventsDropped() == 0);
+	std::sort(Latencies, Latencies + Count);
+	char Name[48];
+	snprintf(Name, sizeof(Name), "Submit, %u producer(s)", ProducerCount);
+	SMC100ChainedReport(Name, Total, Count);
+	printf("    p50 %u ns  p99 %u ns  max %u ns  ring full %u\n", Latencies[Count / 2], Latencies[(Count * 99) / 100], Latencies[Count - 1], RingFull);
+	printf("    %u requests completed in %.1f ms, %.0f requests/s\n", Count, (double)Elapsed / 1000000.0, (double)Count * 1000000000.0 / (double)Elapsed);
+}
+
+int main()
+{
+	Run(1);
+	Run(2);
+	Run(SMC100ChainedThreadedMaxProducers);
+	return SMC100ChainedTestResult("SMC100ChainedThreadedBench");
+}
@@ -0,0 +1,715 @@
+#include "SMC100Chained.h"
+#include "SMC100ChainedBinaryLink.h"
+#include "SMC100ChainedBufferTransport.h"
+#include "SMC100ChainedManager.h"
+#include "SMC100ChainedSharedMemory.h"
+#include "SMC100ChainedSimulator.h"
+#include "SMC100ChainedTestAccess.h"
+#include "SMC100ChainedTestSupport.h"
+#include "SMC100ChainedThreaded.h"
+
+#include <string.h>
+#include <math.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <thread>
+
+typedef SMC100ChainedTestAccess Access;
+typedef SMC100Chained::CommandType CommandType;
+typedef SMC100Chained::CommandGetSetType CommandGetSetType;
+typedef SMC100Chained::StatusType StatusType;
+
+static const uint8_t Addresses[] = {1, 2, 5};
+static const uint8_t AddressCount = 3;
+
+static bool ValuesMatch(float Value, float Expected)
+{
+	return (fabs(Value - Expected) < 0.0001);
+}
+
+static size_t PullLine(SMC100ChainedBufferTransport* Transport, char* Line, size_t Size)
+{
+	size_t Length = Transport->PullTransmitted((uint8_t*)Line, Size - 1);
+	Line[Length] = '\0';
+	return Length;
+}
+
+static void TestConvertStatus()
+{
+	SMC100ChainedBufferTransport Transport;
+	Transport.SetLogCallback(SMC100ChainedSilentLog);
+	SMC100Chained Chain(&Transport, Addresses, AddressCount);
+	struct
+	{
+		const char* Code;
+		StatusType Type;
+	} Cases[] =
+	{
+		{"0A", StatusType::NoReference}, {"0B", StatusType::NoReference}, {"0C", StatusType::NoReference},
+		{"0D", StatusType::NoReference}, {"0E", StatusType::NoReference}, {"0F", StatusType::NoReference},
+		{"10", StatusType::NoReference}, {"11", StatusType::NoReference}, {"14", StatusType::NoReference},
+		{"1E", StatusType::Homing}, {"1F", StatusType::Homing},
+		{"28", StatusType::Moving},
+		{"32", StatusType::Ready}, {"33", StatusType::Ready}, {"34", StatusType::Ready}, {"35", StatusType::Ready},
+		{"3C", StatusType::Disabled}, {"3D", StatusType::Disabled}, {"3E", StatusType::Disabled},
+		{"46", StatusType::Jogging}, {"47", StatusType::Jogging},
+		{"00", StatusType::Unknown}, {"ZZ", StatusType::Unknown}, {"3F", StatusType::Unknown},
+	};
+	for (size_t Index = 0; Index < sizeof(Cases) / sizeof(Cases[0]); ++Index)
+	{
+		SMC100ChainedCheck(Access::ConvertStatus(&Chain, Cases[Index].Code) == Cases[Index].Type);
+	}
+}
+
+static void TestConvertMotorAddressToIndex()
+{
+	SMC100ChainedBufferTransport Transport;
+	SMC100Chained Chain(&Transport, Addresses, AddressCount);
+	for (uint8_t Index = 0; Index < AddressCount; ++Index)
+	{
+		uint8_t MotorIndex = 0xFF;
+		SMC100ChainedCheck(Access::ConvertMotorAddressToIndex(&Chain, Addresses[Index], &MotorIndex));
+		SMC100ChainedCheck(MotorIndex == Index);
+	}
+	uint8_t Unchanged = 0xFF;
+	SMC100ChainedCheck(!Access::ConvertMotorAddressToIndex(&Chain, 0, &Unchanged));
+	SMC100ChainedCheck(!Access::ConvertMotorAddressToIndex(&Chain, 3, &Unchanged));
+	SMC100ChainedCheck(!Access::ConvertMotorAddressToIndex(&Chain, 255, &Unchanged));
+	SMC100ChainedCheck(Unchanged == 0xFF);
+}
+
+static void TestSendCurrentCommandFormatting()
+{
+	SMC100ChainedBufferTransport Transport;
+	Transport.SetLogCallback(SMC100ChainedSilentLog);
+	SMC100Chained Chain(&Transport, Addresses, AddressCount);
+	Chain.Begin();
+	struct
+	{
+		uint8_t MotorIndex;
+		CommandType Type;
+		CommandGetSetType GetOrSet;
+		float Parameter;
+		const char* Expected;
+	} Cases[] =
+	{
+		{0, CommandType::PositionReal, CommandGetSetType::Get, 0.0, "1TP?\r\n"},
+		{1, CommandType::ErrorStatus, CommandGetSetType::Get, 0.0, "2TS?\r\n"},
+		{2, CommandType::Home, CommandGetSetType::None, 0.0, "5OR\r\n"},
+		{0, CommandType::MoveAbs, CommandGetSetType::Set, 12.5, "1PA12.5\r\n"},
+		{0, CommandType::MoveAbs, CommandGetSetType::Set, 3.0, "1PA3\r\n"},
+		{1, CommandType::MoveRel, CommandGetSetType::Set, -0.25, "2PR-0.25\r\n"},
+		{1, CommandType::MoveRel, CommandGetSetType::Set, 0.000001, "2PR0.000001\r\n"},
+		{2, CommandType::MoveAbs, CommandGetSetType::Set, -24.125, "5PA-24.125\r\n"},
+		{0, CommandType::Enable, CommandGetSetType::Set, 1.0, "1MM1\r\n"},
+		{0, CommandType::GPIOOutput, CommandGetSetType::Set, -7.0, "1SB-7\r\n"},
+		{1, CommandType::Velocity, CommandGetSetType::Get, 0.0, "2VA?\r\n"},
+		{1, CommandType::Acceleration, CommandGetSetType::Set, 10.0, "2AC10\r\n"},
+		{2, CommandType::GPIOInput, CommandGetSetType::None, 0.0, "5RB\r\n"},
+		{2, CommandType::LimitNegative, CommandGetSetType::Set, -25.0, "5SL-25\r\n"},
+	};
+	char Line[64];
+	char Rendered[SMC100ChainedTransmitBufferSize];
+	for (size_t Index = 0; Index < sizeof(Cases) / sizeof(Cases[0]); ++Index)
+	{
+		Access::SetIdle(&Chain);
+		Transport.PullTransmitted((uint8_t*)Line, sizeof(Line));
+		Access::SetCurrentCommand(&Chain, Cases[Index].MotorIndex, Cases[Index].Type, Cases[Index].GetOrSet, Cases[Index].Parameter);
+		uint8_t RenderedLength = Access::RenderCurrentCommand(&Chain, Rendered);
+		SMC100ChainedCheck(RenderedLength == strlen(Cases[Index].Expected));
+		SMC100ChainedCheck(memcmp(Rendered, Cases[Index].Expected, RenderedLength) == 0);
+		SMC100ChainedCheck(Access::SendCurrentCommand(&Chain));
+		PullLine(&Transport, Line, sizeof(Line));
+		if (strcmp(Line, Cases[Index].Expected) != 0)
+		{
+			SMC100ChainedTestFail(__FILE__, __LINE__, Cases[Index].Expected);
+		}
+	}
+	//A set without a parameter type cannot be rendered, and nothing of it may reach the wire.
+	Access::SetIdle(&Chain);
+	Transport.PullTransmitted((uint8_t*)Line, sizeof(Line));
+	Access::SetCurrentCommand(&Chain, 0, CommandType::Home, CommandGetSetType::Set, 1.0);
+	SMC100ChainedCheck(Access::RenderCurrentCommand(&Chain, Rendered) == 0);
+	SMC100ChainedCheck(!Access::SendCurrentCommand(&Chain));
+	SMC100ChainedCheck(Transport.PullTransmitted((uint8_t*)Line, sizeof(Line)) == 0);
+	SMC100ChainedCheck(Access::GetMode(&Chain) == SMC100Chained::ModeType::Idle);
+	SMC100Chained::StatsStruct Stats;
+	Chain.GetStats(&Stats);
+	SMC100ChainedCheck(Stats.Axes[0].RenderFailures == 1);
+}
+
+static void ExpectReply(SMC100Chained* Chain, SMC100ChainedBufferTransport* Transport, uint8_t MotorIndex, CommandType Type, CommandGetSetType GetOrSet, const char* Reply)
+{
+	char Line[64];
+	Access::SetIdle(Chain);
+	Transport->PullTransmitted((uint8_t*)Line, sizeof(Line));
+	Access::SetCurrentCommand(Chain, MotorIndex, Type, GetOrSet, 0.0);
+	if (!Access::ParseReply(Chain, Reply))
+	{
+		SMC100ChainedTestFail(__FILE__, __LINE__, Reply);
+	}
+}
+
+static void TestParseReply()
+{
+	SMC100ChainedBufferTransport Transport;
+	Transport.SetLogCallback(SMC100ChainedSilentLog);
+	SMC100Chained Chain(&Transport, Addresses, AddressCount);
+	Chain.Begin();
+	SMC100Chained::StatsStruct Stats;
+	char Line[64];
+
+	ExpectReply(&Chain, &Transport, 0, CommandType::PositionReal, CommandGetSetType::Get, "1TP2.5");
+	SMC100ChainedCheck(ValuesMatch(Chain.GetPosition(0), 2.5));
+	//Every reply except TE and TS is followed by a TE query for the same axis.
+	PullLine(&Transport, Line, sizeof(Line));
+	SMC100ChainedCheck(strcmp(Line, "1TE?\r\n") == 0);
+	SMC100ChainedCheck(Access::GetCurrentCommand(&Chain) == CommandType::ErrorCommands);
+
+	ExpectReply(&Chain, &Transport, 1, CommandType::PositionReal, CommandGetSetType::Get, "2TP-13.0625");
+	SMC100ChainedCheck(ValuesMatch(Chain.GetPosition(1), -13.0625));
+
+	ExpectReply(&Chain, &Transport, 2, CommandType::ErrorStatus, CommandGetSetType::Get, "5TS000032");
+	SMC100ChainedCheck(Access::GetStatus(&Chain, 2) == StatusType::Ready);
+	SMC100ChainedCheck(Chain.IsReady(2));
+	SMC100ChainedCheck(Access::GetMode(&Chain) == SMC100Chained::ModeType::Idle);
+	ExpectReply(&Chain, &Transport, 2, CommandType::ErrorStatus, CommandGetSetType::Get, "5TS000028");
+	SMC100ChainedCheck(Chain.IsMoving(2));
+	ExpectReply(&Chain, &Transport, 0, CommandType::ErrorStatus, CommandGetSetType::Get, "1TS00003C");
+	SMC100ChainedCheck(Access::GetStatus(&Chain, 0) == StatusType::Disabled);
+
+	Chain.GetStats(&Stats);
+	uint16_t CommandErrors = Stats.Axes[1].CommandErrors;
+	ExpectReply(&Chain, &Transport, 1, CommandType::ErrorCommands, CommandGetSetType::Get, "2TE@");
+	Chain.GetStats(&Stats);
+	SMC100ChainedCheck(Stats.Axes[1].CommandErrors == CommandErrors);
+	ExpectReply(&Chain, &Transport, 1, CommandType::ErrorCommands, CommandGetSetType::Get, "2TEC");
+	Chain.GetStats(&Stats);
+	SMC100ChainedCheck(Stats.Axes[1].CommandErrors == CommandErrors + 1);
+
+	ExpectReply(&Chain, &Transport, 0, CommandType::GPIOInput, CommandGetSetType::None, "1RB5");
+	SMC100ChainedCheck(Access::GetGPIOInputCode(&Chain, 0) == 5);
+	SMC100ChainedCheck(Chain.GetGPIOInput(0, 0));
+	SMC100ChainedCheck(!Chain.GetGPIOInput(0, 1));
+	SMC100ChainedCheck(Chain.GetGPIOInput(0, 2));
+
+	ExpectReply(&Chain, &Transport, 1, CommandType::Analogue, CommandGetSetType::None, "2RA1.25");
+	SMC100ChainedCheck(ValuesMatch(Chain.GetAnalogue(1), 1.25));
+
+	ExpectReply(&Chain, &Transport, 2, CommandType::LimitNegative, CommandGetSetType::Get, "5SL-24.5");
+	SMC100ChainedCheck(ValuesMatch(Access::GetPositionLimitNegative(&Chain, 2), -24.5));
+	ExpectReply(&Chain, &Transport, 2, CommandType::LimitPositive, CommandGetSetType::Get, "5SR24.75");
+	SMC100ChainedCheck(ValuesMatch(Access::GetPositionLimitPositive(&Chain, 2), 24.75));
+
+	ExpectReply(&Chain, &Transport, 0, CommandType::Velocity, CommandGetSetType::Get, "1VA2.5");
+	SMC100ChainedCheck(ValuesMatch(Chain.GetVelocity(0), 2.5));
+	ExpectReply(&Chain, &Transport, 0, CommandType::Acceleration, CommandGetSetType::Get, "1AC10");
+	SMC100ChainedCheck(ValuesMatch(Chain.GetAcceleration(0), 10.0));
+
+	//Replies to a set only confirm it, the value sent stays in place.
+	ExpectReply(&Chain, &Transport, 0, CommandType::Velocity, CommandGetSetType::Set, "1VA9");
+	SMC100ChainedCheck(ValuesMatch(Chain.GetVelocity(0), 2.5));
+}
+
+static void TestMalformedReplies()
+{
+	SMC100ChainedBufferTransport Transport;
+	Transport.SetLogCallback(SMC100ChainedSilentLog);
+	SMC100Chained Chain(&Transport, Addresses, AddressCount);
+	Chain.Begin();
+	SMC100Chained::StatsStruct Stats;
+
+	const char* Rejected[] = {"2TP1.0", "1TS000032", "", "TP1.0", "1T", "5TP1.0", "1tp1.0"};
+	for (size_t Index = 0; Index < sizeof(Rejected) / sizeof(Rejected[0]); ++Index)
+	{
+		Access::SetCurrentCommand(&Chain, 0, CommandType::PositionReal, CommandGetSetType::Get, 0.0);
+		if (Access::ParseReply(&Chain, Rejected[Index]))
+		{
+			SMC100ChainedTestFail(__FILE__, __LINE__, Rejected[Index]);
+		}
+	}
+	Chain.GetStats(&Stats);
+	SMC100ChainedCheck(Stats.Axes[0].AddressMismatches == 4);
+	SMC100ChainedCheck(Stats.Axes[0].MnemonicMismatches == 3);
+	SMC100ChainedCheck(Stats.Axes[0].Replies == 0);
+
+	//Status and error replies are read at fixed offsets, short ones must not be parsed.
+	const char* ShortStatus[] = {"1TS", "1TS0000", "1TS00003"};
+	for (size_t Index = 0; Index < sizeof(ShortStatus) / sizeof(ShortStatus[0]); ++Index)
+	{
+		Access::SetCurrentCommand(&Chain, 0, CommandType::ErrorStatus, CommandGetSetType::Get, 0.0);
+		SMC100ChainedCheck(!Access::ParseReply(&Chain, ShortStatus[Index]));
+	}
+	Access::SetCurrentCommand(&Chain, 0, CommandType::ErrorCommands, CommandGetSetType::Get, 0.0);
+	SMC100ChainedCheck(!Access::ParseReply(&Chain, "1TE"));
+	SMC100ChainedCheck(Access::GetStatus(&Chain, 0) == StatusType::Unknown);
+
+	//On the wire: noise, an overlong line and a reply for another axis are dropped and the real reply is still taken.
+	SMC100ChainedSimulator Simulator(&Transport, Addresses, AddressCount);
+	Simulator.Run(&Chain, 200000, 50);
+	Chain.ResetStats();
+	Chain.SendGetPosition(1);
+	for (uint16_t Step = 0; (Step < 100) && (Access::GetMode(&Chain) != SMC100Chained::ModeType::WaitForCommandReply); ++Step)
+	{
+		Chain.Check();
+		Simulator.Check();
+		Transport.AdvanceMicros(10);
+	}
+	SMC100ChainedCheck(Access::GetMode(&Chain) == SMC100Chained::ModeType::WaitForCommandReply);
+	Transport.PushReceived("\r\n\xff\xfe garbage\r\n");
+	Transport.PushReceived("2TP00000000000000000000000000000000000000001\r\n");
+	Transport.PushReceived("1TP7.5\r\n");
+	Transport.PushReceived("2TP-3.5\r\n");
+	Chain.Check();
+	SMC100ChainedCheck(ValuesMatch(Chain.GetPosition(1), -3.5));
+	SMC100ChainedCheck(ValuesMatch(Chain.GetPosition(0), 0.0));
+	Chain.GetStats(&Stats);
+	SMC100ChainedCheck(Stats.Axes[1].BufferOverflows == 1);
+	SMC100ChainedCheck(Stats.Axes[1].AddressMismatches == 2);
+	SMC100ChainedCheck(Stats.Axes[1].Replies == 1);
+	SMC100ChainedCheck(Stats.Resyncs == 3);
+}
+
+static void TestQueueWraparound()
+{
+	SMC100ChainedBufferTransport Transport;
+	Transport.SetLogCallback(SMC100ChainedSilentLog);
+	SMC100Chained Chain(&Transport, Addresses, AddressCount);
+	SMC100ChainedCheck(Access::CommandQueueCount(&Chain) == 0);
+	SMC100ChainedCheck(Chain.GetQueueFree() == SMC100ChainedQueueCount);
+	//Partial fills push head and tail around the ring several times, order and count must survive every wrap.
+	uint32_t Next = 0;
+	uint32_t Expected = 0;
+	for (uint8_t Round = 0; Round < (3 * SMC100ChainedQueueCount); ++Round)
+	{
+		uint8_t Fill = 1 + (Round % (SMC100ChainedQueueCount - 1));
+		for (uint8_t Index = 0; Index < Fill; ++Index)
+		{
+			Access::CommandEnqueue(&Chain, 0, CommandType::MoveAbs, (float)Next, CommandGetSetType::Get);
+			Next++;
+		}
+		SMC100ChainedCheck(Access::CommandQueueCount(&Chain) == Fill);
+		SMC100ChainedCheck(Chain.GetQueueFree() == (SMC100ChainedQueueCount - Fill));
+		for (uint8_t Index = 0; Index < Fill; ++Index)
+		{
+			SMC100ChainedCheck(Access::CommandQueuePullToCurrentCommand(&Chain));
+			SMC100ChainedCheck(ValuesMatch(Access::GetCurrentCommandParameter(&Chain), (float)Expected));
+			Expected++;
+		}
+		SMC100ChainedCheck(!Access::CommandQueuePullToCurrentCommand(&Chain));
+		SMC100ChainedCheck(Access::CommandQueueCount(&Chain) == 0);
+	}
+	SMC100ChainedCheck(Next == Expected);
+}
+
+static void TestFullRing()
+{
+	SMC100ChainedBufferTransport Transport;
+	Transport.SetLogCallback(SMC100ChainedSilentLog);
+	SMC100Chained Chain(&Transport, Addresses, AddressCount);
+	const uint8_t Extra = 3;
+	for (uint8_t Index = 0; Index < (SMC100ChainedQueueCount + Extra); ++Index)
+	{
+		Access::CommandEnqueue(&Chain, Index % AddressCount, CommandType::PositionReal, (float)Index, CommandGetSetType::Get);
+	}
+	SMC100ChainedCheck(Access::CommandQueueCount(&Chain) == SMC100ChainedQueueCount);
+	SMC100ChainedCheck(Chain.GetQueueFree() == 0);
+	SMC100Chained::StatsStruct Stats;
+	Chain.GetStats(&Stats);
+	uint16_t Overflows = 0;
+	for (uint8_t MotorIndex = 0; MotorIndex < AddressCount; ++MotorIndex)
+	{
+		//The oldest entries were dropped, one for each of the first three axes.
+		SMC100ChainedCheck(Stats.Axes[MotorIndex].QueueOverflows == 1);
+		Overflows += Stats.Axes[MotorIndex].QueueOverflows;
+	}
+	SMC100ChainedCheck(Overflows == Extra);
+	for (uint8_t Index = Extra; Index < (SMC100ChainedQueueCount + Extra); ++Index)
+	{
+		SMC100ChainedCheck(Access::CommandQueuePullToCurrentCommand(&Chain));
+		SMC100ChainedCheck(ValuesMatch(Access::GetCurrentCommandParameter(&Chain), (float)Index));
+	}
+	SMC100ChainedCheck(!Access::CommandQueuePullToCurrentCommand(&Chain));
+	SMC100ChainedCheck(Chain.GetQueueFree() == SMC100ChainedQueueCount);
+}
+
+static void TestMotorIndexOutOfRange()
+{
+	SMC100ChainedBufferTransport Transport;
+	Transport.SetLogCallback(SMC100ChainedSilentLog);
+	SMC100Chained Chain(&Transport, Addresses, AddressCount);
+	Chain.Begin();
+	Access::ClearCommandQueue(&Chain);
+	uint32_t Rejected = Chain.GetRejectedCount();
+	Chain.SendGetPosition(AddressCount);
+	Chain.SendGetPosition(255);
+	Access::CommandEnqueue(&Chain, SMC100ChainedMaxMotors, CommandType::MoveAbs, 1.0, CommandGetSetType::Set);
+	SMC100ChainedCheck(Access::CommandQueueCount(&Chain) == 0);
+	SMC100ChainedCheck(Chain.GetRejectedCount() == Rejected + 3);
+	Chain.SendGetPosition(AddressCount - 1);
+	SMC100ChainedCheck(Access::CommandQueueCount(&Chain) == 1);
+}
+
+static void TestJogSharesPollSlots()
+{
+	SMC100ChainedBufferTransport Transport;
+	Transport.SetLogCallback(SMC100ChainedSilentLog);
+	SMC100Chained Chain(&Transport, Addresses, AddressCount);
+	Chain.Begin();
+	Access::ClearCommandQueue(&Chain);
+	Chain.SetSchedulerWeights(2, 1);
+	Access::SetPositionLimits(&Chain, 0, -25.0, 25.0);
+	Chain.StartJog(0, 1.0);
+	Chain.SendGetPosition(1);
+	char Line[SMC100ChainedBufferTransportSize];
+	size_t Length = 0;
+	for (uint8_t Checks = 0; (Checks < 8) && (Length == 0); ++Checks)
+	{
+		Chain.Check();
+		Length = PullLine(&Transport, Line, sizeof(Line));
+	}
+	//The queued command owns the slot, so the due jog step waits for it.
+	SMC100ChainedCheck(strcmp(Line, "2TP?\r\n") == 0);
+	bool JogSent = false;
+	for (uint8_t Checks = 0; (Checks < 16) && !JogSent; ++Checks)
+	{
+		Access::SetIdle(&Chain);
+		Chain.Check();
+		PullLine(&Transport, Line, sizeof(Line));
+		JogSent = (strncmp(Line, "1PR", 3) == 0);
+	}
+	SMC100ChainedCheck(JogSent);
+}
+
+static void TestHeldCommandsGoFirst()
+{
+	SMC100ChainedBufferTransport Transport;
+	Transport.SetLogCallback(SMC100ChainedSilentLog);
+	SMC100Chained Chain(&Transport, Addresses, AddressCount);
+	//Begin leaves a TS for every axis queued, the move queued under the hold has to overtake them.
+	Chain.Begin();
+	Access::SetPositionLimits(&Chain, 2, -25.0, 25.0);
+	Chain.HoldQueue();
+	Chain.MoveAbsolute(2, 1.5);
+	Chain.ReleaseQueue();
+	char Line[SMC100ChainedBufferTransportSize];
+	size_t Length = 0;
+	for (uint8_t Checks = 0; (Checks < 8) && (Length == 0); ++Checks)
+	{
+		Chain.Check();
+		Length = PullLine(&Transport, Line, sizeof(Line));
+	}
+	SMC100ChainedCheck(strcmp(Line, "5PA1.5\r\n") == 0);
+}
+
+static void TestSynchronizedMoveRejected()
+{
+	SMC100ChainedBufferTransport Transport;
+	Transport.SetLogCallback(SMC100ChainedSilentLog);
+	SMC100Chained Chain(&Transport, Addresses, AddressCount);
+	SMC100ChainedManager Manager;
+	Manager.AddChain(&Chain);
+	Chain.Begin();
+	Access::ClearCommandQueue(&Chain);
+	Access::SetPositionLimits(&Chain, 0, -25.0, 25.0);
+	Access::SetPositionLimits(&Chain, 1, -25.0, 25.0);
+	Access::SetStatus(&Chain, 0, StatusType::Ready);
+	Access::SetStatus(&Chain, 1, StatusType::NoReference);
+	const uint8_t Axes[] = {0, 1};
+	const float Targets[] = {1.0, 2.0};
+	//The second axis is not homed, so the first axis's move must not be left to start on its own.
+	SMC100ChainedCheck(!Manager.StartSynchronizedMove(Axes, Targets, 2));
+	SMC100ChainedCheck(Access::CommandQueueCount(&Chain) == 0);
+	SMC100ChainedCheck(!Chain.IsQueueHeld());
+	SMC100ChainedCheck(!Manager.SynchronizedMovePending());
+	Access::SetStatus(&Chain, 1, StatusType::Ready);
+	SMC100ChainedCheck(Manager.StartSynchronizedMove(Axes, Targets, 2));
+	SMC100ChainedCheck(Access::CommandQueueCount(&Chain) == 2);
+}
+
+//The simulator only answers the first two addresses, so commands for the third run into the reply timeout.
+class ThreadedBus : public SMC100ChainedBufferTransport
+{
+	public:
+		ThreadedBus() : Simulator(this, Addresses, AddressCount - 1)
+		{
+		}
+		bool Wait(uint32_t Timeout)
+		{
+			Simulator.Check();
+			AdvanceMicros((Timeout < 50) ? Timeout : 50);
+			Simulator.Check();
+			return (Available() > 0);
+		}
+	private:
+		SMC100ChainedSimulator Simulator;
+};
+
+static bool WaitForEvent(SMC100ChainedThreaded* Front, uint8_t Producer, SMC100ChainedThreaded::Event* EventReturn)
+{
+	for (uint32_t Tries = 0; Tries < 2000000; ++Tries)
+	{
+		if (Front->PollEvent(Producer, EventReturn))
+		{
+			return true;
+		}
+		std::this_thread::yield();
+	}
+	return false;
+}
+
+static void ExpectThreadedEvent(SMC100ChainedThreaded* Front, uint8_t Producer, SMC100ChainedThreaded::RequestType Type, uint8_t MotorIndex, uint32_t Tag, SMC100ChainedThreaded::EventType Expected)
+{
+	SMC100ChainedThreaded::Event Incoming;
+	SMC100ChainedCheck(Front->Submit(Producer, Type, MotorIndex, 0.5, Tag));
+	SMC100ChainedCheck(WaitForEvent(Front, Producer, &Incoming));
+	SMC100ChainedCheck(Incoming.Tag == Tag);
+	SMC100ChainedCheck(Incoming.Type == Expected);
+}
+
+static void TestThreadedOutcomes()
+{
+	typedef SMC100ChainedThreaded::RequestType RequestType;
+	typedef SMC100ChainedThreaded::EventType EventType;
+	ThreadedBus Bus;
+	Bus.SetLogCallback(SMC100ChainedSilentLog);
+	SMC100Chained Chain(&Bus, Addresses, AddressCount);
+	Chain.Begin();
+	SMC100ChainedThreaded Front(&Chain);
+	uint8_t Producer = (uint8_t)Front.RegisterProducer();
+	Front.Start();
+	ExpectThreadedEvent(&Front, Producer, RequestType::GetPosition, 0, 1, EventType::Completed);
+	ExpectThreadedEvent(&Front, Producer, RequestType::GetPosition, 1, 2, EventType::Completed);
+	//Neither axis is homed, so the move and the first jog step are refused rather than reported done.
+	ExpectThreadedEvent(&Front, Producer, RequestType::MoveAbsolute, 0, 3, EventType::Rejected);
+	ExpectThreadedEvent(&Front, Producer, RequestType::StartJog, 1, 4, EventType::Rejected);
+	ExpectThreadedEvent(&Front, Producer, RequestType::GetPosition, 2, 5, EventType::Failed);
+	Front.Stop();
+}
+
+static void TestSharedMemory()
+{
+	typedef SMC100ChainedSharedMemory::RequestType RequestType;
+	SMC100ChainedBufferTransport Transport;
+	Transport.SetLogCallback(SMC100ChainedSilentLog);
+	SMC100Chained Chain(&Transport, Addresses, AddressCount);
+	Chain.Begin();
+	char Name[32];
+	snprintf(Name, sizeof(Name), "/SMC100ChainedTest%d", (int)getpid());
+	SMC100ChainedSharedMemory Stale;
+	SMC100ChainedCheck(Stale.Create(Name, &Chain));
+	//A second owner must not take over a segment that is already there until it is removed on purpose.
+	SMC100ChainedSharedMemory Publisher;
+	SMC100ChainedCheck(!Publisher.Create(Name, &Chain));
+	SMC100ChainedCheck(SMC100ChainedSharedMemory::Remove(Name));
+	SMC100ChainedCheck(Publisher.Create(Name, &Chain));
+	SMC100ChainedSharedMemory Reader;
+	SMC100ChainedCheck(Reader.Attach(Name));
+	SMC100Chained::MotorStatus Motor;
+	SMC100ChainedCheck(Reader.ReadMotorStatus(2, &Motor));
+	SMC100ChainedCheck(Motor.Address == 5);
+	SMC100ChainedCheck(Motor.FinishedCallback == NULL);
+	SMC100ChainedCheck(Reader.SubmitCommand(RequestType::GetPosition, AddressCount, 0.0));
+	SMC100ChainedCheck(Reader.SubmitCommand(RequestType::GetPosition, 0, 0.0));
+	SMC100ChainedCheck(Publisher.ProcessCommands() == 2);
+	SMC100ChainedCheck(Reader.GetCommandsRejected() == 1);
+	//Stats follow their own period, a snapshot that has not moved does not hold them back.
+	Publisher.SetStatsInterval(1000);
+	SMC100Chained::StatsStruct Stats;
+	for (uint8_t Checks = 0; Checks < 8; ++Checks)
+	{
+		Chain.Check();
+	}
+	Transport.AdvanceMicros(1000);
+	Publisher.Publish();
+	SMC100ChainedCheck(Reader.ReadStats(&Stats));
+	SMC100ChainedCheck(Stats.Axes[0].Sent > 0);
+	Reader.Close();
+	Publisher.Close();
+	Stale.Close();
+}
+
+static size_t DecodeFrames(SMC100ChainedProtocol::Decoder* Decoder, const uint8_t* Data, size_t Length, SMC100ChainedProtocol::Message* Messages, size_t MaxMessages)
+{
+	size_t Count = 0;
+	for (size_t Index = 0; Index < Length; ++Index)
+	{
+		if (Decoder->Push(Data[Index]) && (Count < MaxMessages))
+		{
+			Messages[Count] = Decoder->GetMessage();
+			Count++;
+		}
+	}
+	return Count;
+}
+
+static void TestProtocolRoundTrip()
+{
+	typedef SMC100ChainedProtocol Protocol;
+	Protocol::Decoder Decoder;
+	Protocol::Message Decoded;
+	uint8_t Frame[SMC100ChainedProtocolMaxEncoded];
+	Protocol::ErrorMessage Error;
+	Error.MotorIndex = 2;
+	Error.Command[0] = 'P';
+	Error.Command[1] = 'A';
+	Error.Kind = Protocol::ErrorKind::ControllerError;
+	Error.Code = 'C';
+	Error.Fault = 0x0200;
+	size_t Length = Protocol::BuildError(7, Error, Frame);
+	SMC100ChainedCheck(DecodeFrames(&Decoder, Frame, Length, &Decoded, 1) == 1);
+	const Protocol::ErrorMessage* Received = Decoder.GetError();
+	SMC100ChainedCheck(Received != NULL);
+	SMC100ChainedCheck( (Received->MotorIndex == 2) && (Received->Command[0] == 'P') && (Received->Command[1] == 'A') );
+	SMC100ChainedCheck( (Received->Kind == Protocol::ErrorKind::ControllerError) && (Received->Code == 'C') && (Received->Fault == 0x0200) );
+	//Every stats part has to fit the 63 byte AVR transmit buffer whole.
+	Protocol::StatsMessage Stats;
+	memset(&Stats, 0xA5, sizeof(Stats));
+	Stats.MotorIndex = 1;
+	Stats.GPIOEdges = 1234;
+	Stats.PollJitterMax = 0x12345678;
+	Length = Protocol::BuildStats(8, Stats, Frame);
+	SMC100ChainedCheck(Length <= 63);
+	SMC100ChainedCheck(DecodeFrames(&Decoder, Frame, Length, &Decoded, 1) == 1);
+	SMC100ChainedCheck(Decoder.GetError() == NULL);
+	SMC100ChainedCheck( (Decoded.Type == Protocol::MessageType::Stats) && (Decoded.Stats.MotorIndex == 1) );
+	SMC100ChainedCheck( (Decoded.Stats.GPIOEdges == 1234) && (Decoded.Stats.PollJitterMax == 0x12345678) && (Decoded.Stats.CommandsRejected == 0xA5A5) );
+	Protocol::CommandStatsMessage Commands;
+	Commands.FirstCommand = 8;
+	Commands.Count = SMC100ChainedProtocolCommandStatsPerFrame;
+	for (uint8_t Index = 0; Index < Commands.Count; ++Index)
+	{
+		Commands.Sent[Index] = Index;
+		Commands.Replies[Index] = 100 + Index;
+		Commands.Timeouts[Index] = 200 + Index;
+	}
+	Length = Protocol::BuildCommandStats(9, Commands, Frame);
+	SMC100ChainedCheck(Length <= 63);
+	SMC100ChainedCheck(DecodeFrames(&Decoder, Frame, Length, &Decoded, 1) == 1);
+	SMC100ChainedCheck( (Decoded.Type == Protocol::MessageType::CommandStats) && (Decoded.CommandStats.FirstCommand == 8) && (Decoded.CommandStats.Count == Commands.Count) );
+	SMC100ChainedCheck( (Decoded.CommandStats.Replies[7] == 107) && (Decoded.CommandStats.Timeouts[7] == 207) );
+}
+
+static void TestBinaryLinkErrors()
+{
+	typedef SMC100ChainedProtocol Protocol;
+	SMC100ChainedBufferTransport Bus;
+	SMC100ChainedBufferTransport Host;
+	Bus.SetLogCallback(SMC100ChainedSilentLog);
+	SMC100ChainedBinaryLink Link(&Bus, &Host);
+	SMC100Chained Chain(&Link, Addresses, AddressCount);
+	Chain.Begin();
+	Link.Attach(&Chain);
+	Access::ClearCommandQueue(&Chain);
+	Access::SetPositionLimits(&Chain, 1, -25.0, 25.0);
+	Access::SetStatus(&Chain, 1, StatusType::NoReference);
+	Chain.MoveAbsolute(1, 1.0);
+	ExpectReply(&Chain, &Bus, 0, CommandType::ErrorStatus, CommandGetSetType::Get, "1TS020032");
+	//The same fault on the next status poll is not news and must not be sent again.
+	ExpectReply(&Chain, &Bus, 0, CommandType::ErrorStatus, CommandGetSetType::Get, "1TS020032");
+	//The host buffer holds fewer bytes than the whole set, so what does not fit goes out on later checks.
+	Link.SendStats(0);
+	Protocol::Decoder Decoder;
+	Protocol::Message Messages[16];
+	size_t Count = 0;
+	for (uint8_t Checks = 0; Checks < 8; ++Checks)
+	{
+		Link.Check();
+		uint8_t Output[SMC100ChainedBufferTransportSize];
+		size_t Length = Host.PullTransmitted(Output, sizeof(Output));
+		Count += DecodeFrames(&Decoder, Output, Length, Messages + Count, 16 - Count);
+	}
+	uint8_t Commands = 0;
+	uint8_t StatsParts = 0;
+	uint8_t Errors = 0;
+	for (size_t Index = 0; Index < Count; ++Index)
+	{
+		const Protocol::Message* Received = &Messages[Index];
+		switch (Received->Type)
+		{
+			case Protocol::MessageType::Stats:
+			case Protocol::MessageType::LatencyStats:
+			case Protocol::MessageType::ChainStats:
+				StatsParts++;
+				break;
+			case Protocol::MessageType::CommandStats:
+				SMC100ChainedCheck(Received->CommandStats.FirstCommand == Commands);
+				Commands += Received->CommandStats.Count;
+				break;
+			case Protocol::MessageType::Error:
+				if (Errors == 0)
+				{
+					SMC100ChainedCheck( (Received->Error.Kind == Protocol::ErrorKind::Rejected) && (Received->Error.MotorIndex == 1) );
+					SMC100ChainedCheck( (Received->Error.Command[0] == 'P') && (Received->Error.Command[1] == 'A') );
+				}
+				else
+				{
+					SMC100ChainedCheck( (Received->Error.Kind == Protocol::ErrorKind::HardwareFault) && (Received->Error.MotorIndex == 0) );
+					SMC100ChainedCheck( (Received->Error.Command[0] == 'T') && (Received->Error.Fault == 0x0200) );
+				}
+				Errors++;
+				break;
+			default:
+				break;
+		}
+	}
+	SMC100ChainedCheck(StatsParts == 3);
+	SMC100ChainedCheck(Commands == SMC100ChainedCommandTypeCount);
+	SMC100ChainedCheck(Errors == 2);
+}
+
+static void TestNoAllocations()
+{
+	SMC100ChainedBufferTransport Transport;
+	Transport.SetLogCallback(SMC100ChainedSilentLog);
+	SMC100Chained Chain(&Transport, Addresses, AddressCount);
+	SMC100ChainedSimulator Simulator(&Transport, Addresses, AddressCount);
+	uint32_t Before = SMC100ChainedAllocationCount();
+	Chain.Begin();
+	Simulator.Run(&Chain, 100000, 20);
+	for (uint8_t MotorIndex = 0; MotorIndex < AddressCount; ++MotorIndex)
+	{
+		Chain.Home(MotorIndex);
+	}
+	Simulator.Run(&Chain, 500000, 20);
+	for (uint8_t MotorIndex = 0; MotorIndex < AddressCount; ++MotorIndex)
+	{
+		SMC100ChainedCheck(Chain.IsHomed(MotorIndex));
+		Chain.MoveAbsolute(MotorIndex, 0.5 + MotorIndex);
+		Chain.StartPositionStream(MotorIndex);
+	}
+	Simulator.Run(&Chain, 2000000, 20);
+	SMC100Chained::PositionSample Samples[SMC100ChainedStreamBufferCount];
+	SMC100ChainedCheck(Chain.ReadPositionStream(0, Samples, SMC100ChainedStreamBufferCount) > 0);
+	for (uint8_t MotorIndex = 0; MotorIndex < AddressCount; ++MotorIndex)
+	{
+		Chain.StopPositionStream(MotorIndex);
+	}
+	Simulator.Run(&Chain, 200000, 20);
+	for (uint8_t MotorIndex = 0; MotorIndex < AddressCount; ++MotorIndex)
+	{
+		SMC100ChainedCheck(ValuesMatch(Chain.GetPosition(MotorIndex), 0.5 + MotorIndex));
+	}
+	SMC100ChainedCheck(SMC100ChainedAllocationCount() == Before);
+}
+
+int main()
+{
+	TestConvertStatus();
+	TestConvertMotorAddressToIndex();
+	TestSendCurrentCommandFormatting();
+	TestParseReply();
+	TestMalformedReplies();
+	TestQueueWraparound();
+	TestFullRing();
+	TestMotorIndexOutOfRange();
+	TestJogSharesPollSlots();
+	TestHeldCommandsGoFirst();
+	TestSynchronizedMoveRejected();
+	TestThreadedOutcomes();
+	TestSharedMemory();
+	TestProtocolRoundTrip();
+	TestBinaryLinkErrors();
+	TestNoAllocations();
+	return SMC100ChainedTestResult("SMC100ChainedEngineTest");
+}
@@ -0,0 +1,150 @@
+#include "SMC100Chained.h"
+#include "SMC100ChainedBufferTransport.h"
+#include "SMC100ChainedCaptureTransport.h"
+#include "SMC100ChainedReplayTransport.h"
+#include "SMC100ChainedSimulator.h"
+#include "SMC100ChainedTestSupport.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const char* ReferencePath = "data/SMC100ChainedReference.cap";
+static const uint8_t Addresses[] = {1, 2};
+static const uint8_t AddressCount = 2;
+static const uint32_t RecordStep = 10;
+static const uint32_t MaxSteps = 200000;
+static const uint8_t QueryBurst = 8;
+//Replay is deterministic, so the tolerance only covers the recording step, in parts per ten thousand of the recorded elapsed time. Round trips may not grow at all.
+static const uint32_t ElapsedTolerance = 10;
+
+typedef bool ( *StepFunction )(SMC100Chained* Chain);
+
+static SMC100ChainedBufferTransport* RecordBus;
+static SMC100ChainedSimulator* RecordSimulator;
+static SMC100ChainedReplayTransport* Replay;
+
+static bool RecordStepFunction(SMC100Chained* Chain)
+{
+	Chain->Check();
+	RecordSimulator->Check();
+	RecordBus->AdvanceMicros(RecordStep);
+	return true;
+}
+
+static bool ReplayStepFunction(SMC100Chained* Chain)
+{
+	//Waiting before the check keeps an idle chain from jumping its full idle interval once a phase has already settled.
+	Replay->Wait(Chain->TimeUntilNextCheck());
+	Chain->Check();
+	return !Replay->IsFinished();
+}
+
+static bool Settled(SMC100Chained* Chain)
+{
+	if (!Chain->IsIdle())
+	{
+		return false;
+	}
+	for (uint8_t MotorIndex = 0; MotorIndex < AddressCount; ++MotorIndex)
+	{
+		if (!Chain->AxisIsStopped(MotorIndex))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static void RunUntilSettled(SMC100Chained* Chain, StepFunction Step)
+{
+	//A step always runs first so commands queued by the caller have gone out before settling is judged.
+	for (uint32_t Steps = 0; Steps < MaxSteps; ++Steps)
+	{
+		if (!Step(Chain))
+		{
+			return;
+		}
+		if (Settled(Chain))
+		{
+			return;
+		}
+	}
+}
+
+//Recording and replay run the same script, each phase waits for the chain to settle, so the wire traffic lines up.
+static void RunWorkload(SMC100Chained* Chain, StepFunction Step)
+{
+	Chain->Begin();
+	RunUntilSettled(Chain, Step);
+	Chain->Home(0);
+	Chain->Home(1);
+	RunUntilSettled(Chain, Step);
+	Chain->SendSetVelocity(0, 4.0);
+	Chain->MoveAbsolute(0, 1.5);
+	Chain->MoveRelative(1, -0.75);
+	RunUntilSettled(Chain, Step);
+	//A burst of queries keeps the dispatch cost from being lost under the time the motion takes.
+	for (uint8_t Query = 0; Query < QueryBurst; ++Query)
+	{
+		Chain->SendGetPosition(0);
+		Chain->SendGetPosition(1);
+	}
+	RunUntilSettled(Chain, Step);
+}
+
+static int Record(const char* Path)
+{
+	SMC100ChainedBufferTransport Bus;
+	Bus.SetLogCallback(SMC100ChainedSilentLog);
+	SMC100ChainedSimulator Simulator(&Bus, Addresses, AddressCount);
+	RecordBus = &Bus;
+	RecordSimulator = &Simulator;
+	SMC100ChainedCaptureTransport Capture(&Bus);
+	if (!Capture.Open(Path))
+	{
+		printf("Could not open %s\n", Path);
+		return 1;
+	}
+	SMC100Chained Chain(&Capture, Addresses, AddressCount);
+	RunWorkload(&Chain, RecordStepFunction);
+	SMC100ChainedCheck(Chain.IsHomed(0) && Chain.IsHomed(1));
+	uint32_t BytesCaptured = Capture.GetBytesCaptured();
+	Capture.Close();
+	printf("Recorded %u bytes to %s\n", BytesCaptured, Path);
+	return SMC100ChainedTestResult("SMC100ChainedReplayTest --record");
+}
+
+static void CheckAgainstReference()
+{
+	SMC100ChainedReplayTransport Transport;
+	Transport.SetLogCallback(SMC100ChainedSilentLog);
+	SMC100ChainedCheck(Transport.LoadFile(ReferencePath));
+	Replay = &Transport;
+	SMC100Chained Chain(&Transport, Addresses, AddressCount);
+	RunWorkload(&Chain, ReplayStepFunction);
+	//Whatever the recording still holds after the script is played out so the totals cover all of it.
+	for (uint32_t Steps = 0; (Steps < MaxSteps) && ReplayStepFunction(&Chain); ++Steps)
+	{
+	}
+	SMC100ChainedReplayTransport::ReplayResult Result;
+	Transport.GetResult(&Result);
+	printf("Elapsed %u us (recorded %u us), round trips %u (recorded %u), mismatches %u, unused %u\n", Result.Elapsed, Result.RecordedElapsed, Result.RoundTrips, Result.RecordedRoundTrips, Result.Mismatches, Result.UnusedReceived);
+	//A mismatch means the engine no longer sends what the reference did, so the figures are not comparable until it is recorded again.
+	SMC100ChainedCheck(Result.Finished);
+	SMC100ChainedCheck(Result.Mismatches == 0);
+	SMC100ChainedCheck(Result.RecordedRoundTrips > 0);
+	SMC100ChainedCheck(Result.RoundTrips <= Result.RecordedRoundTrips);
+	SMC100ChainedCheck((uint64_t)Result.Elapsed * 10000 <= (uint64_t)Result.RecordedElapsed * (10000 + ElapsedTolerance));
+	SMC100ChainedCheck(Chain.IsHomed(0) && Chain.IsHomed(1));
+}
+
+int main(int argc, char** argv)
+{
+	//Run with --record <path> from the tests directory to refresh the reference after an intended change on the wire.
+	if ((argc == 3) && (strcmp(argv[1], "--record") == 0))
+	{
+		return Record(argv[2]);
+	}
+	CheckAgainstReference();
+	return SMC100ChainedTestResult("SMC100ChainedReplayTest");
+}
@@ -0,0 +1,307 @@
+#include "SMC100ChainedSimulator.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+SMC100ChainedSimulator::SMC100ChainedSimulator(SMC100ChainedBufferTransport* transport, const uint8_t* addresses, uint8_t addresscount)
+{
+	Transport = transport;
+	ControllerCount = (addresscount > SMC100ChainedMaxMotors) ? SMC100ChainedMaxMotors : addresscount;
+	for (uint8_t Index = 0; Index < ControllerCount; ++Index)
+	{
+		ControllerState* Controller = &Controllers[Index];
+		Controller->Address = addresses[Index];
+		Controller->State = "0A";
+		Controller->Position = 0.0;
+		Controller->Start = 0.0;
+		Controller->Target = 0.0;
+		Controller->MoveStartTime = 0;
+		Controller->MoveEndTime = 0;
+		Controller->Velocity = 2.0;
+		Controller->Acceleration = 10.0;
+		Controller->LimitNegative = -25.0;
+		Controller->LimitPositive = 25.0;
+		Controller->GPIOInput = 0x0F;
+		Controller->LastError = '@';
+	}
+	//One 10 bit character at the default 57600 baud.
+	ByteTime = 174;
+	TurnaroundTime = 1000;
+	HomeTime = 20000;
+	LineEndTime = 0;
+	LineLength = 0;
+	ReplyHead = 0;
+	ReplyCount = 0;
+	LinesReceived = 0;
+	RepliesSent = 0;
+}
+
+void SMC100ChainedSimulator::SetTiming(uint32_t ByteTimeToSet, uint32_t TurnaroundTimeToSet)
+{
+	ByteTime = ByteTimeToSet;
+	TurnaroundTime = TurnaroundTimeToSet;
+}
+
+void SMC100ChainedSimulator::SetHomeTime(uint32_t HomeTimeToSet)
+{
+	HomeTime = HomeTimeToSet;
+}
+
+void SMC100ChainedSimulator::Check()
+{
+	//Bytes leave the engine's buffer all at once, the line is taken to arrive one character time per byte later.
+	uint32_t Now = Transport->Micros();
+	uint8_t Received[SMC100ChainedBufferTransportSize];
+	size_t Count = Transport->PullTransmitted(Received, sizeof(Received));
+	if ( (Count > 0) && ((int32_t)(Now - LineEndTime) > 0) )
+	{
+		LineEndTime = Now;
+	}
+	for (size_t Index = 0; Index < Count; ++Index)
+	{
+		LineEndTime += ByteTime;
+		char Character = (char)Received[Index];
+		if (Character == '\n')
+		{
+			Line[LineLength] = '\0';
+			HandleLine(LineEndTime);
+			LineLength = 0;
+		}
+		else if ( (Character != '\r') && (LineLength < (SMC100ChainedSimulatorLineSize - 1)) )
+		{
+			Line[LineLength++] = Character;
+		}
+	}
+	while (ReplyCount > 0)
+	{
+		PendingReply* Pending = &Replies[ReplyHead];
+		if ( ((int32_t)(Now - Pending->DueTime) < 0) || (Transport->PushReceived((const uint8_t*)Pending->Text, Pending->Length) < Pending->Length) )
+		{
+			break;
+		}
+		ReplyHead = (ReplyHead + 1) % SMC100ChainedSimulatorReplyCount;
+		ReplyCount--;
+		RepliesSent++;
+	}
+}
+
+void SMC100ChainedSimulator::Run(SMC100Chained* Chain, uint32_t Duration, uint32_t Step)
+{
+	uint32_t Start = Transport->Micros();
+	while ((Transport->Micros() - Start) < Duration)
+	{
+		Chain->Check();
+		Check();
+		Transport->AdvanceMicros(Step);
+	}
+}
+
+float SMC100ChainedSimulator::GetPosition(uint8_t MotorIndex)
+{
+	if (MotorIndex >= ControllerCount)
+	{
+		return NAN;
+	}
+	Update(&Controllers[MotorIndex], Transport->Micros());
+	return Controllers[MotorIndex].Position;
+}
+
+uint32_t SMC100ChainedSimulator::GetLinesReceived()
+{
+	return LinesReceived;
+}
+
+uint32_t SMC100ChainedSimulator::GetRepliesSent()
+{
+	return RepliesSent;
+}
+
+void SMC100ChainedSimulator::HandleLine(uint32_t ArrivalTime)
+{
+	LinesReceived++;
+	char* Mnemonic;
+	uint8_t Address = (uint8_t)strtol(Line, &Mnemonic, 10);
+	ControllerState* Controller = FindController(Address);
+	if ( (Controller == NULL) || (strlen(Mnemonic) < 2) )
+	{
+		return;
+	}
+	Update(Controller, ArrivalTime);
+	const char* Parameter = Mnemonic + 2;
+	bool Get = (Parameter[0] == '?');
+	float Value = (float)atof(Parameter);
+	char Text[SMC100ChainedSimulatorLineSize];
+	Text[0] = '\0';
+	if (strncmp(Mnemonic, "TS", 2) == 0)
+	{
+		snprintf(Text, sizeof(Text), "%uTS0000%s", Address, Controller->State);
+	}
+	else if (strncmp(Mnemonic, "TE", 2) == 0)
+	{
+		snprintf(Text, sizeof(Text), "%uTE%c", Address, Controller->LastError);
+		Controller->LastError = '@';
+	}
+	else if (strncmp(Mnemonic, "TP", 2) == 0)
+	{
+		snprintf(Text, sizeof(Text), "%uTP%g", Address, Controller->Position);
+	}
+	else if (strncmp(Mnemonic, "TH", 2) == 0)
+	{
+		snprintf(Text, sizeof(Text), "%uTH%g", Address, Controller->Target);
+	}
+	else if ( (strncmp(Mnemonic, "PA", 2) == 0) || (strncmp(Mnemonic, "PR", 2) == 0) )
+	{
+		if (Get)
+		{
+			snprintf(Text, sizeof(Text), "%u%.2s%g", Address, Mnemonic, Controller->Target);
+		}
+		else if ( (strcmp(Controller->State, "32") == 0) || (strcmp(Controller->State, "28") == 0) )
+		{
+			float Target = (Mnemonic[1] == 'A') ? Value : (Controller->Target + Value);
+			Controller->Start = Controller->Position;
+			Controller->Target = Target;
+			Controller->MoveStartTime = ArrivalTime;
+			Controller->MoveEndTime = ArrivalTime + (uint32_t)(fabs(Target - Controller->Position) / Controller->Velocity * 1000000.0) + 1;
+			Controller->State = "28";
+		}
+		else
+		{
+			Controller->LastError = (Controller->State[0] == '0') ? 'H' : 'J';
+		}
+	}
+	else if (strncmp(Mnemonic, "PT", 2) == 0)
+	{
+		snprintf(Text, sizeof(Text), "%uPT%g", Address, fabs(Value) / Controller->Velocity);
+	}
+	else if (strncmp(Mnemonic, "OR", 2) == 0)
+	{
+		if (Controller->State[0] == '0')
+		{
+			Controller->State = "1E";
+			Controller->MoveEndTime = ArrivalTime + HomeTime;
+		}
+		else
+		{
+			Controller->LastError = 'K';
+		}
+	}
+	else if (strncmp(Mnemonic, "MM", 2) == 0)
+	{
+		if (Get)
+		{
+			snprintf(Text, sizeof(Text), "%uMM%s", Address, Controller->State);
+		}
+		else if ( (Value < 0.5) && (strcmp(Controller->State, "32") == 0) )
+		{
+			Controller->State = "3C";
+		}
+		else if ( (Value > 0.5) && (strcmp(Controller->State, "3C") == 0) )
+		{
+			Controller->State = "32";
+		}
+	}
+	else if (strncmp(Mnemonic, "RS", 2) == 0)
+	{
+		Controller->State = "0A";
+	}
+	else if (strncmp(Mnemonic, "RB", 2) == 0)
+	{
+		snprintf(Text, sizeof(Text), "%uRB%u", Address, Controller->GPIOInput);
+	}
+	else if (strncmp(Mnemonic, "RA", 2) == 0)
+	{
+		snprintf(Text, sizeof(Text), "%uRA%g", Address, 1.25);
+	}
+	else
+	{
+		float* Setting = NULL;
+		if (strncmp(Mnemonic, "VA", 2) == 0)
+		{
+			Setting = &Controller->Velocity;
+		}
+		else if (strncmp(Mnemonic, "AC", 2) == 0)
+		{
+			Setting = &Controller->Acceleration;
+		}
+		else if (strncmp(Mnemonic, "SL", 2) == 0)
+		{
+			Setting = &Controller->LimitNegative;
+		}
+		else if (strncmp(Mnemonic, "SR", 2) == 0)
+		{
+			Setting = &Controller->LimitPositive;
+		}
+		else if ( (strncmp(Mnemonic, "SB", 2) != 0) && (strncmp(Mnemonic, "JM", 2) != 0) && (strncmp(Mnemonic, "PW", 2) != 0) )
+		{
+			Controller->LastError = 'A';
+		}
+		if (Setting != NULL)
+		{
+			if (Get)
+			{
+				snprintf(Text, sizeof(Text), "%u%.2s%g", Address, Mnemonic, *Setting);
+			}
+			else if ( (Value > 0.0) || (Mnemonic[0] == 'S') )
+			{
+				//Travel limits may be negative, rates must stay positive.
+				*Setting = Value;
+			}
+		}
+	}
+	if (Text[0] != '\0')
+	{
+		Reply(ArrivalTime, Text);
+	}
+}
+
+void SMC100ChainedSimulator::Reply(uint32_t ArrivalTime, const char* Text)
+{
+	if (ReplyCount >= SMC100ChainedSimulatorReplyCount)
+	{
+		return;
+	}
+	PendingReply* Pending = &Replies[(ReplyHead + ReplyCount) % SMC100ChainedSimulatorReplyCount];
+	Pending->Length = (uint8_t)snprintf(Pending->Text, sizeof(Pending->Text), "%s\r\n", Text);
+	Pending->DueTime = ArrivalTime + TurnaroundTime + (Pending->Length * ByteTime);
+	ReplyCount++;
+}
+
+void SMC100ChainedSimulator::Update(ControllerState* Controller, uint32_t Now)
+{
+	if (strcmp(Controller->State, "1E") == 0)
+	{
+		if ((int32_t)(Now - Controller->MoveEndTime) >= 0)
+		{
+			Controller->State = "32";
+			Controller->Position = 0.0;
+			Controller->Target = 0.0;
+		}
+	}
+	else if (strcmp(Controller->State, "28") == 0)
+	{
+		if ((int32_t)(Now - Controller->MoveEndTime) >= 0)
+		{
+			Controller->State = "32";
+			Controller->Position = Controller->Target;
+		}
+		else
+		{
+			float Fraction = (float)(Now - Controller->MoveStartTime) / (float)(Controller->MoveEndTime - Controller->MoveStartTime);
+			Controller->Position = Controller->Start + ((Controller->Target - Controller->Start) * Fraction);
+		}
+	}
+}
+
+SMC100ChainedSimulator::ControllerState* SMC100ChainedSimulator::FindController(uint8_t Address)
+{
+	for (uint8_t Index = 0; Index < ControllerCount; ++Index)
+	{
+		if (Controllers[Index].Address == Address)
+		{
+			return &Controllers[Index];
+		}
+	}
+	return NULL;
+}
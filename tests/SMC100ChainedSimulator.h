@@ -0,0 +1,65 @@
+#ifndef SMC100ChainedSimulator_h	//check for multiple inclusions
+#define SMC100ChainedSimulator_h
+
+#include "SMC100ChainedBufferTransport.h"
+#include "SMC100Chained.h"
+
+#define SMC100ChainedSimulatorLineSize 32
+#define SMC100ChainedSimulatorReplyCount 4
+
+//A chain of SMC100 controllers behind a buffer transport, with character timing so rates measured against it mean something.
+class SMC100ChainedSimulator
+{
+	public:
+		SMC100ChainedSimulator(SMC100ChainedBufferTransport* transport, const uint8_t* addresses, uint8_t addresscount);
+		void SetTiming(uint32_t ByteTimeToSet, uint32_t TurnaroundTimeToSet);
+		void SetHomeTime(uint32_t HomeTimeToSet);
+		void Check();
+		void Run(SMC100Chained* Chain, uint32_t Duration, uint32_t Step);
+		float GetPosition(uint8_t MotorIndex);
+		uint32_t GetLinesReceived();
+		uint32_t GetRepliesSent();
+	private:
+		struct ControllerState
+		{
+			uint8_t Address;
+			const char* State;
+			float Position;
+			float Start;
+			float Target;
+			uint32_t MoveStartTime;
+			uint32_t MoveEndTime;
+			float Velocity;
+			float Acceleration;
+			float LimitNegative;
+			float LimitPositive;
+			uint8_t GPIOInput;
+			char LastError;
+		};
+		struct PendingReply
+		{
+			uint32_t DueTime;
+			uint8_t Length;
+			char Text[SMC100ChainedSimulatorLineSize];
+		};
+		void HandleLine(uint32_t ArrivalTime);
+		void Reply(uint32_t ArrivalTime, const char* Text);
+		void Update(ControllerState* Controller, uint32_t Now);
+		ControllerState* FindController(uint8_t Address);
+		SMC100ChainedBufferTransport* Transport;
+		ControllerState Controllers[SMC100ChainedMaxMotors];
+		uint8_t ControllerCount;
+		uint32_t ByteTime;
+		uint32_t TurnaroundTime;
+		uint32_t HomeTime;
+		uint32_t LineEndTime;
+		char Line[SMC100ChainedSimulatorLineSize];
+		uint8_t LineLength;
+		PendingReply Replies[SMC100ChainedSimulatorReplyCount];
+		uint8_t ReplyHead;
+		uint8_t ReplyCount;
+		uint32_t LinesReceived;
+		uint32_t RepliesSent;
+};
+
+#endif
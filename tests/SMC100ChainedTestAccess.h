@@ -0,0 +1,115 @@
+#ifndef SMC100ChainedTestAccess_h	//check for multiple inclusions
+#define SMC100ChainedTestAccess_h
+
+#include <string.h>
+#include "SMC100Chained.h"
+
+//Reaches the private hot paths of SMC100Chained so they can be tested and timed one at a time.
+class SMC100ChainedTestAccess
+{
+	public:
+		typedef SMC100Chained::CommandType CommandType;
+		typedef SMC100Chained::CommandGetSetType CommandGetSetType;
+		typedef SMC100Chained::StatusType StatusType;
+		typedef SMC100Chained::ModeType ModeType;
+		static void CommandEnqueue(SMC100Chained* Chain, uint8_t MotorIndex, CommandType Type, float Parameter, CommandGetSetType GetOrSet)
+		{
+			Chain->CommandEnqueue(MotorIndex, Type, Parameter, GetOrSet);
+		}
+		static bool CommandQueuePullToCurrentCommand(SMC100Chained* Chain)
+		{
+			return Chain->CommandQueuePullToCurrentCommand();
+		}
+		static uint8_t CommandQueueCount(SMC100Chained* Chain)
+		{
+			return Chain->CommandQueueCount();
+		}
+		static void ClearCommandQueue(SMC100Chained* Chain)
+		{
+			Chain->ClearCommandQueue();
+		}
+		static void SetCurrentCommand(SMC100Chained* Chain, uint8_t MotorIndex, CommandType Type, CommandGetSetType GetOrSet, float Parameter)
+		{
+			Chain->LoadCurrentCommand(MotorIndex, Type, GetOrSet, Parameter, SMC100Chained::CommandSourceType::Queue);
+		}
+		static CommandType GetCurrentCommand(SMC100Chained* Chain)
+		{
+			return Chain->CurrentCommand->Command;
+		}
+		static uint8_t GetCurrentCommandMotorIndex(SMC100Chained* Chain)
+		{
+			return Chain->CurrentCommandMotorIndex;
+		}
+		static float GetCurrentCommandParameter(SMC100Chained* Chain)
+		{
+			return Chain->CurrentCommandParameter;
+		}
+		static bool ParseReply(SMC100Chained* Chain, const char* Reply)
+		{
+			strncpy(Chain->ReplyBuffer, Reply, SMC100ChainedReplyBufferSize - 1);
+			Chain->ReplyBuffer[SMC100ChainedReplyBufferSize - 1] = '\0';
+			return Chain->ParseReply();
+		}
+		static StatusType ConvertStatus(SMC100Chained* Chain, const char* Code)
+		{
+			char StatusChar[3];
+			StatusChar[0] = Code[0];
+			StatusChar[1] = Code[1];
+			StatusChar[2] = '\0';
+			return Chain->ConvertStatus(StatusChar);
+		}
+		static bool ConvertMotorAddressToIndex(SMC100Chained* Chain, uint8_t Address, uint8_t* MotorIndexReturn)
+		{
+			return Chain->ConvertMotorAddressToIndex(Address, MotorIndexReturn);
+		}
+		static bool SendCurrentCommand(SMC100Chained* Chain)
+		{
+			return Chain->SendCurrentCommand();
+		}
+		static uint8_t RenderCurrentCommand(SMC100Chained* Chain, char* Buffer)
+		{
+			bool Status = true;
+			uint8_t Length = Chain->RenderCurrentCommand(Buffer, &Status);
+			return Status ? Length : 0;
+		}
+		static uint8_t FormatFloat(char* Buffer, float Value)
+		{
+			return SMC100Chained::FormatFloat(Buffer, Value);
+		}
+		static ModeType GetMode(SMC100Chained* Chain)
+		{
+			return Chain->Mode;
+		}
+		static void SetIdle(SMC100Chained* Chain)
+		{
+			Chain->ModeTransitionToIdle();
+		}
+		static StatusType GetStatus(SMC100Chained* Chain, uint8_t MotorIndex)
+		{
+			return Chain->MotorState[MotorIndex].Status;
+		}
+		static void SetStatus(SMC100Chained* Chain, uint8_t MotorIndex, StatusType Status)
+		{
+			Chain->MotorState[MotorIndex].Status = Status;
+			Chain->MotorState[MotorIndex].ExpectedStatus = Status;
+		}
+		static float GetPositionLimitNegative(SMC100Chained* Chain, uint8_t MotorIndex)
+		{
+			return Chain->MotorState[MotorIndex].PositionLimitNegative;
+		}
+		static float GetPositionLimitPositive(SMC100Chained* Chain, uint8_t MotorIndex)
+		{
+			return Chain->MotorState[MotorIndex].PositionLimitPositive;
+		}
+		static void SetPositionLimits(SMC100Chained* Chain, uint8_t MotorIndex, float Negative, float Positive)
+		{
+			Chain->MotorState[MotorIndex].PositionLimitNegative = Negative;
+			Chain->MotorState[MotorIndex].PositionLimitPositive = Positive;
+		}
+		static uint8_t GetGPIOInputCode(SMC100Chained* Chain, uint8_t MotorIndex)
+		{
+			return Chain->MotorState[MotorIndex].GPIOInput;
+		}
+};
+
+#endif
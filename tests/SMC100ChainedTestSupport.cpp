@@ -0,0 +1,87 @@
+#include "SMC100ChainedTestSupport.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <new>
+
+static std::atomic<uint32_t> AllocationCount(0);
+static uint32_t FailureCount = 0;
+
+//Every allocation in the binary goes through here, so a test can assert that a hot path never touches the heap.
+void* operator new(size_t Size)
+{
+	AllocationCount.fetch_add(1, std::memory_order_relaxed);
+	void* Pointer = malloc((Size == 0) ? 1 : Size);
+	if (Pointer == NULL)
+	{
+		throw std::bad_alloc();
+	}
+	return Pointer;
+}
+
+void* operator new[](size_t Size)
+{
+	return operator new(Size);
+}
+
+void operator delete(void* Pointer) noexcept
+{
+	free(Pointer);
+}
+
+void operator delete[](void* Pointer) noexcept
+{
+	free(Pointer);
+}
+
+void operator delete(void* Pointer, size_t Size) noexcept
+{
+	(void)Size;
+	free(Pointer);
+}
+
+void operator delete[](void* Pointer, size_t Size) noexcept
+{
+	(void)Size;
+	free(Pointer);
+}
+
+void SMC100ChainedTestFail(const char* File, int Line, const char* Expression)
+{
+	FailureCount++;
+	fprintf(stderr, "%s:%d: check failed: %s\n", File, Line, Expression);
+}
+
+int SMC100ChainedTestResult(const char* Name)
+{
+	if (FailureCount > 0)
+	{
+		printf("%s: %u checks failed\n", Name, FailureCount);
+		return 1;
+	}
+	printf("%s: passed\n", Name);
+	return 0;
+}
+
+uint32_t SMC100ChainedAllocationCount()
+{
+	return AllocationCount.load(std::memory_order_relaxed);
+}
+
+uint64_t SMC100ChainedNanoseconds()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void SMC100ChainedReport(const char* Name, uint64_t Nanoseconds, uint32_t Operations)
+{
+	double PerOperation = (Operations > 0) ? ((double)Nanoseconds / (double)Operations) : 0.0;
+	printf("%-44s %10u ops %10.1f ns/op\n", Name, Operations, PerOperation);
+}
+
+void SMC100ChainedSilentLog(const char* Text)
+{
+	(void)Text;
+}
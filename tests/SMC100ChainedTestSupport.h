@@ -0,0 +1,16 @@
+#ifndef SMC100ChainedTestSupport_h	//check for multiple inclusions
+#define SMC100ChainedTestSupport_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SMC100ChainedCheck(Expression) do { if (!(Expression)) { SMC100ChainedTestFail(__FILE__, __LINE__, #Expression); } } while (0)
+
+void SMC100ChainedTestFail(const char* File, int Line, const char* Expression);
+int SMC100ChainedTestResult(const char* Name);
+uint32_t SMC100ChainedAllocationCount();
+uint64_t SMC100ChainedNanoseconds();
+void SMC100ChainedReport(const char* Name, uint64_t Nanoseconds, uint32_t Operations);
+void SMC100ChainedSilentLog(const char* Text);
+
+#endif